@@ -4,7 +4,12 @@
 #include "iterator.h"
 #include "ranges.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <stdexcept>
 
 namespace sg {
 
@@ -25,6 +30,10 @@ namespace sg {
  *  shared_opaque_buffer<IBuffer<T>>
  *      opaque version of shared_buffer
  *
+ *  make_shared_buffer<T>(length, alignment)
+ *      a shared_buffer with the data and the shared_ptr control block in one allocation, which
+ *      converts to any other shared_buffer<T, ...>, e.g. a shared_c_buffer
+ *
  * The deleter in the above classes allow you to specify how the object should be deleted, for
  * example using free(), delete, delete[], or some other function. By default, if no deleter is
  * specified then delete or delete[] is called depending on type of T. If sg::deleter_free is passed
@@ -240,6 +249,18 @@ class shared_buffer : public IBuffer<T> {
         : ptr(std::shared_ptr<T[]>(_buff.release(), deleter())), length(_buff.size())
     {}
 
+    /* Shares the data of a shared_buffer with another deleter. The deleter is only that of the
+     * pointers a shared_buffer takes ownership of, shared data stays with its own */
+    template <typename other_deleter>
+        requires(!std::is_same_v<other_deleter, deleter>)
+    shared_buffer(const shared_buffer<T, other_deleter> &other) noexcept
+        : ptr(other.ptr), length(other.length) {}
+
+    template <typename other_deleter>
+        requires(!std::is_same_v<other_deleter, deleter>)
+    shared_buffer(shared_buffer<T, other_deleter> &&other) noexcept
+        : ptr(std::move(other.ptr)), length(other.length) {}
+
     // Move constructors
     shared_buffer(shared_buffer &&) = default;
     shared_buffer &operator=(shared_buffer &&data) = default;
@@ -267,6 +288,8 @@ class shared_buffer : public IBuffer<T> {
         this->length = _length;
     }
     void reset() noexcept override { reset(nullptr, 0); }
+
+    template <typename, typename> friend class shared_buffer;
 };
 
 /* A version of unique_buffer that uses C-style free() to delete the base pointer */
@@ -300,6 +323,107 @@ template <typename T> shared_buffer<T, deleter_free<T>> make_shared_c_buffer(siz
     return shared_buffer<T, deleter_free<T>>(ptr, length);
 }
 
+namespace internal {
+
+/* Room for the shared_ptr control block, ahead of the payload of make_shared_buffer(). The control
+ * block holds the counts, the pointer, the (empty) deleter and this allocator; should a standard
+ * library need more, the control block is allocated separately */
+constexpr size_t SHARED_BUFFER_CONTROL_BLOCK_RESERVE = 48;
+
+inline void *allocate_aligned(size_t size, size_t alignment) {
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(size);
+    return ::operator new(size, std::align_val_t(alignment));
+}
+
+inline void free_aligned(void *p, size_t alignment) noexcept {
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        ::operator delete(p);
+    else
+        ::operator delete(p, std::align_val_t(alignment));
+}
+
+/* Places the control block at the start of the allocation, so that the counts share a cache line
+ * with the start of the payload, and frees the lot once the control block goes, i.e. when the last
+ * shared_ptr and weak_ptr are gone */
+template <typename T> struct inplace_control_block_allocator {
+    typedef T value_type;
+
+    std::byte *block;  // the allocation, room for the control block first
+    size_t alignment;  // of the allocation
+
+    inplace_control_block_allocator(std::byte *_block, size_t _alignment) noexcept
+        : block(_block), alignment(_alignment) {}
+    template <typename U>
+    inplace_control_block_allocator(const inplace_control_block_allocator<U> &other) noexcept
+        : block(other.block), alignment(other.alignment) {}
+
+    [[nodiscard]] T *allocate(size_t n) {
+        if (n * sizeof(T) <= SHARED_BUFFER_CONTROL_BLOCK_RESERVE && alignof(T) <= alignof(std::max_align_t))
+            return reinterpret_cast<T *>(block);
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t) noexcept {
+        if (reinterpret_cast<std::byte *>(p) != block) ::operator delete(p);
+        free_aligned(block, alignment);
+    }
+
+    template <typename U>
+    bool operator==(const inplace_control_block_allocator<U> &other) const noexcept {
+        return block == other.block;
+    }
+};
+
+} // namespace internal
+
+/* Deletes nothing: for memory freed some other way, e.g. with the control block by
+ * make_shared_buffer() */
+template <typename T> struct deleter_none {
+    constexpr void operator()(T *) const noexcept {}
+};
+
+/**
+ * @brief Creates a shared_buffer with the payload and the shared_ptr control block in one allocation
+ * @details Half the allocations of make_shared_c_buffer(), and the counts sit next to the data. As
+ *          with make_shared_c_buffer() the elements are left uninitialised. The memory is only
+ *          freed once the last copy and std::weak_ptr of it are gone, by the control block, hence
+ *          the deleter_none in the type. It converts to a shared_c_buffer, sharing the memory, so
+ *          that it goes wherever those do.
+ *
+ *          The payload starts at the first multiple of the alignment past the 48 bytes kept for the
+ *          control block, so a large alignment costs a whole alignment's worth per buffer: an extra
+ *          page with 4096.
+ *
+ * @param length     number of elements
+ * @param alignment  of the payload, a power of two, e.g. 4096 for O_DIRECT
+ *
+ * @throw std::bad_alloc if memory can't be allocated, or the size doesn't fit in a size_t
+ * @throw std::invalid_argument if alignment isn't a power of two
+ */
+template <typename T>
+shared_buffer<T, deleter_none<T>> make_shared_buffer(size_t length,
+                                                     size_t alignment = alignof(std::max_align_t)) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        throw std::invalid_argument("make_shared_buffer: alignment must be a power of two");
+    alignment = std::max({alignment, alignof(T), alignof(std::max_align_t)});
+
+    /* the payload starts at the first multiple of the alignment past the control block */
+    auto offset = (internal::SHARED_BUFFER_CONTROL_BLOCK_RESERVE + alignment - 1) / alignment * alignment;
+    if (length > (SIZE_MAX - offset) / sizeof(T)) throw std::bad_alloc();
+    auto *block = static_cast<std::byte *>(internal::allocate_aligned(offset + sizeof(T) * length, alignment));
+
+    internal::inplace_control_block_allocator<T> allocator(block, alignment);
+    try {
+        auto *payload = reinterpret_cast<T *>(block + offset);
+        return shared_buffer<T, deleter_none<T>>(
+            std::shared_ptr<T[]>(payload, deleter_none<T>(), allocator), length);
+    } catch (...) {
+        /* only if the control block didn't fit, and allocating it failed */
+        internal::free_aligned(block, alignment);
+        throw;
+    }
+}
+
 /* Allocates memory and creates an opaque_buffer */
 template <typename T> unique_opaque_buffer<T> make_unique_opaque_buffer(size_t length) {
     /* The base buffer MUST be in the heap. */
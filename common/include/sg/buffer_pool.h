@@ -0,0 +1,119 @@
+#pragma once
+
+#include "buffer.h"
+#include <sg/export/common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sg {
+
+/**
+ * @brief       A pool of memory blocks for shared_c_buffers that are allocated and freed at a high rate
+ * @details     Sizes are rounded up to a power of two, from 64 bytes to max_size, and each size class
+ *              keeps the blocks freed for reuse. Each thread has a small cache of blocks per size
+ *              class, which is refilled from (and spills into) a shared list half a cache at a time,
+ *              so a buffer made on one thread and freed on another (a producer and a writer thread)
+ *              only takes a lock once every thread_cache_blocks / 2 buffers. The control block of
+ *              the std::shared_ptr comes from the pool too, so a buffer that is served from a cache
+ *              does not call malloc at all.
+ *
+ *              Buffers larger than max_size are not pooled, they are malloc'd and freed as usual.
+ *
+ *              The pool must outlive every buffer made by it. global() is never destroyed, and is
+ *              the one to use unless the memory must be returned at some point. Thread safe.
+ */
+class SG_COMMON_EXPORT buffer_pool {
+  public:
+    typedef sg::shared_c_buffer<std::byte> buffer_type;
+
+    struct options_t {
+        /* largest size pooled, rounded up to a power of two */
+        size_t max_size{1024 * 1024};
+        /* blocks cached per size class and thread */
+        size_t thread_cache_blocks{64};
+        /* bytes kept per size class on the shared list, blocks freed beyond that go back to malloc */
+        size_t shared_cache_bytes{64 * 1024 * 1024};
+    };
+
+    struct stats_t {
+        /* buffers served from a cache */
+        uint64_t hits{0};
+        /* served by malloc, as there was nothing cached */
+        uint64_t misses{0};
+        /* buffers over max_size */
+        uint64_t unpooled{0};
+        /* bytes on the shared lists, not counting the thread caches */
+        size_t shared_cached_bytes{0};
+
+        [[nodiscard]] double hit_rate() const noexcept {
+            auto total = hits + misses;
+            return total ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+        }
+    };
+
+    buffer_pool();
+    explicit buffer_pool(options_t options);
+    ~buffer_pool();
+
+    buffer_pool(const buffer_pool &) = delete;
+    buffer_pool &operator=(const buffer_pool &) = delete;
+
+    /** @brief the process wide pool, with the default options */
+    [[nodiscard]] static buffer_pool &global();
+
+    /**
+     * @brief a buffer of size bytes, its contents are undefined
+     * @throws std::bad_alloc if memory can't be allocated
+     */
+    [[nodiscard]] buffer_type make_buffer(size_t size);
+
+    /** @brief a buffer holding a copy of size bytes at data */
+    [[nodiscard]] buffer_type make_buffer(const void *data, size_t size);
+
+    /** @brief counters summed over all threads, hits and misses are up to date as of each thread's last
+     * allocation */
+    [[nodiscard]] stats_t stats() const;
+
+    /** @brief frees the blocks on the shared lists, thread caches are left as they are */
+    void trim();
+
+  private:
+    struct thread_cache;
+    struct block_deleter;
+    template <typename T> struct block_allocator;
+    struct shared_list {
+        std::mutex mutex;
+        std::vector<void *> blocks;
+    };
+
+    options_t m_options;
+    uint64_t m_id;
+    size_t m_classes;
+    std::unique_ptr<shared_list[]> m_shared;
+
+    /* guards m_caches and m_retired */
+    mutable std::mutex m_mutex;
+    std::vector<thread_cache *> m_caches;
+    stats_t m_retired;  // counters of the threads that have exited
+
+    [[nodiscard]] static size_t size_class_of(size_t size) noexcept;
+    [[nodiscard]] static size_t block_size(size_t size_class) noexcept;
+
+    /* raw blocks, counted as hits and misses when count is set */
+    [[nodiscard]] void *allocate(size_t size_class, bool count);
+    void deallocate(void *block, size_t size_class) noexcept;
+
+    [[nodiscard]] thread_cache &local_cache();
+    void refill(thread_cache &cache, size_t size_class);
+    void spill(thread_cache &cache, size_t size_class) noexcept;
+    void count_unpooled();
+    void retire(thread_cache &cache) noexcept;
+
+    friend struct buffer_pool_thread_caches;
+};
+
+} // namespace sg
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <sg/export/common.h>
+#include "compression.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace sg {
+
+/**
+ * @brief Streaming reader for files written by file_writer with compression enabled
+ *
+ * file_writer compresses each batch with a streaming compressor, flushed at the end of the batch,
+ * and writes the output as a frame:
+ *
+ *   "SGZF" | payload length (uint32, little endian) | crc32c of the payload (uint32, little endian)
+ *   | payload
+ *
+ * The payloads, one after the other, are the compressed stream. As every frame ends on a flush,
+ * everything up to the end of any frame can be decompressed, so a file cut short (e.g. by a crash
+ * or power failure) is readable up to its last complete frame. Reading stops at the first frame
+ * that is incomplete or fails its CRC, see truncated().
+ *
+ * Not thread safe.
+ */
+class SG_COMMON_EXPORT compressed_file_reader {
+  public:
+    /** @throws std::runtime_error if the file can't be opened */
+    explicit compressed_file_reader(const std::filesystem::path &path);
+    ~compressed_file_reader();
+
+    compressed_file_reader(const compressed_file_reader &) = delete;
+    compressed_file_reader &operator=(const compressed_file_reader &) = delete;
+
+    /**
+     * @brief reads up to size bytes of decompressed data
+     * @return number of bytes read, 0 at the end of the data
+     * @throws std::runtime_error if a frame passes its CRC check, but can't be decompressed
+     */
+    size_t read(void *dst, size_t size);
+
+    /** @brief true if reading stopped at an incomplete or corrupt frame, rather than the end of the file */
+    [[nodiscard]] bool truncated() const noexcept { return m_truncated; }
+
+    /** @brief frames read so far */
+    [[nodiscard]] size_t frame_count() const noexcept { return m_frames; }
+
+    /** @brief reads the whole file, see read() */
+    [[nodiscard]] static std::vector<std::byte> read_all(const std::filesystem::path &path);
+
+  private:
+    std::ifstream m_file;
+    std::unique_ptr<compression::IStreamDecompressor> m_decompressor;
+
+    /* decompressed, not read yet */
+    std::vector<std::byte> m_output;
+    size_t m_output_pos{0};
+    std::vector<std::byte> m_payload;
+
+    size_t m_frames{0};
+    bool m_end{false};
+    bool m_truncated{false};
+
+    /* decompresses the next frame, returns false at the end */
+    bool next_frame();
+};
+
+} // namespace sg
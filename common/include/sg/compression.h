@@ -0,0 +1,168 @@
+#pragma once
+
+#include <sg/export/common.h>
+#include "buffer.h"
+#include "callback.h"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace sg::compression {
+
+/* This file defines a codec-independent compression interface.
+ *
+ * Each codec writes its own standard frame format (zstd frames, LZ4 frames), and those formats
+ * start with a magic number. So compressed data is self-identifying: detect_codec() works out which
+ * codec wrote it, and the decompress() functions below pick the right codec automatically.
+ *
+ * Available codecs:
+ *
+ *   - zstd, if libsg is built with LIBSG_ZSTD. Good ratio, for storage and archives
+ *   - lz4,  if libsg is built with LIBSG_LZ4. Lower ratio, but much faster, for real-time links
+ */
+
+enum class codec_type { zstd, lz4 };
+
+/* Receives the output of a streaming compressor/decompressor */
+CREATE_CALLBACK(output_cb_t, void(const std::byte *, size_t))
+
+/**
+ * @brief Streaming compressor
+ *
+ * Compressed data is passed to the output callback as it becomes available, which may be during
+ * any of the calls below. Not thread safe.
+ */
+class SG_COMMON_EXPORT IStreamCompressor {
+  public:
+    virtual ~IStreamCompressor() = default;
+
+    /** Compresses the given data. The codec may buffer it internally. */
+    virtual void write(const void *src, size_t srcSize) = 0;
+
+    /** Outputs everything written so far, so that it can be decompressed on the other end */
+    virtual void flush() = 0;
+
+    /** Ends the current frame. Further writes start a new frame. */
+    virtual void finish() = 0;
+};
+
+/**
+ * @brief Streaming decompressor
+ *
+ * Accepts compressed data in chunks of any size, and passes decompressed data to the output
+ * callback. Not thread safe.
+ */
+class SG_COMMON_EXPORT IStreamDecompressor {
+  public:
+    virtual ~IStreamDecompressor() = default;
+
+    /**
+     * @brief Decompresses the given data
+     * @throw std::runtime_error if the data is corrupt
+     */
+    virtual void write(const void *src, size_t srcSize) = 0;
+};
+
+/**
+ * @brief Interface for compression codecs. Implementations are thread safe.
+ */
+class SG_COMMON_EXPORT ICodec {
+  public:
+    virtual ~ICodec() = default;
+
+    [[nodiscard]] virtual codec_type type() const noexcept = 0;
+
+    [[nodiscard]] virtual int default_compression_level() const = 0;
+    [[nodiscard]] virtual std::pair<int, int> bounds_compression_level() const = 0;
+
+    /** Largest possible compressed size of the given number of bytes */
+    [[nodiscard]] virtual size_t get_max_compressed_size(size_t srcSize) const = 0;
+
+    /**
+     * @brief Size of the original data, or std::nullopt if the data does not record it (e.g.
+     *        when written by a streaming compressor)
+     * @throw std::runtime_error if the data was not written by this codec
+     */
+    [[nodiscard]] virtual std::optional<size_t> get_uncompressed_size(const void *src,
+                                                                      size_t srcSize) const = 0;
+
+    /**
+     * @brief Compresses the given data into a single frame
+     *
+     * @param  src      Source pointer
+     * @param  srcSize  Size of source data (in bytes)
+     * @param  dst      Pointer to buffer store compressed data in
+     * @param  dstSize  Size of the availble buffer, see get_max_compressed_size()
+     * @param  cLevel   Compression level
+     * @return Number of bytes actually written to buffer
+     */
+    [[nodiscard]] virtual size_t compress(const void *src, size_t srcSize, void *dst,
+                                          size_t dstSize, int cLevel) const = 0;
+
+    /** Decompresses the given data, whose uncompressed size must be known */
+    virtual void decompress(const void *src, size_t srcSize, void *dst,
+                            size_t uncompressedSize) const = 0;
+
+    [[nodiscard]] virtual std::unique_ptr<IStreamCompressor>
+    create_compressor(int cLevel, output_cb_t output) const = 0;
+
+    [[nodiscard]] virtual std::unique_ptr<IStreamDecompressor>
+    create_decompressor(output_cb_t output) const = 0;
+};
+
+/** Returns true if libsg was built with the given codec */
+[[nodiscard]] SG_COMMON_EXPORT bool is_available(codec_type type) noexcept;
+
+/**
+ * @brief Returns the given codec
+ * @throw std::invalid_argument if libsg was not built with that codec
+ */
+[[nodiscard]] SG_COMMON_EXPORT const ICodec &codec(codec_type type);
+
+/** Returns the codec that wrote the given data, or std::nullopt if it is not recognised */
+[[nodiscard]] SG_COMMON_EXPORT std::optional<codec_type> detect_codec(const void *src,
+                                                                      size_t srcSize) noexcept;
+
+/**
+ *  @brief Compresses given object using the given codec
+ *
+ *  @param  type     Codec to use
+ *  @param  src      Source pointer
+ *  @param  srcSize  Size of source data (in bytes, i.e. count * sizeof(..))
+ *  @param  cLevel   Compression level
+ *  @return buffer containing compressed data
+ **/
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte> compress(codec_type type, const void *src,
+                                                                   size_t srcSize, int cLevel);
+
+/**
+ *  @brief Compresses given object using the default compression level of the given codec
+ **/
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte> compress(codec_type type, const void *src,
+                                                                   size_t srcSize);
+
+/**
+ *  @brief Decompresses given data, detecting which codec compressed it
+ *
+ *  @throw std::runtime_error if the codec can't be detected, or if it is not available
+ **/
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte> decompress(const void *src,
+                                                                     size_t srcSize);
+
+template <typename T = std::byte>
+[[nodiscard]] unique_c_buffer<T> decompress(const IBuffer<std::byte> &src) {
+    auto ret = decompress(src.get(), src.size());
+    auto count = ret.size();
+
+    return unique_c_buffer<T>((T *)(ret.release()), count / sizeof(T));
+}
+
+/**
+ * @brief Creates a streaming decompressor that detects the codec from the first bytes written
+ */
+[[nodiscard]] SG_COMMON_EXPORT std::unique_ptr<IStreamDecompressor>
+create_decompressor(output_cb_t output);
+
+} // namespace sg::compression
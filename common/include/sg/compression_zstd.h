@@ -4,9 +4,105 @@
 #include "buffer.h"
 
 #include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
 
 namespace sg::compression::zstd {
 
+/************************** Dictionaries ***************************/
+
+/**
+ * @brief A zstd dictionary, for compressing many small and similar messages.
+ *
+ * The dictionary content is referenced rather than copied: the digested ZSTD_CDict/ZSTD_DDict
+ * objects point into @c content(), which is kept alive for as long as any copy of the dictionary
+ * exists. Copies are cheap and share the same state, so a single dictionary can be used by any
+ * number of threads at once.
+ *
+ * Digested dictionaries are cached. A ZSTD_DDict is created on construction and a ZSTD_CDict is
+ * created the first time each compression level is used. Dictionaries that carry a dictionary ID
+ * (i.e. those created by ZDICT/train_dictionary()) are also registered by that ID, so loading the
+ * same dictionary twice shares the already digested objects and find_dictionary() can be used to
+ * look up the dictionary a frame was compressed with.
+ */
+class SG_COMMON_EXPORT dictionary {
+  public:
+    /**
+     * @brief Loads a dictionary from the given content, without copying it
+     *
+     * @param content  dictionary content, as returned by train_dictionary() or stored on disk.
+     *                 Any other content is treated as a raw-content dictionary with ID 0.
+     */
+    explicit dictionary(sg::shared_c_buffer<std::byte> content);
+
+    /** Dictionary ID, or 0 for raw-content dictionaries */
+    [[nodiscard]] unsigned id() const noexcept;
+
+    /** Dictionary content. Save this to be able to load the dictionary later */
+    [[nodiscard]] const sg::shared_c_buffer<std::byte>& content() const noexcept;
+
+  private:
+    struct impl;
+    std::shared_ptr<impl> m_impl;
+
+    explicit dictionary(std::shared_ptr<impl> impl);
+
+    friend struct dictionary_access;
+};
+
+/**
+ * @brief Trains a dictionary from a set of samples, using ZDICT
+ *
+ * A few thousand samples, with a total size of about 100 times @p maxDictSize, is a good starting
+ * point. Training fails if there are too few samples or if they have nothing in common.
+ *
+ * @param  samples      Samples, concatenated one after the other
+ * @param  sampleSizes  Size of each sample (in bytes)
+ * @param  noSamples    Number of samples
+ * @param  maxDictSize  Maximum size of the dictionary, ~100 KiB is a reasonable default
+ * @throw  std::runtime_error if training fails
+ */
+[[nodiscard]] SG_COMMON_EXPORT dictionary train_dictionary(const void* samples,
+                                                           const size_t* sampleSizes,
+                                                           unsigned noSamples,
+                                                           size_t maxDictSize);
+
+/**
+ * @brief Trains a dictionary from a set of samples, using ZDICT
+ *
+ * @param  samples      Range of samples, each sample being a contiguous range
+ * @param  maxDictSize  Maximum size of the dictionary
+ */
+template <typename RangeT>
+    requires(std::ranges::input_range<RangeT> &&
+             std::ranges::contiguous_range<std::ranges::range_value_t<RangeT>> &&
+             std::is_trivially_copyable_v<
+                 std::ranges::range_value_t<std::ranges::range_value_t<RangeT>>>)
+[[nodiscard]] dictionary train_dictionary(const RangeT& samples, size_t maxDictSize) {
+    std::vector<std::byte> concatenated;
+    std::vector<size_t> sizes;
+    for (const auto& sample : samples) {
+        auto begin = reinterpret_cast<const std::byte*>(std::ranges::data(sample));
+        auto size = std::ranges::size(sample) *
+                    sizeof(std::ranges::range_value_t<std::ranges::range_value_t<RangeT>>);
+        concatenated.insert(concatenated.end(), begin, begin + size);
+        sizes.push_back(size);
+    }
+    return train_dictionary(concatenated.data(), sizes.data(), static_cast<unsigned>(sizes.size()),
+                            maxDictSize);
+}
+
+/** Returns a live (i.e. still in use) dictionary with the given ID, if there is one */
+[[nodiscard]] SG_COMMON_EXPORT std::optional<dictionary> find_dictionary(unsigned id);
+
+/**
+ * @brief Returns the ID of the dictionary needed to decompress the given frame
+ *
+ * Returns 0 if no dictionary is needed, or if the frame does not record the ID.
+ */
+[[nodiscard]] SG_COMMON_EXPORT unsigned get_dictionary_id(const void* src, size_t src_size);
+
 /************************ Helper functions *************************/
 
 [[nodiscard]] SG_COMMON_EXPORT int default_compresssion_level();
@@ -53,11 +149,53 @@ template <typename RangeT>
 [[nodiscard]] unique_c_buffer<std::byte>
 compress(const RangeT& srcBuffer, int compressionLevel, int noThreads) {
     auto size = std::size(srcBuffer) * sizeof(std::ranges::range_value_t<RangeT>);
-    return compress(std::begin(srcBuffer), size, compressionLevel, noThreads);
+    return compress(std::ranges::data(srcBuffer), size, compressionLevel, noThreads);
+}
+
+/**
+ * @brief Compresses given object using ZStandard algorithm and a dictionary
+ *
+ *        The frame records the dictionary ID and the content size. Compression is always single
+ *        threaded, as dictionaries are aimed at small inputs.
+ *
+ * @param  src       Source pointer
+ * @param  srcSize   Size of source data (in bytes, i.e. count * sizeof(..))
+ * @param  dst       Pointer to buffer store compressed data in
+ * @param  dstSize   Size of the availble buffer
+ * @param  dict      Dictionary to use
+ * @param  cLevel    Compression level
+ * @return Number of bytes actually written to buffer
+ */
+[[nodiscard]] SG_COMMON_EXPORT size_t compress(const void *src, size_t srcSize, void *dst, size_t dstSize, const dictionary& dict, int cLevel);
+
+/**
+ *  @brief Compresses given object using ZStandard algorithm and a dictionary
+ *
+ *  @param  src       Source pointer
+ *  @param  srcSize   Size of source data (in bytes, i.e. count * sizeof(..))
+ *  @param  dict      Dictionary to use
+ *  @param  cLevel    Compression level
+ *  @return buffer containing compressed data
+ **/
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte> compress(const void *src, size_t srcSize, const dictionary& dict, int cLevel);
+
+template <typename RangeT>
+    requires(std::ranges::contiguous_range<RangeT> &&
+             std::is_trivially_copyable_v<std::ranges::range_value_t<RangeT>> &&
+             std::has_unique_object_representations_v<std::ranges::range_value_t<RangeT>>)
+[[nodiscard]] unique_c_buffer<std::byte>
+compress(const RangeT& srcBuffer, const dictionary& dict, int compressionLevel) {
+    auto size = std::size(srcBuffer) * sizeof(std::ranges::range_value_t<RangeT>);
+    return compress(std::ranges::data(srcBuffer), size, dict, compressionLevel);
 }
 
 /********************** Decompression functions **********************/
-SG_COMMON_EXPORT void decompress(const void *src, size_t srcSize, void* dst, size_t uncompressedSize);
+
+/**
+ *  @brief decompresses into dst, which must have room for uncompressedSize bytes
+ *  @return the number of bytes decompressed, less than uncompressedSize if the data is shorter
+ **/
+SG_COMMON_EXPORT size_t decompress(const void *src, size_t srcSize, void* dst, size_t uncompressedSize);
 
 /**
  *  @brief recompresses given object using ZStandard algorithm
@@ -96,4 +234,30 @@ template <typename T = std::byte>
     return decompress<T>(src.get(), src.size());
 }
 
+/** @brief decompresses data that was compressed with the given dictionary, returns its size */
+SG_COMMON_EXPORT size_t decompress(const void *src, size_t srcSize, void* dst, size_t uncompressedSize, const dictionary& dict);
+
+/**
+ *  @brief decompresses data that was compressed with the given dictionary
+ *
+ *  @param  src       compressed data pointer
+ *  @param  srcSize   Size of source data (in bytes, i.e. count * sizeof(..))
+ *  @param  dict      Dictionary that the data was compressed with
+ *  @return buffer containing de-compressed data
+ **/
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte> decompress(const void *src, size_t srcSize, const dictionary& dict);
+
+template <typename T>
+[[nodiscard]] unique_c_buffer<T> decompress(const void *src, size_t srcSize, const dictionary& dict) {
+    auto ret = decompress(src, srcSize, dict);
+    auto count = ret.size();
+
+    return unique_c_buffer<T>((T *)(ret.release()), count / sizeof(T));
+}
+
+template <typename T = std::byte>
+[[nodiscard]] unique_c_buffer<T> decompress(const IBuffer<std::byte> &src, const dictionary& dict) {
+    return decompress<T>(src.get(), src.size(), dict);
+}
+
 }  // namespace sg::compression::zstd
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <sg/export/common.h>
+#include "buffer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace sg::compression::zstd {
+
+/**
+ * @brief Compresses a stream of blocks, adjusting the compression level to meet a target.
+ *
+ * Rather than a fixed compression level, the caller declares what the compressor has to keep up
+ * with: an input throughput, a latency per block, and/or the depth of the queue feeding it (e.g.
+ * the queue of a file_writer). After each block the measured throughput, latency and queue depth
+ * are compared against the target:
+ *
+ *   - if the compressor is falling behind, it first adds a zstd worker thread (up to
+ *     `max_threads`), then lowers the compression level;
+ *   - if it has headroom, it raises the compression level, and once at `levels.second` it gives
+ *     back worker threads.
+ *
+ * Throughput is smoothed over a few blocks, and the level is only raised once the throughput is
+ * comfortably above target (see `headroom`), so that the level doesn't oscillate. Without any
+ * target the level never changes.
+ *
+ * Every block is a self-contained zstd frame, so it can be decompressed with decompress() as
+ * usual. All functions are thread safe.
+ */
+class SG_COMMON_EXPORT adaptive_compressor {
+  public:
+    struct target_t {
+        /** Input throughput to sustain, in MB/s (10^6 bytes/s), or 0 for no target */
+        double throughput_mbps{0};
+
+        /** Maximum time to compress a block, or 0 for no target */
+        std::chrono::microseconds latency{0};
+
+        /** Queue depth above which the compressor is considered to be falling behind, or 0 to
+         *  ignore queue depth */
+        size_t queue_depth{0};
+
+        /** Range of compression levels to pick from, clamped to bounds_compression_level().
+         *  Defaults to [1, 19], as the levels above 19 need a lot of memory */
+        std::pair<int, int> levels{1, 19};
+
+        /** Maximum number of zstd worker threads, clamped to bounds_nothread(). 0 means blocks
+         *  are always compressed on the calling thread */
+        int max_threads{0};
+
+        /** How far above target the throughput (or below target the latency) must be before the
+         *  level is raised, e.g. 1.25 means 25% headroom */
+        double headroom{1.25};
+    };
+
+    enum class decision_t { none, level_up, level_down, thread_up, thread_down };
+
+    struct stats_t {
+        int level{0};
+        int threads{0};
+
+        uint64_t blocks{0};
+        uint64_t bytes_in{0};
+        uint64_t bytes_out{0};
+
+        /** Throughput and latency of the last block */
+        double last_mbps{0};
+        std::chrono::microseconds last_latency{0};
+
+        /** Smoothed throughput, at the current level and number of threads */
+        double average_mbps{0};
+
+        /** Queue depth given with the last block */
+        size_t last_queue_depth{0};
+
+        /** Decision taken after the last block, and number of each decision so far */
+        decision_t last_decision{decision_t::none};
+        uint64_t level_ups{0};
+        uint64_t level_downs{0};
+        uint64_t thread_ups{0};
+        uint64_t thread_downs{0};
+
+        [[nodiscard]] double ratio() const noexcept {
+            return bytes_out ? double(bytes_in) / double(bytes_out) : 0;
+        }
+    };
+
+    /**
+     * @param target      What to adapt to
+     * @param startLevel  Initial compression level, defaults to default_compresssion_level()
+     *                    (clamped to target.levels)
+     */
+    explicit adaptive_compressor(const target_t &target, std::optional<int> startLevel = {});
+
+    /**
+     * @brief Compresses a block at the current level, then adjusts the level for the next one
+     *
+     * @param  src         Source pointer
+     * @param  srcSize     Size of source data (in bytes)
+     * @param  dst         Pointer to buffer store compressed data in
+     * @param  dstSize     Size of the availble buffer, see get_max_compressed_size()
+     * @param  queueDepth  Depth of the queue feeding the compressor, if target.queue_depth is set
+     * @return Number of bytes actually written to buffer
+     */
+    [[nodiscard]] size_t compress(const void *src, size_t srcSize, void *dst, size_t dstSize,
+                                  size_t queueDepth = 0);
+
+    /** @return buffer containing compressed data */
+    [[nodiscard]] unique_c_buffer<std::byte> compress(const void *src, size_t srcSize,
+                                                      size_t queueDepth = 0);
+
+    [[nodiscard]] unique_c_buffer<std::byte> compress(const IBuffer<std::byte> &src,
+                                                      size_t queueDepth = 0) {
+        return compress(src.get(), src.size(), queueDepth);
+    }
+
+    /** Compression level the next block will use */
+    [[nodiscard]] int level() const;
+
+    /** Number of zstd worker threads the next block will use */
+    [[nodiscard]] int threads() const;
+
+    [[nodiscard]] const target_t &target() const noexcept { return m_target; }
+
+    [[nodiscard]] stats_t stats() const;
+
+  private:
+    target_t m_target;
+
+    mutable std::mutex m_mutex;
+    stats_t m_stats; // note: protected by m_mutex
+    bool m_fresh{true}; // note: protected by m_mutex, true until the average is reset
+
+    void update(size_t srcSize, size_t dstSize, std::chrono::steady_clock::duration elapsed,
+                size_t queueDepth);
+};
+
+} // namespace sg::compression::zstd
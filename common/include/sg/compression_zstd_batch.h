@@ -0,0 +1,100 @@
+#pragma once
+
+#include <sg/export/common.h>
+#include "buffer.h"
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace sg::compression::zstd {
+
+/**
+ * @brief Compresses or decompresses many independent buffers concurrently.
+ *
+ * zstd's own multi-threading (i.e. the `noThreads` argument of compress()) only helps with single
+ * large inputs. This class instead owns a fixed pool of worker threads, each with its own zstd
+ * contexts, and spreads a batch of independent buffers over them, one buffer per task.
+ *
+ * Results are always returned in the same order as the inputs. All functions are thread safe, and
+ * batches submitted from different threads share the same workers.
+ */
+class SG_COMMON_EXPORT batch_compressor {
+  public:
+    typedef std::span<const std::byte> input_type;
+
+    /**
+     * @param noThreads  Number of worker threads, defaults to sg::cpu::available_parallelism()
+     */
+    explicit batch_compressor(size_t noThreads = 0);
+
+    /** Waits for any outstanding async work to finish */
+    ~batch_compressor();
+
+    batch_compressor(const batch_compressor &) = delete;
+    batch_compressor &operator=(const batch_compressor &) = delete;
+
+    [[nodiscard]] size_t thread_count() const noexcept;
+
+    /**
+     * @brief Compresses each of the given buffers, and waits for the result
+     *
+     * @param  src     Buffers to compress
+     * @param  cLevel  Compression level
+     * @return compressed buffers, in the same order as @p src
+     * @throw  rethrows the first error, once the whole batch is done
+     */
+    [[nodiscard]] std::vector<unique_c_buffer<std::byte>> compress(std::span<const input_type> src,
+                                                                   int cLevel);
+
+    /**
+     * @brief Compresses each of the given buffers into a caller-provided arena
+     *
+     *        Buffer i is compressed into its own slot in the arena, starting at the sum of
+     *        get_max_compressed_size() of the buffers before it. Use arena_size() to size the
+     *        arena.
+     *
+     * @return the compressed data of each buffer, as a view into the arena, in the same order as
+     *         @p src
+     * @throw  std::invalid_argument if the arena is too small
+     */
+    [[nodiscard]] std::vector<std::span<std::byte>>
+    compress(std::span<const input_type> src, std::span<std::byte> arena, int cLevel);
+
+    /** Size of the arena needed to compress the given buffers */
+    [[nodiscard]] static size_t arena_size(std::span<const input_type> src);
+
+    /**
+     * @brief Decompresses each of the given buffers, and waits for the result
+     *
+     * @return decompressed buffers, in the same order as @p src
+     */
+    [[nodiscard]] std::vector<unique_c_buffer<std::byte>> decompress(std::span<const input_type> src);
+
+    /**
+     * @brief Compresses the given buffers asynchronously
+     *
+     *        The buffers are kept alive until the batch is done, so they can be released by the
+     *        caller straight away.
+     *
+     * @return future holding the compressed buffers, in the same order as @p src
+     */
+    [[nodiscard]] std::future<std::vector<unique_c_buffer<std::byte>>>
+    compress_async(std::vector<shared_c_buffer<std::byte>> src, int cLevel);
+
+    /** Compresses a single buffer asynchronously */
+    [[nodiscard]] std::future<unique_c_buffer<std::byte>> compress_async(shared_c_buffer<std::byte> src,
+                                                                         int cLevel);
+
+    /** Decompresses the given buffers asynchronously */
+    [[nodiscard]] std::future<std::vector<unique_c_buffer<std::byte>>>
+    decompress_async(std::vector<shared_c_buffer<std::byte>> src);
+
+  private:
+    struct impl;
+    std::unique_ptr<impl> m_impl;
+};
+
+} // namespace sg::compression::zstd
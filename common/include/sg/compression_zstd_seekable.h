@@ -0,0 +1,113 @@
+#pragma once
+
+#include <sg/export/common.h>
+#include "buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace sg::compression::zstd {
+
+/* This file implements the zstd seekable format, as defined in
+ *
+ *   https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * The input is split into independent zstd frames, and a seek table listing the compressed and
+ * decompressed size of each frame is appended as a skippable frame. Standard zstd tools skip the
+ * seek table, so the output can still be decompressed in full by the zstd CLI or by decompress().
+ */
+
+/**
+ * @brief The seek table of data in the zstd seekable format
+ */
+class SG_COMMON_EXPORT seek_table {
+  public:
+    struct frame_t {
+        uint64_t compressed_offset;
+        uint64_t decompressed_offset;
+        uint32_t compressed_size;
+        uint32_t decompressed_size;
+    };
+
+    /**
+     * @brief Reads the seek table from data in the seekable format
+     *
+     * @param  src      Pointer to the seekable data
+     * @param  srcSize  Size of the seekable data (in bytes)
+     * @throw  std::runtime_error if the data does not end with a valid seek table, or if the frames
+     *         in it don't fit in the data before it
+     */
+    seek_table(const void *src, size_t srcSize);
+
+    /**
+     * @brief Reads the seek table from a file in the seekable format.
+     *
+     *        Only the seek table, at the end of the file, is read.
+     * @throw  std::runtime_error as above, or if the file can't be read
+     */
+    explicit seek_table(const std::filesystem::path &path);
+
+    [[nodiscard]] const std::vector<frame_t> &frames() const noexcept;
+
+    /** Total size of the data, excluding the seek table */
+    [[nodiscard]] uint64_t compressed_size() const noexcept;
+    [[nodiscard]] uint64_t decompressed_size() const noexcept;
+
+    /** Index of the frame containing the given decompressed offset */
+    [[nodiscard]] size_t frame_index(uint64_t decompressedOffset) const;
+
+  private:
+    std::vector<frame_t> m_frames;
+
+    /* dataSize is the size of the data before the table, which the frames must fit in */
+    void parse(const std::byte *table, size_t tableSize, uint32_t noFrames, bool hasChecksums,
+               uint64_t dataSize);
+};
+
+/**
+ *  @brief Compresses given object into the zstd seekable format
+ *
+ *  @param  src        Source pointer
+ *  @param  srcSize    Size of source data (in bytes, i.e. count * sizeof(..))
+ *  @param  frameSize  Uncompressed size of each frame. Smaller frames allow finer-grained
+ *                     seeking, at the cost of compression ratio. Must not exceed 1 GiB.
+ *  @param  cLevel     Compression level
+ *  @param  noThreads  Number of frames to compress in parallel (0 = use calling thread only)
+ *  @return buffer containing compressed data, followed by the seek table
+ **/
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte>
+compress_seekable(const void *src, size_t srcSize, size_t frameSize, int cLevel, int noThreads);
+
+/**
+ * @brief Decompresses a byte range from data in the zstd seekable format
+ *
+ *        Only the frames that overlap the range are decompressed.
+ *
+ * @param  src        Pointer to the seekable data
+ * @param  srcSize    Size of the seekable data (in bytes)
+ * @param  offset     Offset into the decompressed data
+ * @param  dst        Buffer to store the decompressed range in
+ * @param  count      Number of bytes to decompress
+ * @param  noThreads  Number of frames to decompress in parallel (0 = use calling thread only)
+ * @throw  std::out_of_range if the range is outside of the decompressed data
+ */
+SG_COMMON_EXPORT void decompress_range(const void *src, size_t srcSize, uint64_t offset, void *dst,
+                                       size_t count, int noThreads);
+
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte>
+decompress_range(const void *src, size_t srcSize, uint64_t offset, size_t count, int noThreads);
+
+/**
+ * @brief Decompresses a byte range from a file in the zstd seekable format
+ *
+ *        Only the seek table and the frames that overlap the range are read from the file.
+ */
+SG_COMMON_EXPORT void decompress_range(const std::filesystem::path &path, uint64_t offset,
+                                       void *dst, size_t count, int noThreads);
+
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte>
+decompress_range(const std::filesystem::path &path, uint64_t offset, size_t count, int noThreads);
+
+} // namespace sg::compression::zstd
@@ -24,4 +24,22 @@ struct cpu_info_t {
 /* Estimate of the default amount of parallelism a program should use */
 [[nodiscard]] SG_COMMON_EXPORT size_t available_parallelism();
 
+/* Instruction set extensions of the current CPU, detected at runtime (i.e. independent of what the
+ * library was compiled for). Extensions that need OS support, like AVX, are only reported if the OS
+ * has enabled them. */
+struct cpu_features_t {
+    /* x86 */
+    bool sse42{false};
+    bool pclmul{false};
+    bool avx2{false};
+    bool avx512{false}; // AVX-512 F, BW and VL
+    bool vpclmulqdq{false};
+
+    /* Arm */
+    bool arm_crc32{false};
+    bool arm_pmull{false};
+};
+
+[[nodiscard]] SG_COMMON_EXPORT const cpu_features_t &features();
+
 }
@@ -4,6 +4,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <span>
 
 namespace sg::checksum {
 
@@ -30,8 +31,135 @@ namespace sg::checksum {
 
 [[nodiscard]] SG_COMMON_EXPORT uint32_t crc32(const void *data, std::size_t length, uint32_t remainder = 0);
 
-[[nodiscard]] SG_COMMON_EXPORT uint16_t crc16(const void *data, std::size_t length);
+/**
+ * @brief Copies src to dst, and calculates the CRC32-C of the data on the way
+ *
+ * The copy goes a few KiB at a time, each piece checksummed while it is still in the cache, so the
+ * CRC costs about as much as a second pass over L1 rather than over memory. Very large copies use
+ * non-temporal stores where available, so that the destination does not evict the cache.
+ *
+ * The buffers must not overlap.
+ *
+ * @param remainder Remainder, as for crc32c()
+ * @return crc32c(src, length, remainder)
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t copy_and_crc32c(void *dst, const void *src,
+                                                        std::size_t length, uint32_t remainder = 0);
+
+/**
+ * @brief Calculates CRC-64/ECMA-182 checksum, i.e. polynomial 0x42F0E1EBA9EA3693, not reflected,
+ *        initial value 0, no final xor
+ *
+ * For large blocks, where the collision probability of a 32-bit CRC is too high.
+ *
+ * @param remainder Previous result, when checksumming data in several parts. Start with 0
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint64_t crc64_ecma182(const void *data, std::size_t length, uint64_t remainder = 0);
+
+/**
+ * @brief Calculates CRC-64/NVME checksum, i.e. polynomial 0xAD93D23594C93659 (reversed
+ *        0x9A6C9329AC4BC9B5), reflected, initial value and final xor all ones
+ *
+ * @param remainder Remainder, as for crc32c(). No need to flip (i.e. start with 0)
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint64_t crc64_nvme(const void *data, std::size_t length, uint64_t remainder = 0);
 
+/**
+ * @brief crc16 Calculates CRC-16/ARC checksum (a.k.a. CRC-16, CRC-16/LHA)
+ *
+ * Polynomial 0x8005 (reversed 0xA001), reflected input/output, initial value 0, no final xor.
+ *
+ * @param data      Input data to checksum
+ * @param length    Length of input data
+ * @param remainder Previous result, when checksumming data in several parts. Start with 0
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint16_t crc16(const void *data, std::size_t length, uint16_t remainder = 0);
+
+/**
+ * @brief Calculates CRC-16/XMODEM checksum, i.e. the CCITT polynomial (0x1021), not reflected,
+ *        initial value 0, no final xor
+ *
+ * @param remainder Previous result, when checksumming data in several parts. Start with 0
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint16_t crc16_xmodem(const void *data, std::size_t length, uint16_t remainder = 0);
+
+/**
+ * @brief Calculates CRC-16/MODBUS checksum, i.e. polynomial 0x8005 (reversed 0xA001), reflected,
+ *        initial value 0xFFFF, no final xor
+ *
+ * Note: the checksum is sent least significant byte first on the wire.
+ *
+ * @param remainder Previous result, when checksumming data in several parts. Start with 0xFFFF
+ *                  (the initial value, as there is no final xor to undo)
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint16_t crc16_modbus(const void *data, std::size_t length, uint16_t remainder = 0xFFFF);
+
+/******************** Combining and multiple buffers ********************/
+
+/* A list of buffers, to be checksummed as if they were one (i.e. scatter/gather I/O) */
+typedef std::span<const std::span<const std::byte>> buffer_list_t;
+
+/**
+ * @brief Combines the CRC32-C of two consecutive blocks
+ *
+ * @param crcA     crc32c() of the first block
+ * @param crcB     crc32c() of the second block, calculated with a remainder of 0
+ * @param lengthB  Length of the second block
+ * @return crc32c() of both blocks, one after the other. Takes O(log(lengthB)) time
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32c_combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+
+/** Combines the CRC32 of two consecutive blocks, see crc32c_combine() */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32_combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+
+/** CRC32-C of the given buffers, one after the other, without concatenating them */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32c(buffer_list_t buffers, uint32_t remainder = 0);
+
+/** CRC32 of the given buffers, one after the other, without concatenating them */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32(buffer_list_t buffers, uint32_t remainder = 0);
+
+/**
+ * @brief Calculates CRC32-C checksum on multiple threads
+ *
+ * Splits the data into one block per thread, checksums the blocks concurrently and combines the
+ * results. Gives the same result as crc32c(), and is meant for large buffers (e.g. memory mapped
+ * files), of many MB. Small buffers are checksummed on the calling thread.
+ *
+ * @param data       Input data to checksum
+ * @param length     Length of input data
+ * @param remainder  Remainder, as for crc32c()
+ * @param noThreads  Number of threads to use, defaults to sg::cpu::available_parallelism()
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32c_parallel(const void *data, std::size_t length,
+                                                        uint32_t remainder = 0, std::size_t noThreads = 0);
+
+/** Calculates CRC32-C checksum of the given buffers, one after the other, on multiple threads */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32c_parallel(buffer_list_t buffers, uint32_t remainder = 0,
+                                                        std::size_t noThreads = 0);
+
+/** Calculates CRC32 checksum on multiple threads, see crc32c_parallel() */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32_parallel(const void *data, std::size_t length,
+                                                       uint32_t remainder = 0, std::size_t noThreads = 0);
+
+/** Calculates CRC32 checksum of the given buffers, one after the other, on multiple threads */
+[[nodiscard]] SG_COMMON_EXPORT uint32_t crc32_parallel(buffer_list_t buffers, uint32_t remainder = 0,
+                                                       std::size_t noThreads = 0);
+
+/**
+ * @brief Whether crc32c() uses hardware acceleration on this machine
+ *
+ * The implementation is picked at runtime, the first time it is needed, based on the instructions
+ * the CPU supports (see sg::cpu::features()).
+ */
 [[nodiscard]]  SG_COMMON_EXPORT bool can_do_crc32c_hardware();
 
+/** Name of the implementation crc32c() uses on this machine, e.g. "sse4.2+pclmul" or "tabular" */
+[[nodiscard]] SG_COMMON_EXPORT const char *crc32c_implementation();
+
+/** Name of the implementation crc32() uses on this machine */
+[[nodiscard]] SG_COMMON_EXPORT const char *crc32_implementation();
+
+/** Name of the implementation crc64_ecma182() and crc64_nvme() use on this machine, e.g. "pclmul" */
+[[nodiscard]] SG_COMMON_EXPORT const char *crc64_implementation();
+
 } // namespace sg::checksum
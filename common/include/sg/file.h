@@ -3,11 +3,73 @@
 #include "buffer.h"
 #include <sg/export/common.h>
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
 
 namespace sg::common::file {
 
+/* Access pattern hints for map(), may be combined with sg::enumeration::operator| */
+enum class map_advice : uint8_t {
+    normal = 0,
+    sequential = 1 << 0, // read ahead aggressively, and drop pages soon after they are read
+    random = 1 << 1,     // don't read ahead
+    will_need = 1 << 2,  // start reading the whole file in now
+};
+
+/**
+ * @brief A read-only memory mapping of a whole file
+ * @details The file is unmapped when the mapped_file is destroyed or reset. Pages are read in from
+ * the page cache as they are touched, so nothing is copied, and the memory used is the page cache's
+ * rather than the process's. The file must not be truncated while it is mapped.
+ *
+ * reset(ptr, size) takes ownership of a mapping made elsewhere (with mmap, or MapViewOfFile on
+ * Windows).
+ */
+class SG_COMMON_EXPORT mapped_file : public IBuffer<const std::byte> {
+    const std::byte *m_data{nullptr};
+    size_t m_size{0};
+
+  public:
+    mapped_file() noexcept = default;
+    mapped_file(const std::byte *data, size_t size) noexcept : m_data(data), m_size(size) {}
+    ~mapped_file() override;
+
+    mapped_file(mapped_file &&other) noexcept;
+    mapped_file &operator=(mapped_file &&other) noexcept;
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    [[nodiscard]] const std::byte *get() const noexcept override { return m_data; }
+    [[nodiscard]] const std::byte *get() noexcept override { return m_data; }
+    [[nodiscard]] size_t size() const noexcept override { return m_size; }
+
+    void reset() noexcept override { reset(nullptr, 0); }
+    void reset(const std::byte *data, size_t size) noexcept override;
+};
+
+/**
+ * @brief Maps the whole file read-only into memory, see mapped_file
+ * @details advice is given to the kernel with madvise(). On Windows, sequential and random are
+ * ignored, and will_need prefetches the file with PrefetchVirtualMemory(). An empty file gives an
+ * empty mapping.
+ * @throws std::runtime_error if the file can't be opened or mapped
+ */
+[[nodiscard]] SG_COMMON_EXPORT mapped_file map(const std::filesystem::path &path,
+                                               map_advice advice = map_advice::normal);
+
+/**
+ * @brief Reads the whole file on multiple threads
+ * @details Splits the file into one chunk per thread, each read with its own file handle. Meant for
+ * large files on filesystems where map() is slow (e.g. network filesystems), or where a copy is
+ * wanted anyway. Small files are read on the calling thread.
+ * @param noThreads  Number of threads to use, defaults to sg::cpu::available_parallelism()
+ * @throws std::runtime_error if the file can't be read in full
+ */
+[[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte>
+read_parallel(const std::filesystem::path &path, size_t noThreads = 0);
+
 [[nodiscard]] SG_COMMON_EXPORT unique_c_buffer<std::byte>
 read(const std::filesystem::path& path,
              std::ios_base::openmode mode = std::ios::binary | std::ios::in);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "jthread.h"
+#include "buffer.h"
+#include <sg/export/common.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+
+namespace sg {
+
+namespace internal {
+class file_reader_source;
+}
+
+/**
+ * @brief       Reads a file sequentially in chunks, with read-ahead on a background thread
+ * @details     The background thread reads up to read_ahead chunks ahead of the consumer, so that
+ *              processing a chunk overlaps reading the next ones. Each chunk is a buffer of its own,
+ *              handed over to the consumer, which may keep it for as long as it likes.
+ *
+ *              On POSIX the kernel is told the file is read sequentially (posix_fadvise), and
+ *              optionally to drop the pages already read from the page cache, so that replaying a
+ *              file larger than memory does not evict everything else.
+ *
+ *              next(), seek() and position() must be called from one thread at a time.
+ */
+class SG_COMMON_EXPORT file_reader {
+   public:
+    typedef sg::shared_c_buffer<std::byte> buffer_type;
+    typedef std::filesystem::path path_type;
+
+    struct options_t {
+        size_t chunk_size{1024 * 1024};
+        /* chunks read ahead of the consumer, at least 1 */
+        size_t read_ahead{4};
+        /* POSIX only, POSIX_FADV_DONTNEED for everything before the chunk last returned */
+        bool drop_behind{false};
+    };
+
+    /** @throws std::runtime_error if the file can't be opened */
+    explicit file_reader(const path_type &path);
+    file_reader(const path_type &path, options_t options);
+    ~file_reader();
+
+    file_reader(const file_reader &) = delete;
+    file_reader &operator=(const file_reader &) = delete;
+
+    /**
+     * @brief returns the next chunk, waiting for it to be read if need be
+     * @details chunks are options_t::chunk_size, except the last one
+     * @return the chunk, or an empty buffer at the end of the file
+     * @throws std::runtime_error if reading failed, the next call tries the same chunk again
+     */
+    [[nodiscard]] buffer_type next();
+
+    /** @brief continues from offset, discarding anything read ahead */
+    void seek(uint64_t offset);
+
+    /** @brief offset of the next chunk next() returns */
+    [[nodiscard]] uint64_t position() const noexcept { return m_position; }
+
+    /** @brief size of the file when it was opened, a file truncated since is read to its new end */
+    [[nodiscard]] uint64_t size() const noexcept { return m_size; }
+
+   private:
+    options_t m_options;
+    std::unique_ptr<internal::file_reader_source> m_source;
+    uint64_t m_size{0};
+    uint64_t m_position{0};
+    uint64_t m_dropped{0};  // drop_behind, dropped from the page cache up to here
+
+    /* shared with the read-ahead thread */
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<buffer_type> m_chunks;
+    uint64_t m_read_offset{0};   // next offset the thread reads from
+    uint64_t m_generation{0};    // incremented by seek(), so that chunks read before it are dropped
+    std::exception_ptr m_error;
+    bool m_stopping{false};
+
+    std::jthread m_thread;
+
+    void action();
+};
+
+} // namespace sg
@@ -2,20 +2,40 @@
 
 #include "jthread.h"
 #include "buffer.h"
+#include "buffer_pool.h"
+#include "compression.h"
+#include "crc.h"
+#include "mpsc_queue.h"
 #include <sg/export/common.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <deque>
 #include <filesystem>
 #include <functional>
+#include <future>
 #include <semaphore>
 #include <string>
 #include <fstream>
-#include <mutex>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 
 
 namespace sg {
 
+class file_writer_service;
+
+namespace internal {
+class file_writer_backend;
+class frame_compressor;
+}
+
 /**
  * @brief       The file_writer class
  * @details     Note that the functions are generlly not thread safe, uless marked.
@@ -29,17 +49,187 @@ class SG_COMMON_EXPORT file_writer {
     typedef sg::shared_c_buffer<std::byte> buffer_type;
     typedef std::filesystem::path path_type;
 
+    /* A segment has been closed, with the given size, and can be e.g. compressed or shipped */
+    typedef std::function<void(file_writer *, const path_type &segment, size_t bytes)> segment_closed_cb_t;
+
+    enum class backend_t {
+        stream,   // writev() of each batch (std::fstream on Windows)
+        io_uring  // Linux io_uring, falls back to stream where it is not available
+    };
+
+    /* What write_async() does when pending_bytes() is at or over the high-water mark */
+    enum class overflow_t {
+        block,        // waits until the writer has caught up (only while it is running)
+        drop_newest,  // drops the new buffer, see dropped_count()
+        fail          // returns write_result_t::full, the caller decides
+    };
+
+    enum class write_result_t { queued, dropped, full };
+
+    /* What write_async_and_crc32c() returns: the crc is of the data, whether or not it was queued */
+    struct crc_write_result_t {
+        write_result_t result;
+        uint32_t crc;
+    };
+
+    /* When the data is made durable, i.e. flushed to disk with fdatasync() */
+    enum class durability_t {
+        none,         // only for write_async_durable(), sharing one sync per batch
+        periodic,     // every sync_interval, if anything was written
+        group_commit  // after every batch, i.e. everything queued while the previous sync ran
+    };
+
+    struct sync_stats_t {
+        size_t count{0};
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds max{0};
+        std::chrono::nanoseconds last{0};
+
+        [[nodiscard]] std::chrono::nanoseconds mean() const {
+            return count ? total / static_cast<int64_t>(count) : std::chrono::nanoseconds{0};
+        }
+    };
+
+    /* Counts of values in power-of-two buckets: bucket 0 counts zeros, bucket i values in
+     * [2^(i-1), 2^i) */
+    struct histogram_t {
+        std::array<uint64_t, 64> buckets{};
+
+        [[nodiscard]] uint64_t count() const noexcept {
+            uint64_t total{0};
+            for (auto n : buckets)
+                total += n;
+            return total;
+        }
+
+        /* upper bound of the bucket the q-quantile (0 to 1) is in, so within a factor of 2 */
+        [[nodiscard]] uint64_t quantile(double q) const noexcept {
+            auto total = count();
+            if (total == 0) return 0;
+            auto rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+            rank = std::clamp<uint64_t>(rank, 1, total);
+
+            uint64_t seen{0};
+            for (size_t i = 0; i < buckets.size(); ++i) {
+                seen += buckets[i];
+                if (seen >= rank) return i ? (uint64_t{1} << i) - 1 : 0;
+            }
+            return 0;
+        }
+    };
+
+    /* A snapshot of the write path, see stats(). Counts are since start() */
+    struct stats_t {
+        size_t queue_depth{0};
+        size_t pending_bytes{0};
+        /* most buffers and bytes queued at once, as seen by the writer each time it takes a batch,
+         * which is when the queue is at its longest */
+        size_t queue_depth_high{0};
+        size_t pending_bytes_high{0};
+
+        histogram_t batch_bytes;        // bytes taken from the queue at a time
+        histogram_t batch_buffers;      // buffers taken from the queue at a time
+        histogram_t write_latency_ns;   // from write_async() until written, one buffer in 16 sampled
+        histogram_t batch_latency_ns;   // writing a batch, not including syncs
+
+        size_t syscalls{0};
+        /* producers blocked by overflow_t::block at the high-water mark, all added up */
+        std::chrono::nanoseconds producer_stall{0};
+        /* writer thread waiting for data. Not counted with a file_writer_service */
+        std::chrono::nanoseconds writer_idle{0};
+
+        /* bytes written per second (before compression), over the last 1, 10 and 60 whole seconds */
+        double bytes_per_second_1s{0};
+        double bytes_per_second_10s{0};
+        double bytes_per_second_60s{0};
+
+        sync_stats_t sync;
+    };
+
+    struct options_t {
+        backend_t backend{backend_t::stream};
+
+        /* Most bytes that may be pending before write_async() applies the overflow policy. Tested
+         * before the new buffer is added, so a buffer larger than the mark still goes through when
+         * nothing is pending. With many producers at once it may be overshot by a buffer each */
+        size_t high_water_mark{0}; // 0 = unlimited
+        overflow_t overflow{overflow_t::block};
+
+        durability_t durability{durability_t::none};
+        std::chrono::milliseconds sync_interval{100}; // durability_t::periodic only
+
+        /* Compresses each batch as part of one stream, into CRC-checked frames that
+         * sg::compressed_file_reader reads (see sg/compressed_file_reader.h for the format).
+         * bytes_transferred() then counts the bytes in the file, i.e. compressed, while
+         * segment_size and the sizes given to on_segment_closed are before compression. Each
+         * segment is a stream of its own */
+        std::optional<compression::codec_type> compression;
+        std::optional<int> compression_level; // the codec's default if not set
+        /* Compresses on a helper thread, so that compressing a batch overlaps writing the previous
+         * one, rather than on the writer thread */
+        bool compress_on_helper_thread{false};
+
+        /* io_uring only. Buffers are copied into blocks of this size (rounded up to 4 KiB), which
+         * are registered with the kernel, and each full block is one write */
+        size_t block_size{1024 * 1024};
+        /* io_uring only. Most blocks being written at once */
+        size_t queue_depth{8};
+        /* io_uring only. Opens the file with O_DIRECT, if the filesystem supports it. A block is
+         * only written once full, or when the writer stops */
+        bool direct_io{false};
+
+        /* Segmented output. With either limit set, the path given to start() is the base name of
+         * numbered segments (see segment_path()), and a new segment is started, at a buffer
+         * boundary, when the next buffer would take the segment over segment_size bytes, or when
+         * the segment has been open for segment_interval. Buffers are never split, so a buffer
+         * larger than segment_size gets a segment to itself. Empty segments aren't rolled over.
+         *
+         * The next segment is opened in the background, ahead of time, and the closed one is
+         * closed there too, so that rolling over doesn't stall the writer thread. */
+        size_t segment_size{0};                       // 0 = no size limit
+        std::chrono::milliseconds segment_interval{0}; // 0 = no time limit
+        /* Reserves segment_size bytes on disk for each segment up front (Linux fallocate), so that
+         * the segments aren't fragmented and extending them doesn't update the metadata */
+        bool preallocate{true};
+        /* Called from the background thread, once the segment is closed, or from the writer thread
+         * for the last one */
+        segment_closed_cb_t on_segment_closed;
+
+        /* Written by the service's threads, shared with other writers, rather than a thread of its
+         * own. See sg/file_writer_service.h */
+        std::shared_ptr<file_writer_service> service;
+
+        /* Copies made by write_async(const U*, size_t), write_async(std::string_view) and friends
+         * come from this pool, rather than malloc. Must outlive the buffers, e.g.
+         * &sg::buffer_pool::global() */
+        sg::buffer_pool *buffer_pool{nullptr};
+    };
+
+    file_writer();
     ~file_writer();
 
     /**
      * @brief starts the writer
      * @details note that this is not thread-safe
+     * @throws std::runtime_error if already running, or if the file can't be opened
      */
     void start(path_type _path,
                error_cb_t on_error_cb,
                started_cb_t on_start_cb,
                stopped_cb_t on_stop_cb);
 
+    /**
+     * @brief starts the writer, with the given options
+     * @details note that this is not thread-safe
+     * @throws std::runtime_error if already running, or if the file can't be opened
+     * @throws std::invalid_argument if the compression codec isn't available
+     */
+    void start(path_type _path,
+               error_cb_t on_error_cb,
+               started_cb_t on_start_cb,
+               stopped_cb_t on_stop_cb,
+               options_t options);
+
     /**
      * @brief stops the writer and flushes the queue
      * @details note that this is not thread-safe
@@ -47,40 +237,303 @@ class SG_COMMON_EXPORT file_writer {
     void stop();
     [[nodiscard]] bool is_running() const;
 
+    /**
+     * @brief queues the buffer to be written
+     * @details thread safe, and lock-free unless the overflow policy is to block and the high-water
+     *          mark is reached
+     * @return queued, or what the overflow policy did with it
+     */
     template<typename U>
     requires std::convertible_to<U, buffer_type>
-    void write_async(U&& buff) {
-        std::lock_guard lock(m_mutex);
-        m_data.push_back(std::forward<U>(buff));
-        m_signal.release();
+    write_result_t write_async(U&& buff) {
+        if (auto result = admit(); result != write_result_t::queued) return result;
+        push(std::forward<U>(buff));
+        return write_result_t::queued;
     }
 
     template<typename U>
     requires std::is_trivially_copyable_v<U>
-    void write_async(const U* ptr,  size_t length) {
-        auto a = sg::make_shared_c_buffer<std::byte>(length*sizeof(U));
+    write_result_t write_async(const U* ptr,  size_t length) {
+        auto a = make_buffer(length * sizeof(U));
         std::memcpy(a.get(), ptr, length * sizeof(U));
-        write_async(std::move(a));
+        return write_async(std::move(a));
+    }
+
+    /**
+     * @brief as write_async(), but never blocks or drops: returns write_result_t::full if at or over
+     *        the high-water mark, whatever the overflow policy
+     * @details thread safe, lock-free
+     */
+    template<typename U>
+    requires std::convertible_to<U, buffer_type>
+    [[nodiscard]] write_result_t try_write_async(U&& buff) {
+        if (over_high_water_mark()) return write_result_t::full;
+        push(std::forward<U>(buff));
+        return write_result_t::queued;
+    }
+
+    /**
+     * @brief as write_async(const U*, size_t), and also returns the crc32c of the data, calculated
+     *        while copying it (see sg::checksum::copy_and_crc32c()) rather than in a second pass
+     * @details the data is subject to the overflow policy, as for write_async(): check the result
+     *          before relying on the crc being that of data in the file
+     * @param remainder remainder, as for sg::checksum::crc32c()
+     */
+    template<typename U>
+    requires std::is_trivially_copyable_v<U>
+    [[nodiscard]] crc_write_result_t write_async_and_crc32c(const U* ptr, size_t length,
+                                                            uint32_t remainder = 0) {
+        auto a = make_buffer(length * sizeof(U));
+        auto crc = sg::checksum::copy_and_crc32c(a.get(), ptr, length * sizeof(U), remainder);
+        return {write_async(std::move(a)), crc};
     }
 
-    void write_async(std::string_view view);
+    write_result_t write_async(std::string_view view);
+
+    /**
+     * @brief as write_async(), and returns a future that is ready once the data is durable
+     * @details all the durable writes pending when the writer thread syncs share the one sync,
+     *          whatever the durability mode: with durability_t::none they are synced after the
+     *          batch they are in, with periodic at the next period. The future holds an exception if
+     *          the buffer is dropped or refused by the overflow policy, if the writer isn't running,
+     *          or if writing or syncing fails; once a write fails, so do all the durable writes
+     *          still queued. Thread safe.
+     *
+     *          Note that on Windows the data is only flushed to the OS, not to disk.
+     */
+    template<typename U>
+    requires std::convertible_to<U, buffer_type>
+    [[nodiscard]] std::future<void> write_async_durable(U&& buff) {
+        std::promise<void> promise;
+        auto future = promise.get_future();
+        /* counted in, so that finish() waits for the push before failing what is left in the queue */
+        m_durable_pushers.fetch_add(1);
+        auto result = admit();
+        if (result != write_result_t::queued) {
+            promise.set_exception(std::make_exception_ptr(std::runtime_error(
+                result == write_result_t::dropped ? "file_writer: dropped, at the high-water mark"
+                                                  : "file_writer: full, at the high-water mark")));
+        } else if (!m_running.load()) {
+            promise.set_exception(std::make_exception_ptr(std::runtime_error("file_writer: not running")));
+        } else {
+            push(std::forward<U>(buff), std::move(promise));
+        }
+        m_durable_pushers.fetch_sub(1);
+        return future;
+    }
+
+    [[nodiscard]] std::future<void> write_async_durable(std::string_view view);
+
+    /** @brief latency of the syncs so far, to size sync_interval. Thread safe */
+    [[nodiscard]] sync_stats_t sync_stats() const noexcept;
+
+    /**
+     * @brief queueing, batching, latency and throughput of the writes, to tell whether the disk,
+     *        the writer or the producers are behind when the writer falls behind
+     * @details thread safe. Always on: recording costs a clock read per sampled buffer, and a few
+     *          relaxed atomic increments per batch. The snapshot is not atomic as a whole, so its parts may
+     *          be from slightly different moments
+     */
+    [[nodiscard]] stats_t stats() const noexcept;
 
     [[nodiscard]] size_t bytes_transferred() const;
+
+    /** @brief name of the backend in use, i.e. "writev", "stream" or "io_uring". Valid once started */
+    [[nodiscard]] const char *backend_name() const;
+
+    /**
+     * @brief number of system calls made to write the file, since started. Together with
+     *        bytes_transferred() this gives the syscalls per byte
+     * @details thread safe
+     */
+    [[nodiscard]] size_t syscall_count() const;
+
+    /**
+     * @brief bytes given to write_async() that are not written yet: those still queued, plus the
+     *        batch currently being written
+     * @details thread safe
+     */
+    [[nodiscard]] size_t pending_bytes() const noexcept;
+
+    /** @brief number of buffers queued, not including the batch being written. Thread safe */
+    [[nodiscard]] size_t queue_depth() const noexcept;
+
+    /** @brief number of buffers dropped by overflow_t::drop_newest. Thread safe */
+    [[nodiscard]] size_t dropped_count() const noexcept;
+
+    /**
+     * @brief path of the given segment, for segmented output: the index is added before the
+     *        extension, e.g. "rec.bin" gives "rec.000000.bin", "rec.000001.bin", ...
+     */
+    [[nodiscard]] static path_type segment_path(const path_type &path, size_t index);
 private:
-    std::binary_semaphore m_signal{0};
-    std::fstream m_file;
+    typedef std::unique_ptr<internal::file_writer_backend> backend_ptr;
+    backend_ptr m_backend;
+
+    path_type m_path;
+    options_t m_options;
+
+    struct queued_t {
+        buffer_type buffer;
+        std::optional<std::promise<void>> durable;
+        std::chrono::steady_clock::time_point queued_at; // if timed, see time_this_push()
+    };
+
+    /* durability, only used by the writer thread */
+    std::vector<std::promise<void>> m_durable;
+    std::exception_ptr m_error; // of the write that stopped the writer
+    size_t m_unsynced_bytes{0};
+    std::chrono::steady_clock::time_point m_last_sync;
+
+    std::atomic<size_t> m_sync_count{0};
+    std::atomic<int64_t> m_sync_total_ns{0};
+    std::atomic<int64_t> m_sync_max_ns{0};
+    std::atomic<int64_t> m_sync_last_ns{0};
+
+    /* compression, only used by the writer thread, and the helper thread while it compresses */
+    std::unique_ptr<internal::frame_compressor> m_compressor;
+    std::future<buffer_type> m_compressing;
+
+    /* segmented output, only used by the writer thread */
+    size_t m_segment_index{0};
+    size_t m_segment_bytes{0};
+    std::chrono::steady_clock::time_point m_segment_start;
+    /* closes the previous segment, and opens the next */
+    std::future<backend_ptr> m_next_backend;
 
     std::jthread m_thread;
 
+    /* written by a file_writer_service rather than m_thread. The state says whether the writer is
+     * waiting for a turn, and stops two threads from taking turns at once, see notify() */
+    friend class file_writer_service;
+    enum class service_state_t : uint8_t { idle, scheduled, running, notified, finished };
+    file_writer_service *m_service{nullptr};
+    std::atomic<service_state_t> m_service_state{service_state_t::idle};
+    std::atomic<bool> m_service_stopping{false};
+    std::promise<void> m_service_finished;
+    std::future<void> m_service_done;
+
     error_cb_t m_on_error_cb;
     stopped_cb_t m_on_stop_cb;
 
-    std::mutex m_mutex;
-    std::deque<buffer_type> m_data;
+    sg::mpsc_queue<queued_t> m_data;
+    std::atomic<size_t> m_queued_count{0};
+    std::atomic<size_t> m_queued_bytes{0};
+    std::atomic<size_t> m_writing_bytes{0};
+    std::atomic<size_t> m_dropped{0};
+
+    /* set by producers when there is new data, cleared by the writer thread before it takes it.
+     * The semaphore is only released when the flag is set, so it never goes over 1 */
+    std::atomic<bool> m_signal{false};
+    std::binary_semaphore m_wakeup{0};
+    /* bumped by the writer thread after each batch, for producers blocked on the high-water mark */
+    std::atomic<uint32_t> m_batches{0};
+    std::atomic<bool> m_running{false};
+    /* producers in write_async_durable(), see finish() */
+    std::atomic<size_t> m_durable_pushers{0};
 
     std::atomic<size_t> m_byte_count;
 
+    /* instrumentation, see stats(). Written by the writer thread, except for the producer stalls */
+    struct atomic_histogram_t {
+        std::array<std::atomic<uint64_t>, 64> buckets{};
+
+        void record(uint64_t value) noexcept;
+        void reset() noexcept;
+        [[nodiscard]] histogram_t load() const noexcept;
+    };
+    /* bytes written in each of the last seconds, by steady_clock seconds modulo the size */
+    struct rate_bucket_t {
+        std::atomic<int64_t> second{-1};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    std::atomic<size_t> m_syscalls{0};
+    std::atomic<size_t> m_queue_depth_high{0};
+    std::atomic<size_t> m_pending_bytes_high{0};
+    atomic_histogram_t m_batch_bytes;
+    atomic_histogram_t m_batch_buffers;
+    atomic_histogram_t m_write_latency;
+    atomic_histogram_t m_batch_latency;
+    std::atomic<int64_t> m_producer_stall_ns{0};
+    std::atomic<int64_t> m_writer_idle_ns{0};
+    std::array<rate_bucket_t, 64> m_rate;
+    std::vector<std::chrono::steady_clock::time_point> m_batch_queued_at; // writer thread only
+
+    /* true for one push in 16 on each thread: the clock is read for those only, as that can cost as
+     * much as the rest of the push */
+    static bool time_this_push() noexcept;
+    void record_rate(uint64_t bytes) noexcept;
+    void reset_stats() noexcept;
+
+    [[nodiscard]] bool over_high_water_mark() const noexcept {
+        return m_options.high_water_mark && pending_bytes() >= m_options.high_water_mark;
+    }
+    void wait_below_high_water_mark();
+
+    /* applies the overflow policy, queued meaning the buffer can be pushed */
+    write_result_t admit() {
+        if (over_high_water_mark()) {
+            switch (m_options.overflow) {
+            case overflow_t::block:
+                wait_below_high_water_mark();
+                break;
+            case overflow_t::drop_newest:
+                m_dropped.fetch_add(1, std::memory_order::relaxed);
+                return write_result_t::dropped;
+            case overflow_t::fail:
+                return write_result_t::full;
+            }
+        }
+        return write_result_t::queued;
+    }
+
+    /* for the copies made by write_async() */
+    [[nodiscard]] buffer_type make_buffer(size_t size) {
+        return m_options.buffer_pool ? m_options.buffer_pool->make_buffer(size)
+                                     : sg::make_shared_c_buffer<std::byte>(size);
+    }
+
+    template<typename U>
+    void push(U&& buff, std::optional<std::promise<void>> durable = std::nullopt) {
+        buffer_type buffer(std::forward<U>(buff));
+        /* counted before it can be taken, so the writer thread never takes away more than is counted */
+        m_queued_bytes.fetch_add(buffer.size(), std::memory_order::relaxed);
+        m_queued_count.fetch_add(1, std::memory_order::relaxed);
+        std::chrono::steady_clock::time_point queued_at{};
+        if (time_this_push()) queued_at = std::chrono::steady_clock::now();
+        m_data.push(queued_t{std::move(buffer), std::move(durable), queued_at});
+
+        notify();
+    }
+
+    void notify() {
+        if (m_service) {
+            notify_service();
+            return;
+        }
+        /* an exchange rather than a load, so that it is ordered with the writer thread clearing it */
+        if (!m_signal.exchange(true, std::memory_order::acq_rel))
+            m_wakeup.release();
+    }
+    void notify_service();
+
     void action(const std::stop_token &stop_tok);
+    /* one turn on a file_writer_service thread, returns true once the writer has finished */
+    bool service_turn(size_t max_bytes);
+    [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> next_deadline() const;
+    /* takes up to max_bytes queued (at least one buffer), writes and syncs them, false on failure */
+    bool write_queued(size_t max_bytes);
+    void finish();
+    void write_batch(std::deque<buffer_type> &batch);
+    void write_part(std::deque<buffer_type> &part);
+    void write_frame(buffer_type frame);
+    void flush_compression(bool finish);
+    void roll_over();
+    [[nodiscard]] bool sync_due() const;
+    void sync(bool complete_durable = true);
+    void fail_durable(const std::exception_ptr &error);
+    void fail_queued(const std::exception_ptr &error);
 };
 
 } // namespace sg
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "jthread.h"
+#include <sg/export/common.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace sg {
+
+class file_writer;
+
+/**
+ * @brief       A pool of threads that file_writers share, instead of a thread each
+ * @details     Meant for many files, each written to now and again, e.g. one per channel. A
+ *              file_writer uses the service when it is given one in options_t::service, and is
+ *              otherwise used as before: write_async() and friends are the same, as is stop().
+ *
+ *              Writers with data are served in turn, first come first served, and each turn
+ *              writes at most max_batch_bytes of the writer's queue (or one buffer, if larger)
+ *              before the writer goes to the back of the line. So one busy writer can't hold up the
+ *              others for long. A writer is only ever served by one thread at a time. Timers for
+ *              segment_interval and periodic durability are kept by the service.
+ *
+ *              The callbacks of the writers are called from the service's threads. Writers must be
+ *              stopped before the service is destroyed; as they keep a std::shared_ptr to it, that
+ *              is what happens unless the service is destroyed explicitly.
+ */
+class SG_COMMON_EXPORT file_writer_service {
+   public:
+    struct options_t {
+        size_t threads{1};
+        /* most bytes written for a writer in one turn */
+        size_t max_batch_bytes{1024 * 1024};
+    };
+
+    file_writer_service();
+    explicit file_writer_service(options_t options);
+    ~file_writer_service();
+
+    file_writer_service(const file_writer_service &) = delete;
+    file_writer_service &operator=(const file_writer_service &) = delete;
+
+    [[nodiscard]] size_t thread_count() const noexcept { return m_threads.size(); }
+
+    /** @brief writers started with this service, and not stopped yet. Thread safe */
+    [[nodiscard]] size_t writer_count() const;
+
+   private:
+    friend class file_writer;
+
+    options_t m_options;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<file_writer *> m_ready;
+    std::multimap<std::chrono::steady_clock::time_point, file_writer *> m_timers;
+    std::unordered_map<file_writer *, decltype(m_timers)::iterator> m_timer_of;
+    size_t m_writers{0};
+    bool m_stopping{false};
+
+    std::vector<std::jthread> m_threads;
+
+    /* called by file_writer */
+    void attach(file_writer *writer);
+    void notify(file_writer *writer);
+
+    void action();
+    void set_timer(file_writer *writer, std::optional<std::chrono::steady_clock::time_point> deadline);
+};
+
+} // namespace sg
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "buffer.h"
+
+#include <sg/export/common.h>
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace sg::checksum {
+
+/* Fast non-cryptographic hashing, compatible with XXH3 (xxHash 0.8), i.e. the same input and seed
+ * give the same hash as XXH3_64bits_withSeed() / XXH3_128bits_withSeed().
+ *
+ * Meant for deduplication, hash maps keyed by byte buffers and content addressing. Not meant for
+ * anything where an adversary picks the input. Long inputs go through SSE2, AVX2, AVX-512 or NEON,
+ * picked at runtime. */
+
+struct hash128_t {
+    uint64_t low64{0};
+    uint64_t high64{0};
+
+    auto operator<=>(const hash128_t &) const = default;
+};
+
+/**
+ * @brief Calculates the 64-bit XXH3 hash of the given data
+ *
+ * @param seed Seed, to get a different family of hashes. 0 gives the default XXH3 hash
+ */
+[[nodiscard]] SG_COMMON_EXPORT uint64_t xxh3_64(const void *data, std::size_t length, uint64_t seed = 0);
+
+/** @brief Calculates the 128-bit XXH3 hash of the given data, see xxh3_64() */
+[[nodiscard]] SG_COMMON_EXPORT hash128_t xxh3_128(const void *data, std::size_t length, uint64_t seed = 0);
+
+[[nodiscard]] inline uint64_t xxh3_64(const IBuffer<std::byte> &buffer, uint64_t seed = 0) {
+    return xxh3_64(buffer.get(), buffer.size(), seed);
+}
+
+[[nodiscard]] inline hash128_t xxh3_128(const IBuffer<std::byte> &buffer, uint64_t seed = 0) {
+    return xxh3_128(buffer.get(), buffer.size(), seed);
+}
+
+/** Name of the implementation xxh3_64() and xxh3_128() use on this machine, e.g. "avx2" */
+[[nodiscard]] SG_COMMON_EXPORT const char *xxh3_implementation();
+
+/**
+ * @brief Streaming XXH3, for data that arrives in parts
+ *
+ * Gives the same 64 and 128-bit hashes as xxh3_64() / xxh3_128() of all the parts one after the
+ * other, however the data is split. The state can be digested at any point, and then updated
+ * further.
+ */
+class SG_COMMON_EXPORT xxh3_state {
+  public:
+    explicit xxh3_state(uint64_t seed = 0);
+
+    /* Starts again, with the given seed */
+    void reset(uint64_t seed = 0);
+
+    void update(const void *data, std::size_t length);
+    void update(const IBuffer<std::byte> &buffer) { update(buffer.get(), buffer.size()); }
+
+    [[nodiscard]] uint64_t digest64() const;
+    [[nodiscard]] hash128_t digest128() const;
+
+  private:
+    void consume_stripes(uint64_t *acc, std::size_t &stripesSoFar, const uint8_t *input,
+                         std::size_t nbStripes) const;
+    void digest_long(uint64_t *acc) const;
+
+    alignas(64) uint64_t m_acc[8];
+    alignas(64) uint8_t m_secret[192];
+    alignas(64) uint8_t m_buffer[256];
+    std::size_t m_buffered{0};
+    std::size_t m_stripesSoFar{0};
+    uint64_t m_totalLength{0};
+    uint64_t m_seed{0};
+};
+
+/* Hash function object for containers keyed by byte buffers */
+struct xxh3_hasher {
+    [[nodiscard]] std::size_t operator()(std::span<const std::byte> bytes) const noexcept {
+        return static_cast<std::size_t>(xxh3_64(bytes.data(), bytes.size()));
+    }
+};
+
+} // namespace sg::checksum
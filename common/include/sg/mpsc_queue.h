@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace sg {
+
+/**
+ * @brief an unbounded, lock-free, multiple producer single consumer queue
+ * @details push() is wait-free (an allocation, and one atomic exchange) and may be called from any
+ * number of threads at once. try_pop() and empty() must only ever be called from one thread at a
+ * time, the consumer.
+ *
+ * A push that is under way when the consumer looks may not be seen until it has finished, i.e.
+ * try_pop() may briefly return nothing while a push is in progress. Consumers are expected to be
+ * woken by the producer after the push, as file_writer does, so this does not lose anything.
+ *
+ * This is Dmitry Vyukov's intrusive MPSC node queue.
+ */
+template <typename T>
+class mpsc_queue {
+    struct node {
+        std::atomic<node *> next{nullptr};
+        std::optional<T> value;
+    };
+
+    /* producers link new nodes after m_head, the consumer takes from after m_tail, which is
+     * always a node whose value has already been taken (or the initial, empty, node) */
+    alignas(64) std::atomic<node *> m_head;
+    alignas(64) node *m_tail;
+
+  public:
+    mpsc_queue() : m_head(new node), m_tail(m_head.load(std::memory_order::relaxed)) {}
+
+    mpsc_queue(const mpsc_queue &) = delete;
+    mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+    ~mpsc_queue() {
+        while (m_tail) {
+            auto next = m_tail->next.load(std::memory_order::relaxed);
+            delete m_tail;
+            m_tail = next;
+        }
+    }
+
+    template <typename U>
+    void push(U &&value) {
+        auto n = new node;
+        n->value.emplace(std::forward<U>(value));
+        auto prev = m_head.exchange(n, std::memory_order::acq_rel);
+        prev->next.store(n, std::memory_order::release);
+    }
+
+    /* consumer only */
+    [[nodiscard]] std::optional<T> try_pop() {
+        auto next = m_tail->next.load(std::memory_order::acquire);
+        if (next == nullptr) return std::nullopt;
+
+        std::optional<T> value(std::move(next->value));
+        next->value.reset();
+        delete std::exchange(m_tail, next);
+        return value;
+    }
+
+    /* consumer only */
+    [[nodiscard]] bool empty() const {
+        return m_tail->next.load(std::memory_order::acquire) == nullptr;
+    }
+};
+
+} // namespace sg
@@ -0,0 +1,349 @@
+#include "sg/buffer_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace sg {
+
+namespace {
+
+constexpr size_t MIN_BLOCK_SHIFT = 6; // 64 bytes
+
+/* Live pools by id, ids are never reused. Leaked on purpose, as threads may exit after static
+ * destruction */
+struct pool_registry {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, buffer_pool *> pools;
+    uint64_t next_id{1};
+};
+
+pool_registry &registry() {
+    static auto *instance = new pool_registry();
+    return *instance;
+}
+
+} // namespace
+
+/* The blocks cached by one thread for one pool. Only the owning thread touches the lists; the
+ * counters are read by stats() as well, so are atomics that the owner updates without a locked
+ * read-modify-write */
+struct buffer_pool::thread_cache {
+    std::vector<std::vector<void *>> free;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> unpooled{0};
+
+    thread_cache(size_t classes, size_t capacity) : free(classes) {
+        /* so that deallocate() never allocates */
+        for (auto &list : free) list.reserve(capacity);
+    }
+
+    static void increment(std::atomic<uint64_t> &counter) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void free_all() noexcept {
+        for (auto &list : free) {
+            for (auto *block : list) std::free(block);
+            list.clear();
+        }
+    }
+};
+
+/* A thread's caches, one per pool it has used. On exit they are handed back to their pools */
+struct buffer_pool_thread_caches {
+    struct entry {
+        uint64_t id;
+        buffer_pool *pool;
+        std::unique_ptr<buffer_pool::thread_cache> cache;
+    };
+    std::vector<entry> caches;
+
+    /* the cache last used, trivially destructible so reading it needs no guard */
+    static thread_local uint64_t last_id;
+    static thread_local buffer_pool::thread_cache *last_cache;
+
+    ~buffer_pool_thread_caches();
+
+    /* frees the caches of pools that are gone, with the registry locked */
+    void prune(const pool_registry &locked) noexcept {
+        std::erase_if(caches, [&](entry &e) {
+            if (locked.pools.contains(e.id)) return false;
+            e.cache->free_all();
+            return true;
+        });
+    }
+};
+
+namespace {
+thread_local buffer_pool_thread_caches t_caches;
+/* set once t_caches is destroyed, buffers freed by later thread_local destructors bypass the pool */
+thread_local bool t_caches_gone = false;
+} // namespace
+
+thread_local uint64_t buffer_pool_thread_caches::last_id = 0;
+thread_local buffer_pool::thread_cache *buffer_pool_thread_caches::last_cache = nullptr;
+
+buffer_pool_thread_caches::~buffer_pool_thread_caches() {
+    t_caches_gone = true;
+    last_id = 0;
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    for (auto &e : caches) {
+        if (r.pools.contains(e.id))
+            e.pool->retire(*e.cache);
+        else
+            e.cache->free_all();
+    }
+}
+
+/* The deleter of the buffers, stored in the shared_ptr's control block */
+struct buffer_pool::block_deleter {
+    buffer_pool *pool;
+    size_t size_class;
+
+    void operator()(std::byte *block) const noexcept { pool->deallocate(block, size_class); }
+};
+
+/* Allocates the shared_ptr's control block from the pool */
+template <typename T> struct buffer_pool::block_allocator {
+    typedef T value_type;
+
+    buffer_pool *pool;
+
+    explicit block_allocator(buffer_pool *p) noexcept : pool(p) {}
+    template <typename U> block_allocator(const block_allocator<U> &other) noexcept : pool(other.pool) {}
+
+    [[nodiscard]] T *allocate(size_t n) {
+        auto size = n * sizeof(T);
+        if (size > pool->m_options.max_size) return static_cast<T *>(memory::MallocOrThrow(size));
+        return static_cast<T *>(pool->allocate(size_class_of(size), false));
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        auto size = n * sizeof(T);
+        if (size > pool->m_options.max_size)
+            std::free(p);
+        else
+            pool->deallocate(p, size_class_of(size));
+    }
+
+    template <typename U> bool operator==(const block_allocator<U> &other) const noexcept {
+        return pool == other.pool;
+    }
+};
+
+buffer_pool::buffer_pool() : buffer_pool(options_t{}) {}
+
+buffer_pool::buffer_pool(options_t options) : m_options(options) {
+    m_options.max_size = std::max<size_t>(m_options.max_size, block_size(0));
+    m_options.thread_cache_blocks = std::max<size_t>(m_options.thread_cache_blocks, 1);
+    m_classes = size_class_of(m_options.max_size) + 1;
+    m_options.max_size = block_size(m_classes - 1);
+    m_shared = std::make_unique<shared_list[]>(m_classes);
+
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    m_id = r.next_id++;
+    r.pools.emplace(m_id, this);
+}
+
+buffer_pool::~buffer_pool() {
+    {
+        /* the caches of threads still running are freed by them, or when they next use a pool */
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.pools.erase(m_id);
+    }
+    trim();
+}
+
+buffer_pool &buffer_pool::global() {
+    static auto *instance = new buffer_pool();
+    return *instance;
+}
+
+size_t buffer_pool::size_class_of(size_t size) noexcept {
+    if (size <= block_size(0)) return 0;
+    return static_cast<size_t>(std::bit_width(size - 1)) - MIN_BLOCK_SHIFT;
+}
+
+size_t buffer_pool::block_size(size_t size_class) noexcept {
+    return size_t{1} << (size_class + MIN_BLOCK_SHIFT);
+}
+
+buffer_pool::buffer_type buffer_pool::make_buffer(size_t size) {
+    if (size > m_options.max_size) {
+        count_unpooled();
+        auto *ptr = static_cast<std::byte *>(memory::MallocOrThrow(size));
+        return {std::shared_ptr<std::byte[]>(ptr, deleter_free<std::byte>(), block_allocator<std::byte>(this)),
+                size};
+    }
+    auto size_class = size_class_of(size);
+    auto *ptr = static_cast<std::byte *>(allocate(size_class, true));
+    /* if the control block can't be allocated, the deleter is called */
+    return {std::shared_ptr<std::byte[]>(ptr, block_deleter{this, size_class}, block_allocator<std::byte>(this)),
+            size};
+}
+
+buffer_pool::buffer_type buffer_pool::make_buffer(const void *data, size_t size) {
+    auto buffer = make_buffer(size);
+    if (size) std::memcpy(buffer.get(), data, size);
+    return buffer;
+}
+
+buffer_pool::thread_cache &buffer_pool::local_cache() {
+    if (buffer_pool_thread_caches::last_id == m_id) return *buffer_pool_thread_caches::last_cache;
+
+    auto &caches = t_caches.caches;
+    for (auto &e : caches) {
+        if (e.id == m_id) {
+            buffer_pool_thread_caches::last_id = m_id;
+            buffer_pool_thread_caches::last_cache = e.cache.get();
+            return *e.cache;
+        }
+    }
+
+    /* first use of this pool on this thread */
+    auto cache = std::make_unique<thread_cache>(m_classes, m_options.thread_cache_blocks);
+    auto &r = registry();
+    std::lock_guard registry_lock(r.mutex);
+    t_caches.prune(r);
+    {
+        std::lock_guard lock(m_mutex);
+        m_caches.push_back(cache.get());
+    }
+    caches.push_back({m_id, this, std::move(cache)});
+    buffer_pool_thread_caches::last_id = m_id;
+    buffer_pool_thread_caches::last_cache = caches.back().cache.get();
+    return *caches.back().cache;
+}
+
+void *buffer_pool::allocate(size_t size_class, bool count) {
+    if (t_caches_gone) {
+        if (count) {
+            std::lock_guard lock(m_mutex);
+            ++m_retired.misses;
+        }
+        return memory::MallocOrThrow(block_size(size_class));
+    }
+
+    auto &cache = local_cache();
+    auto &list = cache.free[size_class];
+    if (list.empty()) refill(cache, size_class);
+    if (!list.empty()) {
+        if (count) thread_cache::increment(cache.hits);
+        auto *block = list.back();
+        list.pop_back();
+        return block;
+    }
+    if (count) thread_cache::increment(cache.misses);
+    return memory::MallocOrThrow(block_size(size_class));
+}
+
+void buffer_pool::deallocate(void *block, size_t size_class) noexcept {
+    if (t_caches_gone) {
+        std::free(block);
+        return;
+    }
+
+    thread_cache *cache;
+    try {
+        cache = &local_cache();
+    } catch (...) {
+        std::free(block);
+        return;
+    }
+    auto &list = cache->free[size_class];
+    if (list.size() >= m_options.thread_cache_blocks) spill(*cache, size_class);
+    list.push_back(block);
+}
+
+void buffer_pool::refill(thread_cache &cache, size_t size_class) {
+    auto &shared = m_shared[size_class];
+    auto &list = cache.free[size_class];
+    auto batch = std::max<size_t>(m_options.thread_cache_blocks / 2, 1);
+
+    std::lock_guard lock(shared.mutex);
+    auto n = std::min(batch, shared.blocks.size());
+    list.insert(list.end(), shared.blocks.end() - static_cast<ptrdiff_t>(n), shared.blocks.end());
+    shared.blocks.resize(shared.blocks.size() - n);
+}
+
+void buffer_pool::spill(thread_cache &cache, size_t size_class) noexcept {
+    auto &shared = m_shared[size_class];
+    auto &list = cache.free[size_class];
+    auto batch = std::min(std::max<size_t>(m_options.thread_cache_blocks / 2, 1), list.size());
+    auto max_blocks = m_options.shared_cache_bytes / block_size(size_class);
+
+    std::lock_guard lock(shared.mutex);
+    for (size_t i = 0; i < batch; ++i) {
+        auto *block = list.back();
+        list.pop_back();
+        if (shared.blocks.size() < max_blocks) {
+            try {
+                shared.blocks.push_back(block);
+                continue;
+            } catch (...) {
+            }
+        }
+        std::free(block);
+    }
+}
+
+void buffer_pool::count_unpooled() {
+    if (t_caches_gone) {
+        std::lock_guard lock(m_mutex);
+        ++m_retired.unpooled;
+        return;
+    }
+    thread_cache::increment(local_cache().unpooled);
+}
+
+void buffer_pool::retire(thread_cache &cache) noexcept {
+    {
+        std::lock_guard lock(m_mutex);
+        m_retired.hits += cache.hits.load(std::memory_order_relaxed);
+        m_retired.misses += cache.misses.load(std::memory_order_relaxed);
+        m_retired.unpooled += cache.unpooled.load(std::memory_order_relaxed);
+        std::erase(m_caches, &cache);
+    }
+    for (size_t size_class = 0; size_class < m_classes; ++size_class)
+        while (!cache.free[size_class].empty()) spill(cache, size_class);
+}
+
+buffer_pool::stats_t buffer_pool::stats() const {
+    stats_t result;
+    {
+        std::lock_guard lock(m_mutex);
+        result = m_retired;
+        for (const auto *cache : m_caches) {
+            result.hits += cache->hits.load(std::memory_order_relaxed);
+            result.misses += cache->misses.load(std::memory_order_relaxed);
+            result.unpooled += cache->unpooled.load(std::memory_order_relaxed);
+        }
+    }
+    result.shared_cached_bytes = 0;
+    for (size_t size_class = 0; size_class < m_classes; ++size_class) {
+        std::lock_guard lock(m_shared[size_class].mutex);
+        result.shared_cached_bytes += m_shared[size_class].blocks.size() * block_size(size_class);
+    }
+    return result;
+}
+
+void buffer_pool::trim() {
+    for (size_t size_class = 0; size_class < m_classes; ++size_class) {
+        std::vector<void *> blocks;
+        {
+            std::lock_guard lock(m_shared[size_class].mutex);
+            blocks.swap(m_shared[size_class].blocks);
+        }
+        for (auto *block : blocks) std::free(block);
+    }
+}
+
+} // namespace sg
@@ -0,0 +1,82 @@
+#include "sg/compressed_file_reader.h"
+#include "sg/crc.h"
+#include "include/file_frame.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace sg {
+
+compressed_file_reader::compressed_file_reader(const std::filesystem::path &path)
+    : m_file(path, std::ios::in | std::ios::binary) {
+    if (!m_file.is_open())
+        throw std::runtime_error(fmt::format("compressed_file_reader: could not open {}", path.string()));
+
+    m_decompressor = compression::create_decompressor([this](const std::byte *data, size_t size) {
+        m_output.insert(m_output.end(), data, data + size);
+    });
+}
+
+compressed_file_reader::~compressed_file_reader() = default;
+
+size_t compressed_file_reader::read(void *dst, size_t size) {
+    auto out = static_cast<std::byte *>(dst);
+    size_t count{0};
+    while (count < size) {
+        if (m_output_pos == m_output.size()) {
+            m_output.clear();
+            m_output_pos = 0;
+            /* a frame may decompress to nothing, e.g. the end of a zstd frame */
+            if (!next_frame()) break;
+            continue;
+        }
+
+        auto n = std::min(size - count, m_output.size() - m_output_pos);
+        std::memcpy(out + count, m_output.data() + m_output_pos, n);
+        m_output_pos += n;
+        count += n;
+    }
+    return count;
+}
+
+bool compressed_file_reader::next_frame() {
+    if (m_end) return false;
+
+    std::byte header[internal::FRAME_HEADER_SIZE];
+    m_file.read(reinterpret_cast<char *>(header), sizeof(header));
+    auto got = static_cast<size_t>(m_file.gcount());
+
+    uint32_t length{0}, crc{0};
+    if (got < sizeof(header) || !internal::read_frame_header(header, length, crc)) {
+        m_end = true;
+        m_truncated = got > 0;
+        return false;
+    }
+
+    m_payload.resize(length);
+    m_file.read(reinterpret_cast<char *>(m_payload.data()), length);
+    if (static_cast<size_t>(m_file.gcount()) < length || checksum::crc32c(m_payload.data(), length) != crc) {
+        m_end = true;
+        m_truncated = true;
+        return false;
+    }
+
+    m_decompressor->write(m_payload.data(), m_payload.size());
+    ++m_frames;
+    return true;
+}
+
+std::vector<std::byte> compressed_file_reader::read_all(const std::filesystem::path &path) {
+    compressed_file_reader reader(path);
+    std::vector<std::byte> data;
+    while (reader.next_frame()) {
+        data.insert(data.end(), reader.m_output.begin(), reader.m_output.end());
+        reader.m_output.clear();
+    }
+    return data;
+}
+
+} // namespace sg
@@ -0,0 +1,200 @@
+#include <sg/compression.h>
+#include <sg/memory.h>
+#include "include/compression_codecs.h"
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/* Magic numbers at the start of each frame, all stored little endian */
+constexpr uint32_t ZSTD_MAGIC = 0xFD2FB528;
+constexpr uint32_t LZ4_MAGIC = 0x184D2204;
+
+/* Skippable frames (0x184D2A50 to 0x184D2A5F) are shared by both formats. They are followed by a
+ * 4 byte frame size, and carry no data, e.g. the seek table of the zstd seekable format */
+constexpr uint32_t SKIPPABLE_MAGIC = 0x184D2A50;
+constexpr uint32_t SKIPPABLE_MAGIC_MASK = 0xFFFFFFF0;
+constexpr size_t SKIPPABLE_HEADER_SIZE = 8;
+
+uint32_t read_u32(const std::byte *src) {
+    return static_cast<uint32_t>(src[0]) | static_cast<uint32_t>(src[1]) << 8 |
+           static_cast<uint32_t>(src[2]) << 16 | static_cast<uint32_t>(src[3]) << 24;
+}
+
+enum class detect_result { found, need_more, unknown };
+
+/* Looks for the first frame that is not skippable, and reports whether there is enough data yet to
+ * tell which codec wrote it */
+detect_result detect(const void *src, size_t srcSize, sg::compression::codec_type &type) {
+    auto input = static_cast<const std::byte *>(src);
+
+    while (true) {
+        if (srcSize < 4)
+            return detect_result::need_more;
+
+        auto magic = read_u32(input);
+        if (magic == ZSTD_MAGIC) {
+            type = sg::compression::codec_type::zstd;
+            return detect_result::found;
+        }
+        if (magic == LZ4_MAGIC) {
+            type = sg::compression::codec_type::lz4;
+            return detect_result::found;
+        }
+        if ((magic & SKIPPABLE_MAGIC_MASK) != SKIPPABLE_MAGIC)
+            return detect_result::unknown;
+
+        if (srcSize < SKIPPABLE_HEADER_SIZE)
+            return detect_result::need_more;
+
+        auto frameSize = SKIPPABLE_HEADER_SIZE + read_u32(input + 4);
+        if (srcSize < frameSize)
+            return detect_result::need_more;
+
+        input += frameSize;
+        srcSize -= frameSize;
+    }
+}
+
+const sg::compression::ICodec &detected_codec(const void *src, size_t srcSize) {
+    auto type = sg::compression::detect_codec(src, srcSize);
+    if (!type)
+        throw std::runtime_error("given data was not compressed by a known codec");
+    if (!sg::compression::is_available(*type))
+        throw std::runtime_error("given data was compressed by a codec libsg was built without");
+
+    return sg::compression::codec(*type);
+}
+
+/* Buffers the first bytes written, until the codec can be detected */
+class auto_stream_decompressor final : public sg::compression::IStreamDecompressor {
+    sg::compression::output_cb_t m_output;
+    std::vector<std::byte> m_header;
+    std::unique_ptr<sg::compression::IStreamDecompressor> m_decompressor;
+
+  public:
+    explicit auto_stream_decompressor(sg::compression::output_cb_t output)
+        : m_output(std::move(output)) {}
+
+    void write(const void *src, size_t srcSize) override {
+        if (m_decompressor) {
+            m_decompressor->write(src, srcSize);
+            return;
+        }
+
+        auto input = static_cast<const std::byte *>(src);
+        m_header.insert(m_header.end(), input, input + srcSize);
+
+        sg::compression::codec_type type{};
+        switch (detect(m_header.data(), m_header.size(), type)) {
+        case detect_result::need_more:
+            return;
+        case detect_result::unknown:
+            throw std::runtime_error("given data was not compressed by a known codec");
+        case detect_result::found:
+            break;
+        }
+
+        if (!sg::compression::is_available(type))
+            throw std::runtime_error("given data was compressed by a codec libsg was built without");
+
+        m_decompressor = sg::compression::codec(type).create_decompressor(m_output);
+        m_decompressor->write(m_header.data(), m_header.size());
+
+        m_header.clear();
+        m_header.shrink_to_fit();
+    }
+};
+
+} // namespace
+
+namespace sg::compression {
+
+bool is_available(codec_type type) noexcept {
+    switch (type) {
+#ifdef LIBSG_ZSTD
+    case codec_type::zstd:
+        return true;
+#endif
+#ifdef LIBSG_LZ4
+    case codec_type::lz4:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const ICodec &codec(codec_type type) {
+    switch (type) {
+#ifdef LIBSG_ZSTD
+    case codec_type::zstd:
+        return internal::zstd_codec();
+#endif
+#ifdef LIBSG_LZ4
+    case codec_type::lz4:
+        return internal::lz4_codec();
+#endif
+    default:
+        throw std::invalid_argument(
+            fmt::format("libsg was built without codec {}", static_cast<int>(type)));
+    }
+}
+
+std::optional<codec_type> detect_codec(const void *src, size_t srcSize) noexcept {
+    codec_type type{};
+    if (detect(src, srcSize, type) != detect_result::found)
+        return std::nullopt;
+    return type;
+}
+
+unique_c_buffer<std::byte> compress(codec_type type, const void *src, size_t srcSize, int cLevel) {
+    const auto &c = codec(type);
+
+    /* Create intermediate buffer */
+    auto cBuffSize = c.get_max_compressed_size(srcSize);
+    auto cBuff = sg::make_unique_c_buffer<std::byte>(cBuffSize);
+
+    /* Compress */
+    auto cSize = c.compress(src, srcSize, cBuff.get(), cBuffSize, cLevel);
+
+    /* Reallocate buffer */
+    auto newPtr = sg::memory::ReallocOrFreeAndThrow(cBuff.release(), cSize);
+
+    return sg::unique_c_buffer<std::byte>(static_cast<std::byte *>(newPtr), cSize);
+}
+
+unique_c_buffer<std::byte> compress(codec_type type, const void *src, size_t srcSize) {
+    return compress(type, src, srcSize, codec(type).default_compression_level());
+}
+
+unique_c_buffer<std::byte> decompress(const void *src, size_t srcSize) {
+    const auto &c = detected_codec(src, srcSize);
+
+    if (auto size = c.get_uncompressed_size(src, srcSize)) {
+        auto output = sg::make_unique_c_buffer<std::byte>(*size);
+        c.decompress(src, srcSize, output.get(), *size);
+        return output;
+    }
+
+    /* Size not recorded (e.g. written by a streaming compressor), so decompress in chunks */
+    std::vector<std::byte> data;
+    auto decompressor = c.create_decompressor(
+        [&data](const std::byte *chunk, size_t size) { data.insert(data.end(), chunk, chunk + size); });
+    decompressor->write(src, srcSize);
+
+    auto output = sg::make_unique_c_buffer<std::byte>(data.size());
+    std::memcpy(output.get(), data.data(), data.size());
+    return output;
+}
+
+std::unique_ptr<IStreamDecompressor> create_decompressor(output_cb_t output) {
+    return std::make_unique<auto_stream_decompressor>(std::move(output));
+}
+
+} // namespace sg::compression
@@ -0,0 +1,288 @@
+#include "include/compression_codecs.h"
+
+#include <lz4frame.h>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#define LZ4F_THROW_ON_ERROR(fn)                                                    \
+    do {                                                                           \
+        size_t const err = (fn);                                                   \
+        if (LZ4F_isError(err)) throw std::runtime_error(LZ4F_getErrorName(err));   \
+    } while (0)
+
+namespace {
+
+/* LZ4 has no "levels" below 0, instead negative levels select increasingly fast "acceleration"
+ * modes. Levels above 2 use LZ4HC */
+constexpr int LZ4_MIN_LEVEL = -65537; // -LZ4_ACCELERATION_MAX
+constexpr int LZ4_MAX_LEVEL = 12;     // LZ4HC_CLEVEL_MAX
+
+/* See lz4_Frame_format.md. Every frame ends with an empty block, and each block starts with its 4
+ * byte size, whose top bit flags uncompressed data */
+constexpr uint32_t SKIPPABLE_MAGIC = 0x184D2A50;
+constexpr uint32_t SKIPPABLE_MAGIC_MASK = 0xFFFFFFF0;
+constexpr size_t SKIPPABLE_HEADER_SIZE = 8;
+constexpr uint32_t BLOCK_SIZE_MASK = 0x7FFFFFFF;
+constexpr size_t CHECKSUM_SIZE = 4;
+
+uint32_t read_u32(const std::byte *src) {
+    return static_cast<uint32_t>(src[0]) | static_cast<uint32_t>(src[1]) << 8 |
+           static_cast<uint32_t>(src[2]) << 16 | static_cast<uint32_t>(src[3]) << 24;
+}
+
+/* Size of the frame at the start of src, whose header, of headerSize bytes, was read into info */
+size_t frame_size(const std::byte *src, size_t srcSize, size_t headerSize,
+                  const LZ4F_frameInfo_t &info) {
+    auto blockChecksum = info.blockChecksumFlag == LZ4F_blockChecksumEnabled ? CHECKSUM_SIZE : 0;
+    auto size = headerSize;
+    while (true) {
+        if (srcSize - size < 4)
+            throw std::runtime_error("LZ4 data is truncated");
+        auto blockSize = read_u32(src + size) & BLOCK_SIZE_MASK;
+        size += 4;
+        if (blockSize == 0)
+            break;
+        if (srcSize - size < blockSize + blockChecksum)
+            throw std::runtime_error("LZ4 data is truncated");
+        size += blockSize + blockChecksum;
+    }
+    if (info.contentChecksumFlag == LZ4F_contentChecksumEnabled)
+        size += CHECKSUM_SIZE;
+    if (size > srcSize)
+        throw std::runtime_error("LZ4 data is truncated");
+    return size;
+}
+
+struct compression_context_deleter {
+    void operator()(LZ4F_cctx *ctx) { LZ4F_freeCompressionContext(ctx); }
+};
+struct decompression_context_deleter {
+    void operator()(LZ4F_dctx *ctx) { LZ4F_freeDecompressionContext(ctx); }
+};
+
+std::unique_ptr<LZ4F_dctx, decompression_context_deleter> create_decompression_context() {
+    LZ4F_dctx *ctx = nullptr;
+    LZ4F_THROW_ON_ERROR(LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION));
+    return std::unique_ptr<LZ4F_dctx, decompression_context_deleter>(ctx);
+}
+
+LZ4F_dctx *decompression_context() {
+    thread_local auto ctx = create_decompression_context();
+
+    /* might have been left mid-frame by an earlier error */
+    LZ4F_resetDecompressionContext(ctx.get());
+    return ctx.get();
+}
+
+LZ4F_preferences_t preferences(int cLevel, size_t contentSize) {
+    LZ4F_preferences_t prefs{};
+    prefs.compressionLevel = cLevel;
+    prefs.frameInfo.contentSize = contentSize;
+    return prefs;
+}
+
+class lz4_stream_compressor final : public sg::compression::IStreamCompressor {
+    std::unique_ptr<LZ4F_cctx, compression_context_deleter> m_ctx;
+    sg::compression::output_cb_t m_output;
+    LZ4F_preferences_t m_prefs;
+    std::vector<std::byte> m_buffer;
+    bool m_in_frame{false};
+
+    /* LZ4F output functions need enough space for the worst case, grow the buffer if needed */
+    std::byte *buffer(size_t size) {
+        if (m_buffer.size() < size)
+            m_buffer.resize(size);
+        return m_buffer.data();
+    }
+
+    void emit(size_t size) {
+        LZ4F_THROW_ON_ERROR(size);
+        if (size)
+            m_output.invoke(m_buffer.data(), size);
+    }
+
+    void begin_frame() {
+        if (m_in_frame)
+            return;
+        emit(LZ4F_compressBegin(m_ctx.get(), buffer(LZ4F_HEADER_SIZE_MAX), LZ4F_HEADER_SIZE_MAX,
+                                &m_prefs));
+        m_in_frame = true;
+    }
+
+  public:
+    lz4_stream_compressor(int cLevel, sg::compression::output_cb_t output)
+        : m_output(std::move(output)),
+          m_prefs(preferences(cLevel, 0)) {
+        LZ4F_cctx *ctx = nullptr;
+        LZ4F_THROW_ON_ERROR(LZ4F_createCompressionContext(&ctx, LZ4F_VERSION));
+        m_ctx.reset(ctx);
+    }
+
+    void write(const void *src, size_t srcSize) override {
+        begin_frame();
+
+        auto bound = LZ4F_compressBound(srcSize, &m_prefs);
+        emit(LZ4F_compressUpdate(m_ctx.get(), buffer(bound), bound, src, srcSize, nullptr));
+    }
+
+    void flush() override {
+        if (!m_in_frame)
+            return;
+
+        auto bound = LZ4F_compressBound(0, &m_prefs);
+        emit(LZ4F_flush(m_ctx.get(), buffer(bound), bound, nullptr));
+    }
+
+    void finish() override {
+        begin_frame();
+
+        auto bound = LZ4F_compressBound(0, &m_prefs);
+        emit(LZ4F_compressEnd(m_ctx.get(), buffer(bound), bound, nullptr));
+        m_in_frame = false;
+    }
+};
+
+class lz4_stream_decompressor final : public sg::compression::IStreamDecompressor {
+    std::unique_ptr<LZ4F_dctx, decompression_context_deleter> m_ctx;
+    sg::compression::output_cb_t m_output;
+    std::vector<std::byte> m_buffer;
+
+  public:
+    explicit lz4_stream_decompressor(sg::compression::output_cb_t output)
+        : m_ctx(create_decompression_context()),
+          m_output(std::move(output)),
+          m_buffer(64 * 1024) {}
+
+    void write(const void *src, size_t srcSize) override {
+        auto input = static_cast<const std::byte *>(src);
+
+        /* keep going while there is input, or while the output buffer is being filled */
+        bool outputFull = false;
+        while (srcSize || outputFull) {
+            size_t read = srcSize;
+            size_t written = m_buffer.size();
+            LZ4F_THROW_ON_ERROR(
+                LZ4F_decompress(m_ctx.get(), m_buffer.data(), &written, input, &read, nullptr));
+
+            if (written)
+                m_output.invoke(m_buffer.data(), written);
+
+            input += read;
+            srcSize -= read;
+            outputFull = written == m_buffer.size();
+        }
+    }
+};
+
+class lz4_codec_impl final : public sg::compression::ICodec {
+  public:
+    [[nodiscard]] sg::compression::codec_type type() const noexcept override {
+        return sg::compression::codec_type::lz4;
+    }
+
+    [[nodiscard]] int default_compression_level() const override { return 0; }
+
+    [[nodiscard]] std::pair<int, int> bounds_compression_level() const override {
+        return {LZ4_MIN_LEVEL, LZ4_MAX_LEVEL};
+    }
+
+    [[nodiscard]] size_t get_max_compressed_size(size_t srcSize) const override {
+        auto prefs = preferences(0, srcSize);
+        return LZ4F_compressFrameBound(srcSize, &prefs);
+    }
+
+    [[nodiscard]] std::optional<size_t> get_uncompressed_size(const void *src,
+                                                              size_t srcSize) const override {
+        /* the sum over all the frames, as decompress() carries on through concatenated frames */
+        auto input = static_cast<const std::byte *>(src);
+        size_t total{0};
+        bool found{false};
+        while (srcSize || !found) {
+            if (srcSize >= SKIPPABLE_HEADER_SIZE &&
+                (read_u32(input) & SKIPPABLE_MAGIC_MASK) == SKIPPABLE_MAGIC) {
+                auto skip = SKIPPABLE_HEADER_SIZE + read_u32(input + 4);
+                if (skip > srcSize)
+                    throw std::runtime_error("LZ4 data is truncated");
+                input += skip;
+                srcSize -= skip;
+                continue;
+            }
+
+            LZ4F_frameInfo_t info{};
+            size_t headerSize = srcSize;
+            LZ4F_THROW_ON_ERROR(
+                LZ4F_getFrameInfo(decompression_context(), &info, input, &headerSize));
+
+            /* 0 means that the frame does not record the size */
+            if (info.contentSize == 0)
+                return std::nullopt;
+            total += info.contentSize;
+            found = true;
+
+            auto size = frame_size(input, srcSize, headerSize, info);
+            input += size;
+            srcSize -= size;
+        }
+        return total;
+    }
+
+    [[nodiscard]] size_t compress(const void *src, size_t srcSize, void *dst, size_t dstSize,
+                                  int cLevel) const override {
+        /* record the size, so that decompress() knows how big a buffer to allocate */
+        auto prefs = preferences(cLevel, srcSize);
+
+        auto size = LZ4F_compressFrame(dst, dstSize, src, srcSize, &prefs);
+        LZ4F_THROW_ON_ERROR(size);
+        return size;
+    }
+
+    void decompress(const void *src, size_t srcSize, void *dst,
+                    size_t uncompressedSize) const override {
+        auto ctx = decompression_context();
+        auto input = static_cast<const std::byte *>(src);
+        auto output = static_cast<std::byte *>(dst);
+
+        while (srcSize) {
+            size_t read = srcSize;
+            size_t written = uncompressedSize;
+            auto hint = LZ4F_decompress(ctx, output, &written, input, &read, nullptr);
+            LZ4F_THROW_ON_ERROR(hint);
+
+            input += read;
+            srcSize -= read;
+            output += written;
+            uncompressedSize -= written;
+
+            if (hint != 0 && read == 0 && written == 0)
+                throw std::runtime_error("LZ4 output buffer is too small");
+            if (hint != 0 && srcSize == 0)
+                throw std::runtime_error("LZ4 data is truncated");
+        }
+
+        if (uncompressedSize != 0)
+            throw std::runtime_error("LZ4 data is smaller than expected");
+    }
+
+    [[nodiscard]] std::unique_ptr<sg::compression::IStreamCompressor>
+    create_compressor(int cLevel, sg::compression::output_cb_t output) const override {
+        return std::make_unique<lz4_stream_compressor>(cLevel, std::move(output));
+    }
+
+    [[nodiscard]] std::unique_ptr<sg::compression::IStreamDecompressor>
+    create_decompressor(sg::compression::output_cb_t output) const override {
+        return std::make_unique<lz4_stream_decompressor>(std::move(output));
+    }
+};
+
+} // namespace
+
+namespace sg::compression::internal {
+
+const ICodec &lz4_codec() {
+    static const lz4_codec_impl codec;
+    return codec;
+}
+
+} // namespace sg::compression::internal
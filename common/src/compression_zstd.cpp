@@ -1,9 +1,19 @@
 #include <sg/compression_zstd.h>
+#include "include/compression_codecs.h"
+
+/* needed for ZSTD_createCDict_byReference() and ZSTD_createDDict_byReference() */
+#define ZSTD_STATIC_LINKING_ONLY
 #include <zstd.h>
+#include <zdict.h>
 
 #include <cstring>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 #define ZSTD_THROW_ON_ERROR(fn)                                                  \
     do {                                                                         \
@@ -19,26 +29,178 @@ struct compression_context_deleter {
 struct decompression_context_deleter {
     void operator()(ZSTD_DCtx *ctx) { ZSTD_freeDCtx(ctx); }
 };
+struct cdict_deleter {
+    void operator()(ZSTD_CDict *dict) { ZSTD_freeCDict(dict); }
+};
+struct ddict_deleter {
+    void operator()(ZSTD_DDict *dict) { ZSTD_freeDDict(dict); }
+};
 
-}
-
-namespace sg::compression::zstd {
-
-size_t compress(const void *src, size_t srcSize, void *dst, size_t dstSize, int cLevel, int noThreads) {
+/* Contexts are expensive to create, so each thread keeps one of each */
+ZSTD_CCtx* compression_context() {
     thread_local auto comp_context = []() {
         auto ctx = ZSTD_createCCtx();
         if (ctx == nullptr)
             throw std::bad_alloc();
         return std::unique_ptr<ZSTD_CCtx, compression_context_deleter>(ctx);
     }();
+    return comp_context.get();
+}
+
+ZSTD_DCtx* decompression_context() {
+    thread_local auto decomp_context = []() {
+        auto ctx = ZSTD_createDCtx();
+        if (ctx == nullptr)
+            throw std::bad_alloc();
+        return std::unique_ptr<ZSTD_DCtx, decompression_context_deleter>(ctx);
+    }();
+    return decomp_context.get();
+}
+
+}
+
+namespace sg::compression::zstd {
+
+/************************** Dictionaries ***************************/
+
+struct dictionary::impl {
+    sg::shared_c_buffer<std::byte> content;
+    unsigned id;
+    std::unique_ptr<ZSTD_DDict, ddict_deleter> ddict;
+
+    /* one digested dictionary per compression level, created on first use */
+    std::shared_mutex cdict_mutex;
+    std::map<int, std::unique_ptr<ZSTD_CDict, cdict_deleter>> cdicts;
+
+    explicit impl(sg::shared_c_buffer<std::byte> _content)
+        : content(std::move(_content)),
+          id(ZSTD_getDictID_fromDict(content.get(), content.size())),
+          ddict(ZSTD_createDDict_byReference(content.get(), content.size())) {
+        if (!ddict)
+            throw std::runtime_error("could not load zstd dictionary");
+    }
+
+    const ZSTD_CDict* cdict(int level) {
+        {
+            std::shared_lock lock(cdict_mutex);
+            if (auto it = cdicts.find(level); it != cdicts.end())
+                return it->second.get();
+        }
+
+        std::unique_lock lock(cdict_mutex);
+        auto& dict = cdicts[level];
+        if (!dict) {
+            dict.reset(ZSTD_createCDict_byReference(content.get(), content.size(), level));
+            if (!dict)
+                throw std::runtime_error("could not load zstd dictionary");
+        }
+        return dict.get();
+    }
+};
+
+struct dictionary_access {
+    static const ZSTD_CDict* cdict(const dictionary& dict, int level) {
+        return dict.m_impl->cdict(level);
+    }
+    static const ZSTD_DDict* ddict(const dictionary& dict) { return dict.m_impl->ddict.get(); }
+
+    /* Live dictionaries, by dictionary ID. Weak, so that a dictionary is freed once the user
+     * drops the last copy of it */
+    static std::mutex registry_mutex;
+    static std::unordered_map<unsigned, std::weak_ptr<dictionary::impl>> registry;
+
+    static std::shared_ptr<dictionary::impl> find(unsigned id) {
+        if (auto it = registry.find(id); it != registry.end())
+            return it->second.lock();
+        return nullptr;
+    }
+
+    static std::optional<dictionary> find_dictionary(unsigned id) {
+        std::lock_guard lock(registry_mutex);
+        if (auto impl = find(id))
+            return dictionary(std::move(impl));
+        return std::nullopt;
+    }
+
+    static std::shared_ptr<dictionary::impl> load(sg::shared_c_buffer<std::byte> content) {
+        auto id = ZSTD_getDictID_fromDict(content.get(), content.size());
+        if (id == 0)
+            return std::make_shared<dictionary::impl>(std::move(content));
+
+        std::lock_guard lock(registry_mutex);
+
+        /* reuse the digested dictionaries if the same dictionary is already loaded */
+        if (auto existing = find(id))
+            if (existing->content.size() == content.size() &&
+                std::memcmp(existing->content.get(), content.get(), content.size()) == 0)
+                return existing;
+
+        auto result = std::make_shared<dictionary::impl>(std::move(content));
+        registry[id] = result;
+
+        std::erase_if(registry, [](const auto& item) { return item.second.expired(); });
+        return result;
+    }
+};
+
+std::mutex dictionary_access::registry_mutex;
+std::unordered_map<unsigned, std::weak_ptr<dictionary::impl>> dictionary_access::registry;
+
+dictionary::dictionary(sg::shared_c_buffer<std::byte> content)
+    : m_impl(dictionary_access::load(std::move(content))) {}
+
+dictionary::dictionary(std::shared_ptr<impl> impl) : m_impl(std::move(impl)) {}
+
+unsigned dictionary::id() const noexcept { return m_impl->id; }
+
+const sg::shared_c_buffer<std::byte>& dictionary::content() const noexcept {
+    return m_impl->content;
+}
+
+dictionary train_dictionary(const void* samples, const size_t* sampleSizes, unsigned noSamples,
+                            size_t maxDictSize) {
+    auto dictBuff = sg::make_unique_c_buffer<std::byte>(maxDictSize);
+
+    auto dictSize =
+        ZDICT_trainFromBuffer(dictBuff.get(), maxDictSize, samples, sampleSizes, noSamples);
+    if (ZDICT_isError(dictSize))
+        throw std::runtime_error(ZDICT_getErrorName(dictSize));
+
+    /* Reallocate buffer */
+    auto newPtr = sg::memory::ReallocOrFreeAndThrow(dictBuff.release(), dictSize);
+
+    return dictionary(sg::shared_c_buffer<std::byte>(static_cast<std::byte*>(newPtr), dictSize));
+}
+
+std::optional<dictionary> find_dictionary(unsigned id) {
+    return dictionary_access::find_dictionary(id);
+}
+
+unsigned get_dictionary_id(const void* src, size_t src_size) {
+    return ZSTD_getDictID_fromFrame(src, src_size);
+}
+
+/********************** Compression functions **********************/
+
+size_t compress(const void *src, size_t srcSize, void *dst, size_t dstSize, int cLevel, int noThreads) {
+    auto comp_context = compression_context();
 
     /* Set parameters */
-    ZSTD_THROW_ON_ERROR(ZSTD_CCtx_setParameter(comp_context.get(), ZSTD_c_nbWorkers, noThreads));
+    ZSTD_THROW_ON_ERROR(ZSTD_CCtx_setParameter(comp_context, ZSTD_c_nbWorkers, noThreads));
     ZSTD_THROW_ON_ERROR(
-        ZSTD_CCtx_setParameter(comp_context.get(), ZSTD_c_compressionLevel, cLevel));
+        ZSTD_CCtx_setParameter(comp_context, ZSTD_c_compressionLevel, cLevel));
 
     /* Compress */
-    auto cSize = ZSTD_compress2(comp_context.get(), dst, dstSize, src, srcSize);
+    auto cSize = ZSTD_compress2(comp_context, dst, dstSize, src, srcSize);
+    ZSTD_THROW_ON_ERROR(cSize);
+
+    return cSize;
+}
+
+size_t compress(const void *src, size_t srcSize, void *dst, size_t dstSize, const dictionary& dict, int cLevel) {
+    /* ZSTD_compress_usingCDict() ignores (and leaves alone) the parameters set on the context */
+    auto cSize = ZSTD_compress_usingCDict(compression_context(), dst, dstSize, src, srcSize,
+                                          dictionary_access::cdict(dict, cLevel));
     ZSTD_THROW_ON_ERROR(cSize);
 
     return cSize;
@@ -61,13 +223,36 @@ unique_c_buffer<std::byte> compress(const void *src,
     return sg::unique_c_buffer<std::byte>(static_cast<std::byte *>(newPtr), cSize);
 }
 
+unique_c_buffer<std::byte> compress(const void *src,
+                                    size_t srcSize,
+                                    const dictionary& dict,
+                                    int compressionLevel) {
+    /* Create intermediate buffer */
+    auto cBuffSize = get_max_compressed_size(srcSize);
+    auto cBuff = sg::make_unique_c_buffer<uint8_t>(cBuffSize);
+
+    /* Compress */
+    auto cSize = compress(src, srcSize, cBuff.get(), cBuffSize, dict, compressionLevel);
 
-void decompress(const void *src, size_t srcSize, void* dst, size_t uncompressedSize) {
-    thread_local auto decomp_context =
-        std::unique_ptr<ZSTD_DCtx, decompression_context_deleter>(ZSTD_createDCtx());
+    /* Reallocate buffer */
+    auto newPtr = sg::memory::ReallocOrFreeAndThrow(cBuff.release(), cSize);
+
+    return sg::unique_c_buffer<std::byte>(static_cast<std::byte *>(newPtr), cSize);
+}
+
+/********************** Decompression functions **********************/
+
+size_t decompress(const void *src, size_t srcSize, void* dst, size_t uncompressedSize) {
+    auto size = ZSTD_decompressDCtx(decompression_context(), dst, uncompressedSize, src, srcSize);
+    ZSTD_THROW_ON_ERROR(size);
+    return size;
+}
 
-    ZSTD_THROW_ON_ERROR(ZSTD_decompressDCtx(
-        decomp_context.get(), dst, uncompressedSize, src, srcSize));
+size_t decompress(const void *src, size_t srcSize, void* dst, size_t uncompressedSize, const dictionary& dict) {
+    auto size = ZSTD_decompress_usingDDict(decompression_context(), dst, uncompressedSize, src, srcSize,
+                                           dictionary_access::ddict(dict));
+    ZSTD_THROW_ON_ERROR(size);
+    return size;
 }
 
 
@@ -82,13 +267,23 @@ unique_c_buffer<std::byte> decompress(const void *src, size_t srcSize) {
     return output;
 }
 
+unique_c_buffer<std::byte> decompress(const void *src, size_t srcSize, const dictionary& dict) {
+    auto unCompressedSize = get_uncompressed_size(src, srcSize);
+
+    auto output = sg::make_unique_c_buffer<std::byte>(unCompressedSize);
+    decompress(src, srcSize, (void *)(output.get()), unCompressedSize, dict);
+
+    return output;
+}
+
 /************************ Helper functions *************************/
 
 int default_compresssion_level() { return ZSTD_defaultCLevel(); }
 
 size_t get_uncompressed_size(const void* src, size_t src_size) {
-    /* Get size of original uncompressed data */
-    auto unCompressedSize = ZSTD_getFrameContentSize(src, src_size);
+    /* Get size of original uncompressed data, summed over all frames (skippable frames, like
+     * the seek table of the seekable format, count as zero) */
+    auto unCompressedSize = ZSTD_findDecompressedSize(src, src_size);
     if (unCompressedSize == ZSTD_CONTENTSIZE_ERROR)
         throw std::runtime_error("given data not compressed by zstd");
     if (unCompressedSize == ZSTD_CONTENTSIZE_UNKNOWN)
@@ -114,3 +309,134 @@ std::pair<int, int> bounds_compression_level() {
 }
 
 }  // namespace sg::compression::zstd
+
+/************************** Codec interface *************************/
+
+namespace {
+
+class zstd_stream_compressor final : public sg::compression::IStreamCompressor {
+    std::unique_ptr<ZSTD_CCtx, compression_context_deleter> m_ctx;
+    sg::compression::output_cb_t m_output;
+    std::vector<std::byte> m_buffer;
+
+    /* runs the given directive until zstd has nothing more to output for it */
+    void compress(const void *src, size_t srcSize, ZSTD_EndDirective directive) {
+        ZSTD_inBuffer input{src, srcSize, 0};
+        while (true) {
+            ZSTD_outBuffer output{m_buffer.data(), m_buffer.size(), 0};
+            auto remaining = ZSTD_compressStream2(m_ctx.get(), &output, &input, directive);
+            ZSTD_THROW_ON_ERROR(remaining);
+
+            if (output.pos)
+                m_output.invoke(m_buffer.data(), output.pos);
+
+            bool done = directive == ZSTD_e_continue ? input.pos == input.size : remaining == 0;
+            if (done)
+                break;
+        }
+    }
+
+  public:
+    zstd_stream_compressor(int cLevel, sg::compression::output_cb_t output)
+        : m_ctx(ZSTD_createCCtx()),
+          m_output(std::move(output)),
+          m_buffer(ZSTD_CStreamOutSize()) {
+        if (!m_ctx)
+            throw std::bad_alloc();
+        ZSTD_THROW_ON_ERROR(ZSTD_CCtx_setParameter(m_ctx.get(), ZSTD_c_compressionLevel, cLevel));
+    }
+
+    void write(const void *src, size_t srcSize) override { compress(src, srcSize, ZSTD_e_continue); }
+    void flush() override { compress(nullptr, 0, ZSTD_e_flush); }
+    void finish() override { compress(nullptr, 0, ZSTD_e_end); }
+};
+
+class zstd_stream_decompressor final : public sg::compression::IStreamDecompressor {
+    std::unique_ptr<ZSTD_DCtx, decompression_context_deleter> m_ctx;
+    sg::compression::output_cb_t m_output;
+    std::vector<std::byte> m_buffer;
+
+  public:
+    explicit zstd_stream_decompressor(sg::compression::output_cb_t output)
+        : m_ctx(ZSTD_createDCtx()),
+          m_output(std::move(output)),
+          m_buffer(ZSTD_DStreamOutSize()) {
+        if (!m_ctx)
+            throw std::bad_alloc();
+    }
+
+    void write(const void *src, size_t srcSize) override {
+        ZSTD_inBuffer input{src, srcSize, 0};
+
+        /* if the output buffer was filled, zstd may still be holding data back */
+        bool outputFull = false;
+        while (input.pos < input.size || outputFull) {
+            ZSTD_outBuffer output{m_buffer.data(), m_buffer.size(), 0};
+            ZSTD_THROW_ON_ERROR(ZSTD_decompressStream(m_ctx.get(), &output, &input));
+
+            if (output.pos)
+                m_output.invoke(m_buffer.data(), output.pos);
+            outputFull = output.pos == output.size;
+        }
+    }
+};
+
+class zstd_codec_impl final : public sg::compression::ICodec {
+  public:
+    [[nodiscard]] sg::compression::codec_type type() const noexcept override {
+        return sg::compression::codec_type::zstd;
+    }
+
+    [[nodiscard]] int default_compression_level() const override {
+        return sg::compression::zstd::default_compresssion_level();
+    }
+
+    [[nodiscard]] std::pair<int, int> bounds_compression_level() const override {
+        return sg::compression::zstd::bounds_compression_level();
+    }
+
+    [[nodiscard]] size_t get_max_compressed_size(size_t srcSize) const override {
+        return sg::compression::zstd::get_max_compressed_size(srcSize);
+    }
+
+    [[nodiscard]] std::optional<size_t> get_uncompressed_size(const void *src,
+                                                              size_t srcSize) const override {
+        auto size = ZSTD_findDecompressedSize(src, srcSize);
+        if (size == ZSTD_CONTENTSIZE_ERROR)
+            throw std::runtime_error("given data not compressed by zstd");
+        if (size == ZSTD_CONTENTSIZE_UNKNOWN)
+            return std::nullopt;
+        return size;
+    }
+
+    [[nodiscard]] size_t compress(const void *src, size_t srcSize, void *dst, size_t dstSize,
+                                  int cLevel) const override {
+        return sg::compression::zstd::compress(src, srcSize, dst, dstSize, cLevel, 0);
+    }
+
+    void decompress(const void *src, size_t srcSize, void *dst,
+                    size_t uncompressedSize) const override {
+        sg::compression::zstd::decompress(src, srcSize, dst, uncompressedSize);
+    }
+
+    [[nodiscard]] std::unique_ptr<sg::compression::IStreamCompressor>
+    create_compressor(int cLevel, sg::compression::output_cb_t output) const override {
+        return std::make_unique<zstd_stream_compressor>(cLevel, std::move(output));
+    }
+
+    [[nodiscard]] std::unique_ptr<sg::compression::IStreamDecompressor>
+    create_decompressor(sg::compression::output_cb_t output) const override {
+        return std::make_unique<zstd_stream_decompressor>(std::move(output));
+    }
+};
+
+} // namespace
+
+namespace sg::compression::internal {
+
+const ICodec& zstd_codec() {
+    static const zstd_codec_impl codec;
+    return codec;
+}
+
+} // namespace sg::compression::internal
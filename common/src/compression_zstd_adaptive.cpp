@@ -0,0 +1,154 @@
+#include <sg/compression_zstd.h>
+#include <sg/compression_zstd_adaptive.h>
+#include <sg/memory.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+/* Weight of the newest block in the smoothed throughput */
+constexpr double SMOOTHING = 0.3;
+
+/* zstd treats level 0 as "default level" (i.e. 3), so step over it */
+int next_level(int level, int step) {
+    level += step;
+    return level == 0 ? level + step : level;
+}
+
+} // namespace
+
+namespace sg::compression::zstd {
+
+adaptive_compressor::adaptive_compressor(const target_t &target, std::optional<int> startLevel)
+    : m_target(target) {
+    auto [minLevel, maxLevel] = bounds_compression_level();
+    m_target.levels.first = std::clamp(m_target.levels.first, minLevel, maxLevel);
+    m_target.levels.second = std::clamp(m_target.levels.second, minLevel, maxLevel);
+    if (m_target.levels.first > m_target.levels.second)
+        throw std::invalid_argument(fmt::format("invalid compression level range [{}, {}]",
+                                                target.levels.first, target.levels.second));
+
+    auto [minThreads, maxThreads] = bounds_nothread();
+    m_target.max_threads = std::clamp(m_target.max_threads, minThreads, maxThreads);
+
+    m_stats.level = std::clamp(startLevel.value_or(default_compresssion_level()),
+                               m_target.levels.first, m_target.levels.second);
+    m_stats.threads = 0;
+}
+
+size_t adaptive_compressor::compress(const void *src, size_t srcSize, void *dst, size_t dstSize,
+                                     size_t queueDepth) {
+    int cLevel{0}, noThreads{0};
+    {
+        std::lock_guard lock(m_mutex);
+        cLevel = m_stats.level;
+        noThreads = m_stats.threads;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto cSize = zstd::compress(src, srcSize, dst, dstSize, cLevel, noThreads);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    update(srcSize, cSize, elapsed, queueDepth);
+    return cSize;
+}
+
+unique_c_buffer<std::byte> adaptive_compressor::compress(const void *src, size_t srcSize,
+                                                         size_t queueDepth) {
+    /* Create intermediate buffer */
+    auto cBuffSize = get_max_compressed_size(srcSize);
+    auto cBuff = sg::make_unique_c_buffer<std::byte>(cBuffSize);
+
+    /* Compress */
+    auto cSize = compress(src, srcSize, cBuff.get(), cBuffSize, queueDepth);
+
+    /* Reallocate buffer */
+    auto newPtr = sg::memory::ReallocOrFreeAndThrow(cBuff.release(), cSize);
+
+    return sg::unique_c_buffer<std::byte>(static_cast<std::byte *>(newPtr), cSize);
+}
+
+int adaptive_compressor::level() const {
+    std::lock_guard lock(m_mutex);
+    return m_stats.level;
+}
+
+int adaptive_compressor::threads() const {
+    std::lock_guard lock(m_mutex);
+    return m_stats.threads;
+}
+
+adaptive_compressor::stats_t adaptive_compressor::stats() const {
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+void adaptive_compressor::update(size_t srcSize, size_t dstSize,
+                                 std::chrono::steady_clock::duration elapsed, size_t queueDepth) {
+    using namespace std::chrono;
+
+    auto seconds = std::max(duration<double>(elapsed).count(), 1e-9);
+    auto mbps = double(srcSize) / seconds / 1e6;
+
+    std::lock_guard lock(m_mutex);
+    auto &s = m_stats;
+
+    s.blocks++;
+    s.bytes_in += srcSize;
+    s.bytes_out += dstSize;
+    s.last_mbps = mbps;
+    s.last_latency = duration_cast<microseconds>(elapsed);
+    s.last_queue_depth = queueDepth;
+
+    /* Restart the average whenever the level or number of threads changes, as older blocks say
+     * nothing about the new setting */
+    s.average_mbps = m_fresh ? mbps : (1 - SMOOTHING) * s.average_mbps + SMOOTHING * mbps;
+    m_fresh = false;
+
+    const auto &t = m_target;
+    bool hasThroughput = t.throughput_mbps > 0;
+    bool hasLatency = t.latency.count() > 0;
+    bool hasQueue = t.queue_depth > 0;
+
+    bool behind = (hasThroughput && s.average_mbps < t.throughput_mbps) ||
+                  (hasLatency && s.last_latency > t.latency) ||
+                  (hasQueue && queueDepth > t.queue_depth);
+
+    bool headroom =
+        (hasThroughput || hasLatency || hasQueue) && !behind &&
+        (!hasThroughput || s.average_mbps > t.throughput_mbps * t.headroom) &&
+        (!hasLatency || duration<double>(s.last_latency) * t.headroom < t.latency) &&
+        (!hasQueue || double(queueDepth) * t.headroom <= double(t.queue_depth));
+
+    auto decision = decision_t::none;
+    if (behind) {
+        if (s.threads < t.max_threads) {
+            s.threads++;
+            s.thread_ups++;
+            decision = decision_t::thread_up;
+        } else if (s.level > t.levels.first) {
+            s.level = std::max(next_level(s.level, -1), t.levels.first);
+            s.level_downs++;
+            decision = decision_t::level_down;
+        }
+    } else if (headroom) {
+        if (s.level < t.levels.second) {
+            s.level = std::min(next_level(s.level, 1), t.levels.second);
+            s.level_ups++;
+            decision = decision_t::level_up;
+        } else if (s.threads > 0) {
+            s.threads--;
+            s.thread_downs++;
+            decision = decision_t::thread_down;
+        }
+    }
+
+    s.last_decision = decision;
+    if (decision != decision_t::none)
+        m_fresh = true;
+}
+
+} // namespace sg::compression::zstd
@@ -0,0 +1,213 @@
+#include <sg/compression_zstd.h>
+#include <sg/compression_zstd_batch.h>
+#include <sg/cpu.h>
+#include <sg/jthread.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+/* State shared by the tasks of one batch. The last task to finish fulfils the promise. */
+template <typename R> struct batch_t {
+    explicit batch_t(size_t count) : results(count), remaining(count) {}
+
+    std::vector<R> results;
+    std::atomic<size_t> remaining;
+
+    std::mutex exception_mutex;
+    std::exception_ptr exception;
+
+    std::promise<std::vector<R>> promise;
+
+    void finish_one() {
+        if (remaining.fetch_sub(1, std::memory_order::acq_rel) != 1)
+            return;
+
+        if (exception)
+            promise.set_exception(exception);
+        else
+            promise.set_value(std::move(results));
+    }
+};
+
+} // namespace
+
+namespace sg::compression::zstd {
+
+struct batch_compressor::impl {
+    std::mutex mutex;
+    std::condition_variable signal;
+    std::deque<std::function<void()>> tasks; // note: protected by mutex
+    bool stopping{false};                     // note: protected by mutex
+
+    std::vector<std::jthread> threads;
+
+    explicit impl(size_t noThreads) {
+        for (size_t i = 0; i < noThreads; ++i)
+            threads.emplace_back([this] { run(); });
+    }
+
+    ~impl() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        signal.notify_all();
+
+        /* workers drain the queue before exiting, so that all futures are fulfilled */
+        threads.clear();
+    }
+
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex);
+                signal.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    /* Runs func(i) for each i in [0, count) on the workers, and returns the results in order */
+    template <typename R, typename FuncT>
+    std::future<std::vector<R>> submit(size_t count, FuncT &&func) {
+        auto batch = std::make_shared<batch_t<R>>(count);
+        auto result = batch->promise.get_future();
+
+        if (count == 0) {
+            batch->promise.set_value({});
+            return result;
+        }
+
+        auto sharedFunc = std::make_shared<std::decay_t<FuncT>>(std::forward<FuncT>(func));
+        {
+            std::lock_guard lock(mutex);
+            for (size_t i = 0; i < count; ++i)
+                tasks.emplace_back([batch, sharedFunc, i] {
+                    try {
+                        batch->results[i] = (*sharedFunc)(i);
+                    } catch (...) {
+                        std::lock_guard lock(batch->exception_mutex);
+                        if (!batch->exception)
+                            batch->exception = std::current_exception();
+                    }
+                    batch->finish_one();
+                });
+        }
+        signal.notify_all();
+
+        return result;
+    }
+};
+
+batch_compressor::batch_compressor(size_t noThreads)
+    : m_impl(std::make_unique<impl>(noThreads ? noThreads : sg::cpu::available_parallelism())) {}
+
+batch_compressor::~batch_compressor() = default;
+
+size_t batch_compressor::thread_count() const noexcept { return m_impl->threads.size(); }
+
+std::vector<unique_c_buffer<std::byte>> batch_compressor::compress(std::span<const input_type> src,
+                                                                   int cLevel) {
+    return m_impl
+        ->submit<unique_c_buffer<std::byte>>(
+            src.size(),
+            [src, cLevel](size_t i) {
+                return zstd::compress(src[i].data(), src[i].size(), cLevel, 0);
+            })
+        .get();
+}
+
+std::vector<std::span<std::byte>>
+batch_compressor::compress(std::span<const input_type> src, std::span<std::byte> arena, int cLevel) {
+    if (arena.size() < arena_size(src))
+        throw std::invalid_argument(fmt::format("arena of {} bytes is too small, need {} bytes",
+                                                arena.size(), arena_size(src)));
+
+    std::vector<size_t> offsets(src.size());
+    size_t offset{0};
+    for (size_t i = 0; i < src.size(); ++i) {
+        offsets[i] = offset;
+        offset += get_max_compressed_size(src[i].size());
+    }
+
+    return m_impl
+        ->submit<std::span<std::byte>>(
+            src.size(),
+            [src, arena, cLevel, &offsets](size_t i) {
+                auto slot = arena.subspan(offsets[i], get_max_compressed_size(src[i].size()));
+                auto size = zstd::compress(src[i].data(), src[i].size(), slot.data(), slot.size(),
+                                           cLevel, 0);
+                return slot.first(size);
+            })
+        .get();
+}
+
+size_t batch_compressor::arena_size(std::span<const input_type> src) {
+    return std::accumulate(src.begin(), src.end(), size_t{0}, [](size_t sum, const auto &item) {
+        return sum + get_max_compressed_size(item.size());
+    });
+}
+
+std::vector<unique_c_buffer<std::byte>>
+batch_compressor::decompress(std::span<const input_type> src) {
+    return m_impl
+        ->submit<unique_c_buffer<std::byte>>(
+            src.size(),
+            [src](size_t i) { return zstd::decompress(src[i].data(), src[i].size()); })
+        .get();
+}
+
+std::future<std::vector<unique_c_buffer<std::byte>>>
+batch_compressor::compress_async(std::vector<shared_c_buffer<std::byte>> src, int cLevel) {
+    auto count = src.size();
+    return m_impl->submit<unique_c_buffer<std::byte>>(
+        count, [src = std::move(src), cLevel](size_t i) {
+            return zstd::compress(src[i].get(), src[i].size(), cLevel, 0);
+        });
+}
+
+std::future<unique_c_buffer<std::byte>>
+batch_compressor::compress_async(shared_c_buffer<std::byte> src, int cLevel) {
+    auto promise = std::make_shared<std::promise<unique_c_buffer<std::byte>>>();
+    auto result = promise->get_future();
+
+    {
+        std::lock_guard lock(m_impl->mutex);
+        m_impl->tasks.emplace_back([promise, src = std::move(src), cLevel] {
+            try {
+                promise->set_value(zstd::compress(src.get(), src.size(), cLevel, 0));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        });
+    }
+    m_impl->signal.notify_one();
+
+    return result;
+}
+
+std::future<std::vector<unique_c_buffer<std::byte>>>
+batch_compressor::decompress_async(std::vector<shared_c_buffer<std::byte>> src) {
+    auto count = src.size();
+    return m_impl->submit<unique_c_buffer<std::byte>>(count, [src = std::move(src)](size_t i) {
+        return zstd::decompress(src[i].get(), src[i].size());
+    });
+}
+
+} // namespace sg::compression::zstd
@@ -0,0 +1,349 @@
+#include <sg/compression_zstd.h>
+#include <sg/compression_zstd_seekable.h>
+#include <sg/bytes.h>
+#include <sg/jthread.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+/* See zstd_seekable_compression_format.md */
+constexpr uint32_t SKIPPABLE_MAGIC_NUMBER = 0x184D2A5E;
+constexpr uint32_t SEEKABLE_MAGIC_NUMBER = 0x8F92EAB1;
+constexpr size_t SKIPPABLE_HEADER_SIZE = 8;
+constexpr size_t SEEK_TABLE_FOOTER_SIZE = 9;
+constexpr size_t MAX_FRAME_DECOMPRESSED_SIZE = 0x40000000U;
+
+struct footer_t {
+    uint32_t no_frames;
+    bool has_checksums;
+
+    [[nodiscard]] size_t entry_size() const { return has_checksums ? 12 : 8; }
+
+    /* size of the whole skippable frame containing the seek table */
+    [[nodiscard]] size_t seek_table_size() const {
+        return SKIPPABLE_HEADER_SIZE + no_frames * entry_size() + SEEK_TABLE_FOOTER_SIZE;
+    }
+};
+
+footer_t read_footer(const std::byte *footer) {
+    using sg::bytes::to_numeric;
+
+    if (to_numeric<uint32_t>(footer + 5, std::endian::little) != SEEKABLE_MAGIC_NUMBER)
+        throw std::runtime_error("data does not have a zstd seek table");
+
+    auto descriptor = static_cast<uint8_t>(footer[4]);
+    if (descriptor & 0x7C)
+        throw std::runtime_error("zstd seek table uses reserved bits");
+
+    return footer_t{to_numeric<uint32_t>(footer, std::endian::little), (descriptor & 0x80) != 0};
+}
+
+void append_numeric(std::byte *&dst, uint32_t value) {
+    auto bytes = sg::bytes::to_bytes(value, std::endian::little);
+    std::memcpy(dst, bytes.data(), bytes.size());
+    dst += bytes.size();
+}
+
+/* Runs func(0) ... func(count-1), spread over up to noThreads threads (including the calling
+ * thread). The first exception thrown is rethrown once all threads are done. */
+template <typename FuncT> void parallel_for(size_t count, int noThreads, const FuncT &func) {
+    auto threadCount = std::min<size_t>(static_cast<size_t>(std::max(noThreads, 1)), count);
+    if (threadCount <= 1) {
+        for (size_t i = 0; i < count; ++i) func(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::mutex exceptionMutex;
+    std::exception_ptr exception;
+
+    auto worker = [&]() {
+        try {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order::relaxed)) < count;) func(i);
+        } catch (...) {
+            std::lock_guard lock(exceptionMutex);
+            if (!exception) exception = std::current_exception();
+            next.store(count, std::memory_order::relaxed);
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        for (size_t i = 1; i < threadCount; ++i) threads.emplace_back(worker);
+        worker();
+    }
+
+    if (exception) std::rethrow_exception(exception);
+}
+
+/* A frame that holds more than the seek table says fails to decompress, but one that holds less
+ * would leave the rest of its bytes unwritten */
+void check_frame_size(const sg::compression::zstd::seek_table::frame_t &frame, size_t size) {
+    if (size != frame.decompressed_size)
+        throw std::runtime_error(fmt::format("zstd seek table is corrupt: the frame at {} holds {} "
+                                             "bytes, not the {} it says",
+                                             frame.decompressed_offset, size, frame.decompressed_size));
+}
+
+/* Decompresses [offset, offset + count) into dst. `frames` points to the compressed data at
+ * compressed offset `framesOffset`, and must hold all the frames overlapping the range. */
+void decompress_frames(const sg::compression::zstd::seek_table &table,
+                       const std::byte *frames,
+                       uint64_t framesOffset,
+                       uint64_t offset,
+                       std::byte *dst,
+                       size_t count,
+                       int noThreads) {
+    if (count == 0)
+        return;
+
+    auto first = table.frame_index(offset);
+    auto last = table.frame_index(offset + count - 1);
+
+    parallel_for(last - first + 1, noThreads, [&](size_t i) {
+        const auto &frame = table.frames()[first + i];
+        const auto *src = frames + (frame.compressed_offset - framesOffset);
+
+        auto begin = std::max(offset, frame.decompressed_offset);
+        auto end = std::min(offset + count, frame.decompressed_offset + frame.decompressed_size);
+
+        /* frames fully inside the range are decompressed in place */
+        if (begin == frame.decompressed_offset && end - begin == frame.decompressed_size) {
+            check_frame_size(frame, sg::compression::zstd::decompress(src, frame.compressed_size,
+                                                                      dst + (begin - offset),
+                                                                      frame.decompressed_size));
+            return;
+        }
+
+        auto temp = sg::make_unique_c_buffer<std::byte>(frame.decompressed_size);
+        check_frame_size(frame, sg::compression::zstd::decompress(src, frame.compressed_size,
+                                                                  temp.get(), temp.size()));
+        std::memcpy(dst + (begin - offset), temp.get() + (begin - frame.decompressed_offset),
+                    end - begin);
+    });
+}
+
+void check_range(const sg::compression::zstd::seek_table &table, uint64_t offset, size_t count) {
+    if (offset > table.decompressed_size() || count > table.decompressed_size() - offset)
+        throw std::out_of_range(fmt::format("range [{}, {}) is outside of the {} bytes of data",
+                                            offset, offset + count, table.decompressed_size()));
+}
+
+} // namespace
+
+namespace sg::compression::zstd {
+
+/*************************** seek_table ****************************/
+
+seek_table::seek_table(const void *src, size_t srcSize) {
+    auto data = static_cast<const std::byte *>(src);
+
+    if (srcSize < SEEK_TABLE_FOOTER_SIZE)
+        throw std::runtime_error("data does not have a zstd seek table");
+
+    auto footer = read_footer(data + srcSize - SEEK_TABLE_FOOTER_SIZE);
+    if (srcSize < footer.seek_table_size())
+        throw std::runtime_error("zstd seek table is truncated");
+
+    parse(data + srcSize - footer.seek_table_size(), footer.seek_table_size(), footer.no_frames,
+          footer.has_checksums, srcSize - footer.seek_table_size());
+}
+
+seek_table::seek_table(const std::filesystem::path &path) {
+    std::ifstream stream;
+    stream.exceptions(std::ifstream::badbit | std::ifstream::failbit);
+    stream.open(path, std::ios::binary | std::ios::in);
+
+    auto fileSize = std::filesystem::file_size(path);
+    if (fileSize < SEEK_TABLE_FOOTER_SIZE)
+        throw std::runtime_error(fmt::format("{} does not have a zstd seek table", path.string()));
+
+    std::array<std::byte, SEEK_TABLE_FOOTER_SIZE> footerBytes;
+    stream.seekg(static_cast<std::streamoff>(fileSize - SEEK_TABLE_FOOTER_SIZE));
+    stream.read(reinterpret_cast<char *>(footerBytes.data()), footerBytes.size());
+
+    auto footer = read_footer(footerBytes.data());
+    if (fileSize < footer.seek_table_size())
+        throw std::runtime_error(fmt::format("zstd seek table of {} is truncated", path.string()));
+
+    std::vector<std::byte> table(footer.seek_table_size());
+    stream.seekg(static_cast<std::streamoff>(fileSize - table.size()));
+    stream.read(reinterpret_cast<char *>(table.data()), static_cast<std::streamsize>(table.size()));
+
+    parse(table.data(), table.size(), footer.no_frames, footer.has_checksums, fileSize - table.size());
+}
+
+void seek_table::parse(const std::byte *table, size_t tableSize, uint32_t noFrames,
+                       bool hasChecksums, uint64_t dataSize) {
+    using sg::bytes::to_numeric;
+
+    if (to_numeric<uint32_t>(table, std::endian::little) != SKIPPABLE_MAGIC_NUMBER ||
+        to_numeric<uint32_t>(table + 4, std::endian::little) != tableSize - SKIPPABLE_HEADER_SIZE)
+        throw std::runtime_error("zstd seek table is corrupt");
+
+    const size_t entrySize = hasChecksums ? 12 : 8;
+    const auto *entry = table + SKIPPABLE_HEADER_SIZE;
+
+    m_frames.clear();
+    m_frames.reserve(noFrames);
+
+    uint64_t compressedOffset{0};
+    uint64_t decompressedOffset{0};
+    for (uint32_t i = 0; i < noFrames; ++i, entry += entrySize) {
+        frame_t frame{compressedOffset, decompressedOffset,
+                      to_numeric<uint32_t>(entry, std::endian::little),
+                      to_numeric<uint32_t>(entry + 4, std::endian::little)};
+        compressedOffset += frame.compressed_size;
+        decompressedOffset += frame.decompressed_size;
+        m_frames.push_back(frame);
+    }
+
+    /* the frames are read from the data as the table has them, so a corrupt size must not take
+     * them past its end */
+    if (compressedOffset > dataSize)
+        throw std::runtime_error(fmt::format("zstd seek table is corrupt: its frames take {} bytes, but "
+                                             "there are only {} before it",
+                                             compressedOffset, dataSize));
+}
+
+const std::vector<seek_table::frame_t> &seek_table::frames() const noexcept { return m_frames; }
+
+uint64_t seek_table::compressed_size() const noexcept {
+    return m_frames.empty() ? 0 : m_frames.back().compressed_offset + m_frames.back().compressed_size;
+}
+
+uint64_t seek_table::decompressed_size() const noexcept {
+    return m_frames.empty()
+               ? 0
+               : m_frames.back().decompressed_offset + m_frames.back().decompressed_size;
+}
+
+size_t seek_table::frame_index(uint64_t decompressedOffset) const {
+    if (decompressedOffset >= decompressed_size())
+        throw std::out_of_range(fmt::format("offset {} is outside of the {} bytes of data",
+                                            decompressedOffset, decompressed_size()));
+
+    /* first frame that starts after the offset, the one before it contains the offset (empty
+     * frames are skipped over, as they start at the same offset as the next frame) */
+    auto it = std::ranges::upper_bound(m_frames, decompressedOffset, {},
+                                       &frame_t::decompressed_offset);
+    return static_cast<size_t>(std::distance(m_frames.begin(), it)) - 1;
+}
+
+/************************** Compression ****************************/
+
+unique_c_buffer<std::byte> compress_seekable(const void *src, size_t srcSize, size_t frameSize,
+                                             int cLevel, int noThreads) {
+    if (frameSize == 0 || frameSize > MAX_FRAME_DECOMPRESSED_SIZE)
+        throw std::invalid_argument(
+            fmt::format("seekable frame size must be between 1 and {} bytes",
+                        MAX_FRAME_DECOMPRESSED_SIZE));
+
+    /* always have at least one frame, so that the result is valid zstd data */
+    const size_t noFrames = std::max<size_t>(1, (srcSize + frameSize - 1) / frameSize);
+    if (noFrames > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("too many frames for the zstd seekable format");
+
+    const footer_t footer{static_cast<uint32_t>(noFrames), false};
+
+    /* Each frame is compressed into its own slot, and the slots are then packed together */
+    const size_t slotSize = get_max_compressed_size(frameSize);
+    auto output = sg::make_unique_c_buffer<std::byte>(noFrames * slotSize + footer.seek_table_size());
+    std::vector<uint32_t> compressedSizes(noFrames);
+
+    parallel_for(noFrames, noThreads, [&](size_t i) {
+        auto begin = i * frameSize;
+        auto size = std::min(frameSize, srcSize - begin);
+        compressedSizes[i] = static_cast<uint32_t>(
+            compress(static_cast<const std::byte *>(src) + begin, size,
+                     output.get() + i * slotSize, slotSize, cLevel, 0));
+    });
+
+    auto *dst = output.get();
+    for (size_t i = 0; i < noFrames; ++i) {
+        std::memmove(dst, output.get() + i * slotSize, compressedSizes[i]);
+        dst += compressedSizes[i];
+    }
+
+    /* seek table */
+    append_numeric(dst, SKIPPABLE_MAGIC_NUMBER);
+    append_numeric(dst, static_cast<uint32_t>(footer.seek_table_size() - SKIPPABLE_HEADER_SIZE));
+    for (size_t i = 0; i < noFrames; ++i) {
+        append_numeric(dst, compressedSizes[i]);
+        append_numeric(dst, static_cast<uint32_t>(std::min(frameSize, srcSize - i * frameSize)));
+    }
+    append_numeric(dst, footer.no_frames);
+    *dst++ = std::byte{0}; // descriptor: no checksums
+    append_numeric(dst, SEEKABLE_MAGIC_NUMBER);
+
+    /* Reallocate buffer */
+    auto size = static_cast<size_t>(dst - output.get());
+    auto newPtr = sg::memory::ReallocOrFreeAndThrow(output.release(), size);
+
+    return sg::unique_c_buffer<std::byte>(static_cast<std::byte *>(newPtr), size);
+}
+
+/************************* Decompression ***************************/
+
+void decompress_range(const void *src, size_t srcSize, uint64_t offset, void *dst, size_t count,
+                      int noThreads) {
+    seek_table table(src, srcSize);
+    check_range(table, offset, count);
+
+    decompress_frames(table, static_cast<const std::byte *>(src), 0, offset,
+                      static_cast<std::byte *>(dst), count, noThreads);
+}
+
+unique_c_buffer<std::byte> decompress_range(const void *src, size_t srcSize, uint64_t offset,
+                                            size_t count, int noThreads) {
+    auto output = sg::make_unique_c_buffer<std::byte>(count);
+    decompress_range(src, srcSize, offset, output.get(), count, noThreads);
+    return output;
+}
+
+void decompress_range(const std::filesystem::path &path, uint64_t offset, void *dst, size_t count,
+                      int noThreads) {
+    seek_table table(path);
+    check_range(table, offset, count);
+
+    if (count == 0)
+        return;
+
+    /* the overlapping frames are contiguous, so read them in one go */
+    const auto &first = table.frames()[table.frame_index(offset)];
+    const auto &last = table.frames()[table.frame_index(offset + count - 1)];
+    auto compressedSize = last.compressed_offset + last.compressed_size - first.compressed_offset;
+
+    std::ifstream stream;
+    stream.exceptions(std::ifstream::badbit | std::ifstream::failbit);
+    stream.open(path, std::ios::binary | std::ios::in);
+    stream.seekg(static_cast<std::streamoff>(first.compressed_offset));
+
+    auto compressed = sg::make_unique_c_buffer<std::byte>(compressedSize);
+    stream.read(reinterpret_cast<char *>(compressed.get()),
+                static_cast<std::streamsize>(compressedSize));
+
+    decompress_frames(table, compressed.get(), first.compressed_offset, offset,
+                      static_cast<std::byte *>(dst), count, noThreads);
+}
+
+unique_c_buffer<std::byte> decompress_range(const std::filesystem::path &path, uint64_t offset,
+                                            size_t count, int noThreads) {
+    auto output = sg::make_unique_c_buffer<std::byte>(count);
+    decompress_range(path, offset, output.get(), count, noThreads);
+    return output;
+}
+
+} // namespace sg::compression::zstd
@@ -16,6 +16,12 @@
     #define IS_ARM
 #endif
 
+#if defined(IS_ARM) && defined(__linux__)
+    #include <sys/auxv.h>
+#elif defined(IS_ARM) && defined(_WIN32)
+    #include <windows.h>
+#endif
+
 namespace {
 
 #ifndef IS_ARM
@@ -66,6 +72,75 @@ struct internal_cpu_vendor {
 
     sg::cpu::cpu_vendor result;
 };
+
+#ifndef IS_ARM
+/* Extended control register 0, i.e. which register states the OS saves on context switches */
+uint64_t xgetbv0() {
+    #ifdef _WIN32
+    return _xgetbv(0);
+    #else
+    uint32_t eax, edx;
+    asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (uint64_t(edx) << 32) | eax;
+    #endif
+}
+#endif
+
+sg::cpu::cpu_features_t detect_features() {
+    sg::cpu::cpu_features_t f;
+
+#ifdef IS_ARM
+    #if defined(__linux__) && defined(__aarch64__)
+    auto hwcap = getauxval(AT_HWCAP);
+    f.arm_crc32 = hwcap & HWCAP_CRC32;
+    f.arm_pmull = hwcap & HWCAP_PMULL;
+    #elif defined(__linux__)
+    auto hwcap2 = getauxval(AT_HWCAP2);
+    f.arm_crc32 = hwcap2 & HWCAP2_CRC32;
+    f.arm_pmull = hwcap2 & HWCAP2_PMULL;
+    #elif defined(__APPLE__)
+    /* every Apple Arm CPU has both */
+    f.arm_crc32 = true;
+    f.arm_pmull = true;
+    #elif defined(_WIN32)
+    f.arm_crc32 = IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE);
+    f.arm_pmull = IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE);
+    #else
+        #ifdef __ARM_FEATURE_CRC32
+    f.arm_crc32 = true;
+        #endif
+        #ifdef __ARM_FEATURE_CRYPTO
+    f.arm_pmull = true;
+        #endif
+    #endif
+#else
+    auto maxLeaf = CPUID(0).EAX();
+    if (maxLeaf < 1)
+        return f;
+
+    CPUID leaf1(1);
+    f.sse42 = leaf1.ECX() & (1u << 20);
+    f.pclmul = leaf1.ECX() & (1u << 1);
+
+    /* AVX needs the OS to save the YMM (and for AVX-512, ZMM and opmask) registers */
+    bool osxsave = leaf1.ECX() & (1u << 27);
+    uint64_t xcr0 = osxsave ? xgetbv0() : 0;
+    bool osAvx = (xcr0 & 0x6) == 0x6;
+    bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+
+    if (maxLeaf < 7)
+        return f;
+
+    CPUID leaf7(7);
+    f.avx2 = osAvx && (leaf7.EBX() & (1u << 5));
+    f.avx512 = osAvx512 && (leaf7.EBX() & (1u << 16)) && // F
+               (leaf7.EBX() & (1u << 30)) &&             // BW
+               (leaf7.EBX() & (1u << 31));               // VL
+    f.vpclmulqdq = osAvx && (leaf7.ECX() & (1u << 10));
+#endif
+
+    return f;
+}
 }
 
 namespace sg::cpu {
@@ -80,6 +155,11 @@ size_t available_parallelism() {
     return count;
 }
 
+const cpu_features_t &features() {
+    static const cpu_features_t singleton = detect_features();
+    return singleton;
+}
+
 std::vector<cpu_info_t> info()
 {
     uv_cpu_info_t *uv_info=nullptr;
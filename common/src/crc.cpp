@@ -3,59 +3,494 @@
 #include "include/crc32c_hardware_armv7.h"
 #include "include/crc32c_hardware_armv8.h"
 #include "include/crc32_hardware_armv7.h"
-
-#if !defined(CPU_SUPPORTS_ARM_CRC)
+#include "include/crc32_hardware_clmul.h"
+#include "include/crc32_hardware_avx512.h"
 #include "include/crc32c_tabular.h"
-#endif
+#include "include/crc16_tabular.h"
+#include "include/crc64_hardware_clmul.h"
+#include "include/crc64_tabular.h"
 
-#include <boost/crc.hpp>
 #include <sg/bytes.h>
 #include <sg/cpu.h>
 #include <sg/crc.h>
+#include <sg/jthread.h>
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
-namespace sg::checksum {
-
-bool can_do_crc32c_hardware() {
-#ifdef CPU_SUPPORTS_SSE42
-    return true;
-#else
-    return false;
+#if defined(CRC_IS_X86)
+    #include <immintrin.h>
 #endif
-}
 
-uint32_t crc32c(const void* data, std::size_t length, uint32_t remainder) {
-    /* If available, use hardware asssited version. Otherwise, use
-     * tabular version. */
+namespace {
+
+/* A CRC kernel, with the same remainder semantics as the public functions (i.e. takes and returns
+ * the final, flipped, CRC) */
+typedef uint32_t (*crc32_fn_t)(const void *data, std::size_t length, uint32_t remainder);
+
+struct crc32_kernel_t {
+    crc32_fn_t fn;
+    const char *name;
+    bool hardware;
+};
+
+/* Polynomials, bit-reflected */
+constexpr uint32_t CRC32C_POLY = 0x82F63B78U;
+constexpr uint32_t CRC32_POLY = 0xEDB88320U;
+
+/* The AVX-512 kernels fold 256 bytes at a time, shorter buffers go straight to the next best kernel */
+[[maybe_unused]] constexpr std::size_t AVX512_MIN_LENGTH = 256;
+
+/*************************** crc32c kernels ****************************/
+
 #if defined(HAVE_HARDWARE_CRC32C_64)
-    return crc32c_impl(remainder, static_cast<const char*>(data), length);
-#elif defined(HAVE_HARDWARE_CRC32C_32)
+uint32_t crc32c_x86_64(const void *data, std::size_t length, uint32_t remainder) {
+    return crc32c_impl(remainder, static_cast<const char *>(data), length);
+}
+#endif
+
+#if defined(HAVE_HARDWARE_CRC32C_32)
+uint32_t crc32c_x86_32(const void *data, std::size_t length, uint32_t remainder) {
     return ~crc32c_hardware_32bit(data, length, ~remainder);
-#elif defined(HAVE_HARDWARE_CRC32C_ARMV8)
+}
+#endif
+
+#if defined(HAVE_HARDWARE_CRC32C_ARMV8)
+uint32_t crc32c_armv8(const void *data, std::size_t length, uint32_t remainder) {
     return ~crc32c_hardware_armv8(data, length, ~remainder);
-#elif defined(HAVE_HARDWARE_CRC32C_ARMV7)
+}
+#endif
+
+#if defined(HAVE_HARDWARE_CRC32C_ARMV7)
+uint32_t crc32c_armv7(const void *data, std::size_t length, uint32_t remainder) {
     return ~crc32c_hardware_armv7(data, length, ~remainder);
-#else
-    static auto pTbl = compute_tabular_method_tables(0x82f63b78U);
+}
+#endif
+
+#if defined(HAVE_HARDWARE_CRC32_AVX512)
+uint32_t crc32c_avx512(const void *data, std::size_t length, uint32_t remainder) {
+    if (length < AVX512_MIN_LENGTH)
+        return crc32c_x86_64(data, length, remainder);
+    return ~crc32_hardware_avx512<CRC32C_POLY>(data, length, ~remainder, crc32c_hardware_32bit);
+}
+#endif
+
+uint32_t crc32c_table(const void *data, std::size_t length, uint32_t remainder) {
+    static auto pTbl = compute_tabular_method_tables(CRC32C_POLY);
     return ~crc32c_tabular(data, length, ~remainder, pTbl.get());
+}
+
+crc32_kernel_t select_crc32c_kernel() {
+    [[maybe_unused]] const auto &cpu = sg::cpu::features();
+
+#if defined(HAVE_HARDWARE_CRC32_AVX512)
+    if (cpu.avx512 && cpu.vpclmulqdq && cpu.pclmul && cpu.sse42)
+        return {crc32c_avx512, "avx512+vpclmulqdq", true};
+#endif
+#if defined(HAVE_HARDWARE_CRC32C_64)
+    if (cpu.sse42 && cpu.pclmul)
+        return {crc32c_x86_64, "sse4.2+pclmul", true};
+#endif
+#if defined(HAVE_HARDWARE_CRC32C_32)
+    if (cpu.sse42)
+        return {crc32c_x86_32, "sse4.2", true};
+#endif
+#if defined(HAVE_HARDWARE_CRC32C_ARMV8)
+    if (cpu.arm_crc32 && cpu.arm_pmull)
+        return {crc32c_armv8, "armv8 crc+pmull", true};
 #endif
+#if defined(HAVE_HARDWARE_CRC32C_ARMV7)
+    if (cpu.arm_crc32)
+        return {crc32c_armv7, "armv8 crc", true};
+#endif
+
+    return {crc32c_table, "tabular", false};
 }
 
-uint32_t crc32(const void* data, std::size_t length, uint32_t remainder) {
-#ifdef HAVE_HARDWARE_CRC32_ARMV7
+/* Resolved once, the first time it is needed */
+const crc32_kernel_t &crc32c_kernel() {
+    static const crc32_kernel_t kernel = select_crc32c_kernel();
+    return kernel;
+}
+
+/**************************** crc32 kernels *****************************/
+
+#if defined(HAVE_HARDWARE_CRC32_ARMV7)
+uint32_t crc32_armv7(const void *data, std::size_t length, uint32_t remainder) {
     return ~crc32_hardware_armv7(data, length, ~remainder);
-#else
+}
+#endif
+
+/* Takes and returns the raw (i.e. not flipped) CRC */
+uint32_t crc32_table_raw(const void *data, std::size_t length, uint32_t prev) {
     // use CRC32 polynomial, the only difference between CRC32-C and CRC32 is the polynomial, the
     // calculation is otherwise the same
-    static auto pTbl = compute_tabular_method_tables(0xEDB88320);
-    return ~crc32c_tabular(data, length, ~remainder, pTbl.get());
+    static auto pTbl = compute_tabular_method_tables(CRC32_POLY);
+    return crc32c_tabular(data, length, prev, pTbl.get());
+}
+
+uint32_t crc32_table(const void *data, std::size_t length, uint32_t remainder) {
+    return ~crc32_table_raw(data, length, ~remainder);
+}
+
+#if defined(HAVE_HARDWARE_CRC32_CLMUL)
+uint32_t crc32_clmul(const void *data, std::size_t length, uint32_t remainder) {
+    return ~crc32_hardware_clmul<CRC32_POLY>(data, length, ~remainder, crc32_table_raw);
+}
+#endif
+
+#if defined(HAVE_HARDWARE_CRC32_AVX512)
+uint32_t crc32_avx512(const void *data, std::size_t length, uint32_t remainder) {
+    if (length < AVX512_MIN_LENGTH)
+        return crc32_clmul(data, length, remainder);
+    return ~crc32_hardware_avx512<CRC32_POLY>(data, length, ~remainder, crc32_table_raw);
+}
+#endif
+
+crc32_kernel_t select_crc32_kernel() {
+    [[maybe_unused]] const auto &cpu = sg::cpu::features();
+
+#if defined(HAVE_HARDWARE_CRC32_AVX512)
+    if (cpu.avx512 && cpu.vpclmulqdq && cpu.pclmul)
+        return {crc32_avx512, "avx512+vpclmulqdq", true};
+#endif
+#if defined(HAVE_HARDWARE_CRC32_CLMUL)
+    if (cpu.pclmul)
+        return {crc32_clmul, "pclmul", true};
+#endif
+#if defined(HAVE_HARDWARE_CRC32_ARMV7)
+    if (cpu.arm_crc32)
+        return {crc32_armv7, "armv8 crc", true};
+#endif
+
+    return {crc32_table, "tabular", false};
+}
+
+const crc32_kernel_t &crc32_kernel() {
+    static const crc32_kernel_t kernel = select_crc32_kernel();
+    return kernel;
+}
+
+/**************************** crc64 kernels *****************************/
+
+/* Takes the previous result, as the crc32 kernels do. For ECMA-182 that's the raw CRC (no initial
+ * value, no final xor), for NVMe the flipped one */
+typedef uint64_t (*crc64_fn_t)(const void *data, std::size_t length, uint64_t remainder);
+
+struct crc64_kernel_t {
+    crc64_fn_t ecma182;
+    crc64_fn_t nvme;
+    const char *name;
+};
+
+/* ECMA-182 is a normal polynomial, NVMe is given bit-reflected */
+constexpr uint64_t CRC64_ECMA182_POLY = 0x42F0E1EBA9EA3693ULL;
+constexpr uint64_t CRC64_NVME_POLY = 0x9A6C9329AC4BC9B5ULL;
+
+uint64_t crc64_ecma182_table(const void *data, std::size_t length, uint64_t remainder) {
+    return crc64_tabular<CRC64_ECMA182_POLY, false>(data, length, remainder);
+}
+
+uint64_t crc64_nvme_table_raw(const void *data, std::size_t length, uint64_t prev) {
+    return crc64_tabular<CRC64_NVME_POLY, true>(data, length, prev);
+}
+
+uint64_t crc64_nvme_table(const void *data, std::size_t length, uint64_t remainder) {
+    return ~crc64_nvme_table_raw(data, length, ~remainder);
+}
+
+#if defined(HAVE_HARDWARE_CRC64_CLMUL)
+uint64_t crc64_ecma182_clmul(const void *data, std::size_t length, uint64_t remainder) {
+    return crc64_hardware_clmul<CRC64_ECMA182_POLY, false>(data, length, remainder,
+                                                           crc64_ecma182_table);
+}
+
+uint64_t crc64_nvme_clmul(const void *data, std::size_t length, uint64_t remainder) {
+    return ~crc64_hardware_clmul<CRC64_NVME_POLY, true>(data, length, ~remainder,
+                                                        crc64_nvme_table_raw);
+}
+#endif
+
+#if defined(HAVE_HARDWARE_CRC64_PMULL)
+uint64_t crc64_ecma182_pmull(const void *data, std::size_t length, uint64_t remainder) {
+    return crc64_hardware_pmull<CRC64_ECMA182_POLY, false>(data, length, remainder,
+                                                           crc64_ecma182_table);
+}
+
+uint64_t crc64_nvme_pmull(const void *data, std::size_t length, uint64_t remainder) {
+    return ~crc64_hardware_pmull<CRC64_NVME_POLY, true>(data, length, ~remainder,
+                                                        crc64_nvme_table_raw);
+}
+#endif
+
+crc64_kernel_t select_crc64_kernel() {
+    [[maybe_unused]] const auto &cpu = sg::cpu::features();
+
+#if defined(HAVE_HARDWARE_CRC64_CLMUL)
+    // every CPU with SSE4.2 has SSSE3 too
+    if (cpu.pclmul && cpu.sse42)
+        return {crc64_ecma182_clmul, crc64_nvme_clmul, "pclmul"};
+#endif
+#if defined(HAVE_HARDWARE_CRC64_PMULL)
+    if (cpu.arm_pmull)
+        return {crc64_ecma182_pmull, crc64_nvme_pmull, "pmull"};
 #endif
+
+    return {crc64_ecma182_table, crc64_nvme_table, "tabular"};
+}
+
+const crc64_kernel_t &crc64_kernel() {
+    static const crc64_kernel_t kernel = select_crc64_kernel();
+    return kernel;
+}
+
+/***************************** Copy and CRC *****************************/
+
+/* Copied, and then checksummed, at a time. Small enough that the source and destination both
+ * stay in L1 */
+constexpr std::size_t COPY_CHUNK = 8 * 1024;
+
+/* From here on the destination is unlikely to be read again before it leaves the cache, so it is
+ * written around it */
+[[maybe_unused]] constexpr std::size_t NON_TEMPORAL_MIN_LENGTH = 4 * 1024 * 1024;
+
+#if defined(CRC_IS_X86)
+/* memcpy() with non-temporal stores. Needs an _mm_sfence() before the data is handed to another
+ * thread */
+CRC_TARGET("sse2", "sse2")
+void copy_non_temporal(uint8_t *dst, const uint8_t *src, std::size_t length) {
+    auto head = std::min(length, (16 - (reinterpret_cast<std::uintptr_t>(dst) & 15)) & 15);
+    std::memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    length -= head;
+
+    for (; length >= 64; dst += 64, src += 64, length -= 64) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+        auto c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+        auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dst), a);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+    }
+
+    std::memcpy(dst, src, length);
+}
+#endif
+
+uint32_t copy_and_crc(crc32_fn_t fn, void *dst, const void *src, std::size_t length,
+                      uint32_t remainder) {
+    auto d = static_cast<uint8_t *>(dst);
+    auto s = static_cast<const uint8_t *>(src);
+
+#if defined(CRC_IS_X86)
+    // SSE2 is part of x86-64, and any CPU with SSE4.2 has it
+    if (length >= NON_TEMPORAL_MIN_LENGTH && (sizeof(void *) == 8 || sg::cpu::features().sse42)) {
+        /* the source has just been read, so checksum that rather than the destination */
+        for (std::size_t n; length; d += n, s += n, length -= n) {
+            n = std::min(length, COPY_CHUNK);
+            copy_non_temporal(d, s, n);
+            remainder = fn(s, n, remainder);
+        }
+        _mm_sfence();
+        return remainder;
+    }
+#endif
+
+    for (std::size_t n; length; d += n, s += n, length -= n) {
+        n = std::min(length, COPY_CHUNK);
+        std::memcpy(d, s, n);
+        remainder = fn(d, n, remainder);
+    }
+    return remainder;
+}
+
+/****************************** Combining *******************************/
+
+/* a*b mod P, for a bit-reflected polynomial P (as in zlib) */
+constexpr uint32_t multmodp(uint32_t a, uint32_t b, uint32_t poly) {
+    uint32_t m = uint32_t(1) << 31;
+    uint32_t p = 0;
+    while (true) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ poly : b >> 1;
+    }
+    return p;
+}
+
+/* x^(2^k) mod P, for k in [0, 32) */
+struct x2n_table_t {
+    uint32_t values[32];
+};
+
+constexpr x2n_table_t make_x2n_table(uint32_t poly) {
+    x2n_table_t table{};
+    uint32_t p = uint32_t(1) << 30; // x^1
+    table.values[0] = p;
+    for (int k = 1; k < 32; ++k)
+        table.values[k] = p = multmodp(p, p, poly);
+    return table;
+}
+
+template <uint32_t Poly> constexpr x2n_table_t x2n_table = make_x2n_table(Poly);
+
+template <uint32_t Poly> uint32_t combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) {
+    /* crcA * x^(8 * lengthB) mod P, starting from x^0 and going through the bits of lengthB */
+    uint32_t p = uint32_t(1) << 31;
+    unsigned k = 3;
+    for (uint64_t n = lengthB; n; n >>= 1, ++k)
+        if (n & 1)
+            p = multmodp(x2n_table<Poly>.values[k & 31], p, Poly);
+
+    return multmodp(p, crcA, Poly) ^ crcB;
+}
+
+/*************************** Multiple buffers ***************************/
+
+/* Below this, a thread costs more than it saves */
+constexpr std::size_t MIN_PARALLEL_BLOCK = 1024 * 1024;
+
+uint32_t crc_list(crc32_fn_t fn, sg::checksum::buffer_list_t buffers, uint32_t remainder) {
+    for (auto buffer : buffers)
+        remainder = fn(buffer.data(), buffer.size(), remainder);
+    return remainder;
+}
+
+template <uint32_t Poly>
+uint32_t crc_parallel(crc32_fn_t fn, sg::checksum::buffer_list_t buffers, uint32_t remainder,
+                      std::size_t noThreads) {
+    std::size_t total{0};
+    for (auto buffer : buffers)
+        total += buffer.size();
+
+    if (noThreads == 0)
+        noThreads = sg::cpu::available_parallelism();
+    noThreads = std::min(noThreads, std::max<std::size_t>(1, total / MIN_PARALLEL_BLOCK));
+    if (noThreads <= 1)
+        return crc_list(fn, buffers, remainder);
+
+    /* Split the buffers into one run of (about) equal length per thread */
+    auto perThread = (total + noThreads - 1) / noThreads;
+    std::vector<std::vector<std::span<const std::byte>>> runs(noThreads);
+    std::vector<std::size_t> lengths(noThreads);
+
+    std::size_t run{0};
+    for (auto buffer : buffers) {
+        while (!buffer.empty()) {
+            bool last = run + 1 == noThreads;
+            auto take = last ? buffer.size() : std::min(buffer.size(), perThread - lengths[run]);
+
+            runs[run].push_back(buffer.first(take));
+            lengths[run] += take;
+            buffer = buffer.subspan(take);
+
+            if (!last && lengths[run] == perThread)
+                ++run;
+        }
+    }
+
+    /* Checksum every run but the first from 0, and combine them afterwards */
+    std::vector<uint32_t> crcs(noThreads);
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t i = 1; i < noThreads; ++i)
+            threads.emplace_back([&, i] { crcs[i] = crc_list(fn, runs[i], 0); });
+
+        crcs[0] = crc_list(fn, runs[0], remainder);
+    }
+
+    auto crc = crcs[0];
+    for (std::size_t i = 1; i < noThreads; ++i)
+        crc = combine<Poly>(crc, crcs[i], lengths[i]);
+    return crc;
+}
+
+} // namespace
+
+namespace sg::checksum {
+
+bool can_do_crc32c_hardware() { return crc32c_kernel().hardware; }
+
+const char *crc32c_implementation() { return crc32c_kernel().name; }
+
+const char *crc32_implementation() { return crc32_kernel().name; }
+
+uint32_t crc32c(const void* data, std::size_t length, uint32_t remainder) {
+    return crc32c_kernel().fn(data, length, remainder);
+}
+
+uint32_t crc32(const void* data, std::size_t length, uint32_t remainder) {
+    return crc32_kernel().fn(data, length, remainder);
+}
+
+uint32_t copy_and_crc32c(void *dst, const void *src, std::size_t length, uint32_t remainder) {
+    return copy_and_crc(crc32c_kernel().fn, dst, src, length, remainder);
+}
+
+uint32_t crc32c_combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) {
+    return combine<CRC32C_POLY>(crcA, crcB, lengthB);
+}
+
+uint32_t crc32_combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) {
+    return combine<CRC32_POLY>(crcA, crcB, lengthB);
+}
+
+uint32_t crc32c(buffer_list_t buffers, uint32_t remainder) {
+    return crc_list(crc32c_kernel().fn, buffers, remainder);
+}
+
+uint32_t crc32(buffer_list_t buffers, uint32_t remainder) {
+    return crc_list(crc32_kernel().fn, buffers, remainder);
+}
+
+uint32_t crc32c_parallel(const void *data, std::size_t length, uint32_t remainder,
+                         std::size_t noThreads) {
+    std::span<const std::byte> buffer(static_cast<const std::byte *>(data), length);
+    return crc32c_parallel(buffer_list_t(&buffer, 1), remainder, noThreads);
+}
+
+uint32_t crc32c_parallel(buffer_list_t buffers, uint32_t remainder, std::size_t noThreads) {
+    return crc_parallel<CRC32C_POLY>(crc32c_kernel().fn, buffers, remainder, noThreads);
+}
+
+uint32_t crc32_parallel(const void *data, std::size_t length, uint32_t remainder,
+                        std::size_t noThreads) {
+    std::span<const std::byte> buffer(static_cast<const std::byte *>(data), length);
+    return crc32_parallel(buffer_list_t(&buffer, 1), remainder, noThreads);
+}
+
+uint32_t crc32_parallel(buffer_list_t buffers, uint32_t remainder, std::size_t noThreads) {
+    return crc_parallel<CRC32_POLY>(crc32_kernel().fn, buffers, remainder, noThreads);
+}
+
+uint64_t crc64_ecma182(const void* data, std::size_t length, uint64_t remainder) {
+    return crc64_kernel().ecma182(data, length, remainder);
+}
+
+uint64_t crc64_nvme(const void* data, std::size_t length, uint64_t remainder) {
+    return crc64_kernel().nvme(data, length, remainder);
+}
+
+const char *crc64_implementation() { return crc64_kernel().name; }
+
+uint16_t crc16(const void* data, std::size_t length, uint16_t remainder) {
+    return crc16_tabular<0xA001, true>(data, length, remainder);
+}
+
+uint16_t crc16_xmodem(const void* data, std::size_t length, uint16_t remainder) {
+    return crc16_tabular<0x1021, false>(data, length, remainder);
 }
 
-uint16_t crc16(const void* data, std::size_t length) {
-    boost::crc_16_type crc;
-    crc.process_bytes(data, length);
-    return crc.checksum();
+uint16_t crc16_modbus(const void* data, std::size_t length, uint16_t remainder) {
+    return crc16_tabular<0xA001, true>(data, length, remainder);
 }
 
 } // namespace sg::checksum
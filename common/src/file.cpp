@@ -1,10 +1,50 @@
 #include "sg/file.h"
 
 #include "sg/buffer.h"
+#include "sg/cpu.h"
 #include "sg/enumeration.h"
+#include "sg/jthread.h"
 #include "sg/memory.h"
 
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/* Below this, a thread costs more than it saves */
+constexpr size_t MIN_PARALLEL_CHUNK = 8 * 1024 * 1024;
+
+[[noreturn]] void throw_map_error(const std::filesystem::path &path, const char *what, int error) {
+    throw std::runtime_error(fmt::format("sg::common::file::map: {} {}: {}", what, path.string(),
+                                         std::system_category().message(error)));
+}
+
+void unmap(const std::byte *data, size_t size) noexcept {
+    if (data == nullptr) return;
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<std::byte *>(data), size);
+#endif
+}
+
+} // namespace
 
 
 namespace sg::common::file {
@@ -64,4 +104,135 @@ void write(const std::filesystem::path& path, const sg::IBuffer<std::byte>& buff
     write(path, buffer.get(), buffer.size(), mode);
 }
 
+/********************************************* map ********************************************/
+
+mapped_file::~mapped_file() { unmap(m_data, m_size); }
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)) {}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+    if (this != &other) {
+        reset(other.m_data, other.m_size);
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+void mapped_file::reset(const std::byte *data, size_t size) noexcept {
+    unmap(m_data, m_size);
+    m_data = data;
+    m_size = size;
+}
+
+#if defined(_WIN32)
+
+mapped_file map(const std::filesystem::path &path, map_advice advice) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw_map_error(path, "could not open", static_cast<int>(GetLastError()));
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        auto error = static_cast<int>(GetLastError());
+        CloseHandle(file);
+        throw_map_error(path, "could not get the size of", error);
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return {};
+    }
+
+    /* the view keeps the mapping, and the mapping the file, open */
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    auto error = static_cast<int>(GetLastError());
+    CloseHandle(file);
+    if (mapping == nullptr) throw_map_error(path, "could not map", error);
+
+    auto data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    error = static_cast<int>(GetLastError());
+    CloseHandle(mapping);
+    if (data == nullptr) throw_map_error(path, "could not map", error);
+
+    mapped_file mapped(data, static_cast<size_t>(size.QuadPart));
+    if (enumeration::contains(advice, map_advice::will_need)) {
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<std::byte *>(data), mapped.size()};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+    return mapped;
+}
+
+#else
+
+mapped_file map(const std::filesystem::path &path, map_advice advice) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw_map_error(path, "could not open", errno);
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        auto error = errno;
+        ::close(fd);
+        throw_map_error(path, "could not get the size of", error);
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return {};
+    }
+
+    /* the mapping keeps the file open */
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    auto error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) throw_map_error(path, "could not map", error);
+
+    /* advice is only a hint, so failing to give it is not an error */
+    if (enumeration::contains(advice, map_advice::sequential)) madvise(data, size, MADV_SEQUENTIAL);
+    if (enumeration::contains(advice, map_advice::random)) madvise(data, size, MADV_RANDOM);
+    if (enumeration::contains(advice, map_advice::will_need)) madvise(data, size, MADV_WILLNEED);
+
+    return {static_cast<const std::byte *>(data), size};
+}
+
+#endif
+
+/***************************************** read_parallel ****************************************/
+
+unique_c_buffer<std::byte> read_parallel(const std::filesystem::path &path, size_t noThreads) {
+    auto const size = std::filesystem::file_size(path);
+    if (size == 0) return {};
+    auto data = sg::make_unique_c_buffer<std::byte>(size);
+
+    if (noThreads == 0)
+        noThreads = sg::cpu::available_parallelism();
+    noThreads = std::min(noThreads, std::max<size_t>(1, size / MIN_PARALLEL_CHUNK));
+
+    /* each chunk is read with a stream of its own, so that the reads don't share a file position */
+    auto perThread = (size + noThreads - 1) / noThreads;
+    std::atomic<size_t> total{0};
+    const auto read_chunk = [&](size_t i) {
+        auto offset = i * perThread;
+        auto count = std::min(perThread, size - std::min(size, offset));
+
+        std::ifstream stream(path, std::ios::binary | std::ios::in);
+        stream.seekg(static_cast<std::streamoff>(offset));
+        stream.read(reinterpret_cast<char *>(data.get() + offset), static_cast<std::streamsize>(count));
+        total += static_cast<size_t>(stream.gcount());
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        for (size_t i = 1; i < noThreads; ++i)
+            threads.emplace_back(read_chunk, i);
+        read_chunk(0);
+    }
+
+    if (total != size)
+        throw std::runtime_error(
+            fmt::format("sg::common::file::read_parallel: read {} of {} bytes of {}", total.load(), size, path.string()));
+    return data;
+}
+
 } // namespace sg::common::file
\ No newline at end of file
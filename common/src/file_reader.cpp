@@ -0,0 +1,202 @@
+#include "sg/file_reader.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sg {
+
+/* Positioned reads, only used by the read-ahead thread once opened */
+class internal::file_reader_source {
+#if defined(_WIN32)
+    std::ifstream m_stream;
+#else
+    int m_fd{-1};
+#endif
+    uint64_t m_size{0};
+
+  public:
+    explicit file_reader_source(const file_reader::path_type &path) {
+#if defined(_WIN32)
+        m_stream.open(path, std::ios::binary | std::ios::in);
+        if (!m_stream.is_open())
+            throw std::runtime_error(fmt::format("file_reader: could not open {}", path.string()));
+        m_size = std::filesystem::file_size(path);
+#else
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+            throw std::runtime_error(fmt::format("file_reader: could not open {}: {}", path.string(),
+                                                 std::system_category().message(errno)));
+        struct stat st {};
+        if (fstat(m_fd, &st) != 0) {
+            auto error = errno;
+            ::close(m_fd);
+            throw std::runtime_error(fmt::format("file_reader: could not get the size of {}: {}", path.string(),
+                                                 std::system_category().message(error)));
+        }
+        m_size = static_cast<uint64_t>(st.st_size);
+#if defined(POSIX_FADV_SEQUENTIAL)
+        /* doubles the kernel's read-ahead, on top of ours */
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+    }
+
+    ~file_reader_source() {
+#if !defined(_WIN32)
+        ::close(m_fd);
+#endif
+    }
+
+    file_reader_source(const file_reader_source &) = delete;
+    file_reader_source &operator=(const file_reader_source &) = delete;
+
+    [[nodiscard]] uint64_t size() const noexcept { return m_size; }
+
+    /* reads count bytes at offset, fewer only at the end of the file */
+    size_t read(uint64_t offset, std::byte *dst, size_t count) {
+#if defined(_WIN32)
+        m_stream.clear();
+        m_stream.seekg(static_cast<std::streamoff>(offset));
+        m_stream.read(reinterpret_cast<char *>(dst), static_cast<std::streamsize>(count));
+        if (m_stream.bad()) throw std::runtime_error("file_reader: read failed");
+        return static_cast<size_t>(m_stream.gcount());
+#else
+        size_t done{0};
+        while (done < count) {
+            auto n = ::pread(m_fd, dst + done, count - done, static_cast<off_t>(offset + done));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(
+                    fmt::format("file_reader: read failed: {}", std::system_category().message(errno)));
+            }
+            if (n == 0) break;
+            done += static_cast<size_t>(n);
+        }
+        return done;
+#endif
+    }
+
+    /* the range has been read, and won't be needed again */
+    void drop(uint64_t offset, uint64_t length) noexcept {
+#if defined(POSIX_FADV_DONTNEED)
+        posix_fadvise(m_fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#else
+        (void)offset;
+        (void)length;
+#endif
+    }
+};
+
+file_reader::file_reader(const path_type &path) : file_reader(path, options_t{}) {}
+
+file_reader::file_reader(const path_type &path, options_t options)
+    : m_options(options),
+      m_source(std::make_unique<internal::file_reader_source>(path)) {
+    if (m_options.chunk_size == 0) throw std::invalid_argument("file_reader: chunk_size must not be 0");
+    m_options.read_ahead = std::max<size_t>(m_options.read_ahead, 1);
+    m_size = m_source->size();
+
+    m_thread = std::jthread([this] { action(); });
+}
+
+file_reader::~file_reader() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void file_reader::action() {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] {
+            return m_stopping ||
+                   (!m_error && m_read_offset < m_size && m_chunks.size() < m_options.read_ahead);
+        });
+        if (m_stopping) return;
+
+        auto offset = m_read_offset;
+        auto generation = m_generation;
+        auto count = static_cast<size_t>(std::min<uint64_t>(m_options.chunk_size, m_size - offset));
+        lock.unlock();
+
+        /* read outside of the lock, so that the consumer can take the chunks already read */
+        buffer_type chunk;
+        std::exception_ptr error;
+        try {
+            chunk = sg::make_shared_c_buffer<std::byte>(count);
+            auto n = m_source->read(offset, chunk.get(), count);
+            /* the file has been truncated since it was opened, what is left of it is returned */
+            if (n < count) {
+                auto rest = n ? sg::make_shared_c_buffer<std::byte>(n) : buffer_type{};
+                std::copy_n(chunk.get(), n, rest.get());
+                chunk = std::move(rest);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (generation != m_generation) continue; // seek() while reading
+
+        if (error) {
+            m_error = error;
+        } else {
+            m_read_offset = chunk.size() < count ? m_size : offset + chunk.size();
+            if (chunk.size()) m_chunks.push_back(std::move(chunk));
+        }
+        m_cv.notify_all();
+    }
+}
+
+file_reader::buffer_type file_reader::next() {
+    buffer_type chunk;
+    {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] { return !m_chunks.empty() || m_error || m_read_offset >= m_size; });
+
+        if (m_chunks.empty()) {
+            if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+            return {};
+        }
+        chunk = std::move(m_chunks.front());
+        m_chunks.pop_front();
+    }
+    m_cv.notify_all();
+
+    /* the previous chunks have been processed by now */
+    if (m_options.drop_behind && m_position > m_dropped) {
+        m_source->drop(m_dropped, m_position - m_dropped);
+        m_dropped = m_position;
+    }
+    m_position += chunk.size();
+    return chunk;
+}
+
+void file_reader::seek(uint64_t offset) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_chunks.clear();
+        m_error = nullptr;
+        ++m_generation;
+        m_read_offset = std::min(offset, m_size);
+        m_position = m_read_offset;
+        m_dropped = m_position;
+    }
+    m_cv.notify_all();
+}
+
+} // namespace sg
@@ -1,82 +1,664 @@
 #include "sg/file_writer.h"
 #include "sg/debug.h"
+#include "sg/file_writer_service.h"
+#include "include/file_writer_backend.h"
+#include "include/file_frame.h"
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <cstring>
 #include <filesystem>
 #include <functional>
 #include <future>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <vector>
 #include <thread>
+#include <utility>
 
 #include "sg/buffer.h"
 
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
 namespace sg {
 
+namespace {
+
+#if !defined(_WIN32)
+
+/*
+ * Gathers a whole batch into as few writev() calls as possible, straight to the file descriptor.
+ *
+ * Buffers of less than SMALL_BUFFER bytes are copied, one after the other, into a staging block,
+ * so that a run of small buffers (e.g. log lines) is a single iovec. Larger buffers are written
+ * from where they are. A writev() is made when there are IOV_MAX iovecs, when the staging block is
+ * full, and at the end of the batch.
+ */
+class writev_backend : public internal::file_writer_backend {
+    static constexpr size_t SMALL_BUFFER = 4 * 1024;
+    static constexpr size_t STAGING_SIZE = 64 * 1024;
+    #if defined(IOV_MAX)
+    static constexpr size_t MAX_IOVECS = IOV_MAX;
+    #else
+    static constexpr size_t MAX_IOVECS = 1024;
+    #endif
+
+    int m_fd{-1};
+    size_t m_size{0};
+    bool m_preallocated{false};
+    std::vector<iovec> m_iovecs;
+    std::unique_ptr<std::byte[]> m_staging;
+    size_t m_staged{0};
+
+  public:
+    explicit writev_backend(const file_writer::path_type &path)
+        : m_staging(std::make_unique_for_overwrite<std::byte[]>(STAGING_SIZE)) {
+        m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fd < 0)
+            throw std::runtime_error(fmt::format("file_writer: {}: {}", path.string(), std::strerror(errno)));
+        m_iovecs.reserve(MAX_IOVECS);
+    }
+
+    writev_backend(const writev_backend &) = delete;
+    writev_backend &operator=(const writev_backend &) = delete;
+
+    ~writev_backend() override {
+        if (m_fd >= 0) ::close(m_fd);
+    }
+
+    const char *name() const noexcept override { return "writev"; }
+
+    void preallocate(size_t bytes) override {
+    #if defined(__linux__)
+        m_preallocated = ::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) == 0;
+    #else
+        (void)bytes;
+    #endif
+    }
+
+    size_t write(std::deque<file_writer::buffer_type> &buffers) override {
+        size_t count{0};
+        /* the buffers must stay alive until written, so are only dropped at the end */
+        for (const auto &buff : buffers) {
+            auto data = buff.get();
+            auto size = buff.size();
+            if (size == 0) continue;
+
+            if (size < SMALL_BUFFER) {
+                if (m_staged + size > STAGING_SIZE) count += flush();
+
+                /* extend the run of staged bytes, if it is the last iovec */
+                auto dst = m_staging.get() + m_staged;
+                auto extends = !m_iovecs.empty() &&
+                               static_cast<std::byte *>(m_iovecs.back().iov_base) + m_iovecs.back().iov_len == dst;
+                if (!extends && m_iovecs.size() == MAX_IOVECS) {
+                    count += flush();
+                    dst = m_staging.get();
+                }
+
+                std::memcpy(dst, data, size);
+                m_staged += size;
+                if (extends)
+                    m_iovecs.back().iov_len += size;
+                else
+                    m_iovecs.push_back(iovec{dst, size});
+                continue;
+            }
+
+            if (m_iovecs.size() == MAX_IOVECS) count += flush();
+            m_iovecs.push_back(iovec{const_cast<std::byte *>(data), size});
+        }
+        count += flush();
+
+        buffers.clear();
+        return count;
+    }
+
+    size_t sync() override {
+    #if defined(__APPLE__)
+        auto r = ::fsync(m_fd);
+    #else
+        auto r = ::fdatasync(m_fd);
+    #endif
+        count_syscall();
+        if (r < 0) throw std::runtime_error(fmt::format("file_writer: fdatasync: {}", std::strerror(errno)));
+        return 0;
+    }
+
+    size_t close() override {
+        if (m_fd < 0) return 0;
+        /* gives back what was reserved and not used */
+        if (m_preallocated) (void)::ftruncate(m_fd, static_cast<off_t>(m_size));
+        auto fd = std::exchange(m_fd, -1);
+        if (::close(fd) < 0)
+            throw std::runtime_error(fmt::format("file_writer: close: {}", std::strerror(errno)));
+        return 0;
+    }
+
+  private:
+    /* Writes all the iovecs, however many writev() calls that takes */
+    size_t flush() {
+        size_t total{0};
+        auto iov = m_iovecs.data();
+        auto left = m_iovecs.size();
+        while (left > 0) {
+            auto r = ::writev(m_fd, iov, static_cast<int>(left));
+            count_syscall();
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(fmt::format("file_writer: writev: {}", std::strerror(errno)));
+            }
+
+            auto n = static_cast<size_t>(r);
+            total += n;
+            /* skip what was written, a short write can end part way through an iovec */
+            while (left > 0 && n >= iov->iov_len) {
+                n -= iov->iov_len;
+                ++iov;
+                --left;
+            }
+            if (left > 0) {
+                iov->iov_base = static_cast<std::byte *>(iov->iov_base) + n;
+                iov->iov_len -= n;
+            }
+        }
+
+        m_iovecs.clear();
+        m_staged = 0;
+        m_size += total;
+        return total;
+    }
+};
+
+#else
+
+/* The original backend, one std::fstream::write per buffer */
+class stream_backend : public internal::file_writer_backend {
+    std::fstream m_file;
+
+  public:
+    explicit stream_backend(const file_writer::path_type &path)
+        : m_file(path, std::ios::out | std::ios::binary | std::ios::trunc) {
+        if (!m_file.is_open())
+            throw std::runtime_error(fmt::format("file_writer: could not open {}", path.string()));
+    }
+
+    const char *name() const noexcept override { return "stream"; }
+
+    size_t write(std::deque<file_writer::buffer_type> &buffers) override {
+        size_t count{0};
+        while (!buffers.empty()) {
+            auto buff = buffers.front();
+            m_file.write((char *)(buff.get()), buff.size());
+            count_syscall();
+            count += buff.size();
+
+            buffers.pop_front();
+        }
+        return count;
+    }
+
+    /* only as far as the OS */
+    size_t sync() override {
+        m_file.flush();
+        return 0;
+    }
+
+    size_t close() override {
+        if (m_file.is_open()) m_file.close();
+        return 0;
+    }
+};
+
+#endif
+
+std::unique_ptr<internal::file_writer_backend> open_backend(const file_writer::path_type &path,
+                                                            const file_writer::options_t &options,
+                                                            std::atomic<size_t> &syscalls) {
+    std::unique_ptr<internal::file_writer_backend> backend;
+    if (options.backend == file_writer::backend_t::io_uring)
+        backend = internal::make_io_uring_backend(path, options);
+    if (!backend)
+        backend = internal::make_stream_backend(path);
+    backend->count_syscalls_into(syscalls);
+
+    if (options.segment_size && options.preallocate)
+        backend->preallocate(options.segment_size);
+    return backend;
+}
+
+bool is_segmented(const file_writer::options_t &options) {
+    return options.segment_size || options.segment_interval.count();
+}
+
+int64_t elapsed_ns(std::chrono::steady_clock::time_point since,
+                   std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now()) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(until - since).count();
+}
+
+int64_t steady_second() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+/* Compresses batches as one stream, each batch flushed into a frame of its own */
+class internal::frame_compressor {
+    std::unique_ptr<compression::IStreamCompressor> m_compressor;
+    std::vector<std::byte> m_out;
+
+  public:
+    frame_compressor(compression::codec_type type, std::optional<int> level) {
+        const auto &codec = compression::codec(type);
+        m_compressor = codec.create_compressor(level.value_or(codec.default_compression_level()),
+                                               [this](const std::byte *data, size_t size) {
+                                                   m_out.insert(m_out.end(), data, data + size);
+                                               });
+    }
+
+    /* Returns the frame, or an empty buffer if there was no output. Finishing ends the stream, and
+     * anything compressed after that starts a new one */
+    file_writer::buffer_type compress(const std::deque<file_writer::buffer_type> &buffers, bool finish) {
+        m_out.resize(FRAME_HEADER_SIZE);
+        for (const auto &buff : buffers)
+            m_compressor->write(buff.get(), buff.size());
+        if (finish)
+            m_compressor->finish();
+        else
+            m_compressor->flush();
+
+        auto length = m_out.size() - FRAME_HEADER_SIZE;
+        if (length == 0) return {};
+        if (length > UINT32_MAX)
+            throw std::runtime_error(fmt::format("file_writer: compressed batch of {} bytes is too large", length));
+
+        write_frame_header(m_out.data(), static_cast<uint32_t>(length),
+                           checksum::crc32c(m_out.data() + FRAME_HEADER_SIZE, length));
+        auto frame = sg::make_shared_c_buffer<std::byte>(m_out.size());
+        std::memcpy(frame.get(), m_out.data(), m_out.size());
+        return frame;
+    }
+};
+
+std::unique_ptr<internal::file_writer_backend>
+internal::make_stream_backend(const file_writer::path_type &path) {
+#if !defined(_WIN32)
+    return std::make_unique<writev_backend>(path);
+#else
+    return std::make_unique<stream_backend>(path);
+#endif
+}
+
 void sg::file_writer::action(const std::stop_token &stop_tok) {
     while(true) {
-        /* wait for data, unless a stop has been requested */
-        if (!stop_tok.stop_requested())
-            m_signal.acquire();
-
-        /* swap buffer */
-        std::deque<sg::shared_c_buffer<std::byte>> m_old_data;
-        {
-            std::lock_guard lock(m_mutex);
-            m_old_data.swap(m_data);
+        /* wait for data, unless a stop has been requested. Wake up in time to roll over a segment,
+         * or for a periodic sync */
+        if (!stop_tok.stop_requested()) {
+            auto deadline = next_deadline();
+            auto idle_from = std::chrono::steady_clock::now();
+            auto woken = deadline ? m_wakeup.try_acquire_until(*deadline) : (m_wakeup.acquire(), true);
+            /* only clear the flag once the semaphore is taken, so that it is released once at most */
+            if (woken) m_signal.exchange(false, std::memory_order::acq_rel);
+            m_writer_idle_ns.fetch_add(elapsed_ns(idle_from), std::memory_order::relaxed);
         }
 
-        size_t count{0};
-        try {
-            while (!m_old_data.empty()) {
-                auto buff = m_old_data.front();
-                m_file.write((char *)(buff.get()), buff.size());
-                count += buff.size();
+        if (!write_queued(SIZE_MAX)) break;
 
-                m_old_data.pop_front();
-            }
-            m_byte_count.fetch_add(count * sizeof(char));
-        } catch (const std::exception &ex) {
-            if (m_on_error_cb) m_on_error_cb(this, ex.what());
+        /* if stop is requested and there is data, go around one more loop */
+        if (stop_tok.stop_requested() && m_data.empty())
             break;
+    };
+
+    finish();
+}
+
+bool sg::file_writer::service_turn(size_t max_bytes) {
+    /* read before taking the data, so that everything queued before stop() is written first */
+    auto stopping = m_service_stopping.load(std::memory_order::acquire);
+    if (write_queued(max_bytes) && !(stopping && m_data.empty())) return false;
+
+    finish();
+    return true;
+}
+
+void sg::file_writer::notify_service() {
+    m_service->notify(this);
+}
+
+std::optional<std::chrono::steady_clock::time_point> sg::file_writer::next_deadline() const {
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    if (m_options.segment_interval.count())
+        deadline = m_segment_start + m_options.segment_interval;
+    if (m_options.durability == durability_t::periodic && (m_unsynced_bytes || !m_durable.empty())) {
+        auto sync_at = m_last_sync + m_options.sync_interval;
+        deadline = deadline ? std::min(*deadline, sync_at) : sync_at;
+    }
+    return deadline;
+}
+
+bool sg::file_writer::write_queued(size_t max_bytes) {
+    std::deque<sg::shared_c_buffer<std::byte>> m_old_data;
+    size_t bytes{0};
+    /* the queue is at its longest just before a batch is taken */
+    auto depth = m_queued_count.load(std::memory_order::relaxed);
+    auto queued = m_queued_bytes.load(std::memory_order::relaxed);
+    if (depth > m_queue_depth_high.load(std::memory_order::relaxed))
+        m_queue_depth_high.store(depth, std::memory_order::relaxed);
+    if (queued > m_pending_bytes_high.load(std::memory_order::relaxed))
+        m_pending_bytes_high.store(queued, std::memory_order::relaxed);
+
+    m_batch_queued_at.clear();
+    while (bytes < max_bytes) {
+        auto item = m_data.try_pop();
+        if (!item) break;
+        bytes += item->buffer.size();
+        m_old_data.push_back(std::move(item->buffer));
+        m_batch_queued_at.push_back(item->queued_at);
+        if (item->durable) m_durable.push_back(std::move(*item->durable));
+    }
+    m_writing_bytes.store(bytes, std::memory_order::relaxed);
+    m_queued_bytes.fetch_sub(bytes, std::memory_order::relaxed);
+    m_queued_count.fetch_sub(m_old_data.size(), std::memory_order::relaxed);
+
+    if (!m_batch_queued_at.empty()) {
+        m_batch_bytes.record(bytes);
+        m_batch_buffers.record(m_batch_queued_at.size());
+    }
+
+    bool failed{false};
+    try {
+        auto begin = std::chrono::steady_clock::now();
+        write_batch(m_old_data);
+        auto written = std::chrono::steady_clock::now();
+        if (!m_batch_queued_at.empty()) {
+            m_batch_latency.record(static_cast<uint64_t>(elapsed_ns(begin, written)));
+            for (auto queued_at : m_batch_queued_at)
+                if (queued_at.time_since_epoch().count())
+                    m_write_latency.record(static_cast<uint64_t>(elapsed_ns(queued_at, written)));
+            record_rate(bytes);
         }
+        m_unsynced_bytes += bytes;
+        /* nothing to overlap the last compression with */
+        if (m_data.empty()) flush_compression(false);
+        if (sync_due()) sync();
+    } catch (const std::exception &ex) {
+        if (m_on_error_cb) m_on_error_cb(this, ex.what());
+        m_error = std::current_exception();
+        fail_durable(m_error);
+        failed = true;
+    }
 
-        /* if stop is requested and there is data, go around one more loop */
-        if (stop_tok.stop_requested())
-        {
-            std::lock_guard lock(m_mutex);
-            if (m_data.empty())
-                break;
+    m_writing_bytes.store(0, std::memory_order::relaxed);
+    m_batches.fetch_add(1, std::memory_order::release);
+    m_batches.notify_all();
+    return !failed;
+}
+
+void sg::file_writer::finish() {
+    /* nothing will be written any more, so don't keep anyone waiting for that. seq_cst, as
+     * write_async_durable() counts itself in m_durable_pushers then loads this, while below this is
+     * stored then m_durable_pushers loaded: with a weaker store both could see the old value */
+    m_running.store(false, std::memory_order::seq_cst);
+    m_batches.fetch_add(1, std::memory_order::release);
+    m_batches.notify_all();
+
+    /* wait for the previous segment to be closed, and remove the next, opened ahead of time */
+    if (m_next_backend.valid()) {
+        try {
+            m_next_backend.get()->close();
+            std::filesystem::remove(segment_path(m_path, m_segment_index + 1));
+        } catch (const std::exception &ex) {
+            if (m_on_error_cb) m_on_error_cb(this, ex.what());
         }
-    };
+    }
 
     try {
-        if (m_file.is_open()) m_file.close();
-    } catch (...) {
+        flush_compression(true);
+        if (m_options.durability != durability_t::none || !m_durable.empty()) sync();
+        m_byte_count.fetch_add(m_backend->close());
+    } catch (const std::exception &ex) {
+        if (m_on_error_cb) m_on_error_cb(this, ex.what());
+        fail_durable(std::current_exception());
     };
 
+    /* after a failed write, the rest of the queue won't be written. m_running is cleared by now, so
+     * once the durable writes in progress are pushed, no more are */
+    while (m_durable_pushers.load())
+        std::this_thread::yield();
+    fail_queued(m_error ? m_error
+                        : std::make_exception_ptr(std::runtime_error("file_writer: stopped before it was written")));
+
+    if (is_segmented(m_options) && m_options.on_segment_closed)
+        m_options.on_segment_closed(this, segment_path(m_path, m_segment_index), m_segment_bytes);
+
     if (m_on_stop_cb) m_on_stop_cb(this);
 }
 
+void sg::file_writer::write_batch(std::deque<buffer_type> &batch) {
+    if (!is_segmented(m_options)) {
+        write_part(batch);
+        return;
+    }
+
+    const auto interval = m_options.segment_interval;
+    const auto expired = [&] {
+        return interval.count() && std::chrono::steady_clock::now() - m_segment_start >= interval;
+    };
+
+    /* the segment may have run out of time with nothing more to write */
+    if (expired()) {
+        if (m_segment_bytes)
+            roll_over();
+        else
+            m_segment_start = std::chrono::steady_clock::now();
+    }
+
+    /* the buffers for the current segment */
+    std::deque<buffer_type> part;
+    size_t part_bytes{0};
+    const auto flush = [&] {
+        write_part(part);
+        m_segment_bytes += std::exchange(part_bytes, 0);
+    };
+
+    for (auto &buff : batch) {
+        auto size = buff.size();
+        auto bytes = m_segment_bytes + part_bytes;
+        if (bytes && ((m_options.segment_size && bytes + size > m_options.segment_size) || expired())) {
+            flush();
+            roll_over();
+        }
+        part.push_back(std::move(buff));
+        part_bytes += size;
+    }
+    batch.clear();
+    flush();
+}
+
+void sg::file_writer::roll_over() {
+    /* The segment is closed in the background, so make it durable now if need be. Waiting writes
+     * may have data in the next segment too, so they are completed by the next sync */
+    flush_compression(true);
+    if (m_options.durability != durability_t::none || !m_durable.empty()) sync(false);
+
+    /* throws if the next segment couldn't be opened */
+    auto closed = std::exchange(m_backend, m_next_backend.get());
+    auto closed_path = segment_path(m_path, m_segment_index);
+    auto closed_bytes = std::exchange(m_segment_bytes, 0);
+
+    ++m_segment_index;
+    m_segment_start = std::chrono::steady_clock::now();
+
+    m_next_backend = std::async(std::launch::async, [this, closed = std::move(closed), closed_path, closed_bytes,
+                                                     next_path = segment_path(m_path, m_segment_index + 1)]() mutable {
+        try {
+            m_byte_count.fetch_add(closed->close());
+        } catch (const std::exception &ex) {
+            if (m_on_error_cb) m_on_error_cb(this, ex.what());
+        }
+        closed.reset();
+        if (m_options.on_segment_closed) m_options.on_segment_closed(this, closed_path, closed_bytes);
+
+        return open_backend(next_path, m_options, m_syscalls);
+    });
+}
+
+void sg::file_writer::write_part(std::deque<buffer_type> &part) {
+    if (!m_compressor) {
+        m_byte_count.fetch_add(m_backend->write(part));
+        return;
+    }
+
+    if (!m_options.compress_on_helper_thread) {
+        write_frame(m_compressor->compress(part, false));
+        part.clear();
+        return;
+    }
+
+    /* compress this part on the helper thread while the previous one is written, one at a time as
+     * the compressor is a stream */
+    auto previous = m_compressing.valid() ? m_compressing.get() : buffer_type{};
+    m_compressing = std::async(std::launch::async,
+                               [this, part = std::move(part)] { return m_compressor->compress(part, false); });
+    part.clear();
+    write_frame(std::move(previous));
+}
+
+void sg::file_writer::write_frame(buffer_type frame) {
+    if (frame.size() == 0) return;
+    std::deque<buffer_type> frames{std::move(frame)};
+    m_byte_count.fetch_add(m_backend->write(frames));
+}
+
+void sg::file_writer::flush_compression(bool finish) {
+    if (!m_compressor) return;
+    if (m_compressing.valid()) write_frame(m_compressing.get());
+    if (finish) write_frame(m_compressor->compress({}, true));
+}
+
+bool sg::file_writer::sync_due() const {
+    switch (m_options.durability) {
+    case durability_t::none:
+        return !m_durable.empty();
+    case durability_t::periodic:
+        return (m_unsynced_bytes || !m_durable.empty()) &&
+               std::chrono::steady_clock::now() - m_last_sync >= m_options.sync_interval;
+    case durability_t::group_commit:
+        return m_unsynced_bytes || !m_durable.empty();
+    }
+    return false;
+}
+
+void sg::file_writer::sync(bool complete_durable) {
+    flush_compression(false);
+
+    auto begin = std::chrono::steady_clock::now();
+    m_byte_count.fetch_add(m_backend->sync());
+    m_last_sync = std::chrono::steady_clock::now();
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m_last_sync - begin).count();
+    m_sync_total_ns.fetch_add(ns, std::memory_order::relaxed);
+    m_sync_last_ns.store(ns, std::memory_order::relaxed);
+    if (ns > m_sync_max_ns.load(std::memory_order::relaxed)) m_sync_max_ns.store(ns, std::memory_order::relaxed);
+    m_sync_count.fetch_add(1, std::memory_order::release);
+
+    if (!complete_durable) return;
+    m_unsynced_bytes = 0;
+    for (auto &promise : m_durable)
+        promise.set_value();
+    m_durable.clear();
+}
+
+void sg::file_writer::fail_durable(const std::exception_ptr &error) {
+    for (auto &promise : m_durable)
+        promise.set_exception(error);
+    m_durable.clear();
+}
+
+void sg::file_writer::fail_queued(const std::exception_ptr &error) {
+    while (auto item = m_data.try_pop()) {
+        m_queued_bytes.fetch_sub(item->buffer.size(), std::memory_order::relaxed);
+        m_queued_count.fetch_sub(1, std::memory_order::relaxed);
+        if (item->durable) item->durable->set_exception(error);
+    }
+}
+
+sg::file_writer::file_writer() = default;
+
 sg::file_writer::~file_writer() { stop(); }
 
 void sg::file_writer::start(path_type _path,
                        error_cb_t on_error_cb,
                        started_cb_t on_start_cb,
                        stopped_cb_t on_stop_cb) {
-    if (m_thread.joinable())
+    start(std::move(_path), std::move(on_error_cb), std::move(on_start_cb), std::move(on_stop_cb),
+          options_t{});
+}
+
+void sg::file_writer::start(path_type _path,
+                       error_cb_t on_error_cb,
+                       started_cb_t on_start_cb,
+                       stopped_cb_t on_stop_cb,
+                       options_t options) {
+    if (is_running())
         throw std::runtime_error(fmt::format("this {} is already running", sg::type_name<file_writer>()));
 
     m_on_error_cb = std::move(on_error_cb);
     m_on_stop_cb = std::move(on_stop_cb);
 
     m_byte_count = 0;
+    m_dropped = 0;
+    m_error = nullptr;
+    reset_stats();
+    m_compressor = options.compression
+                       ? std::make_unique<internal::frame_compressor>(*options.compression, options.compression_level)
+                       : nullptr;
+    m_path = std::move(_path);
+    m_options = std::move(options);
 
-    m_file = std::fstream(_path, std::ios::out | std::ios::binary | std::ios::trunc);
-    m_thread = std::jthread([this](const std::stop_token &tok) { action(tok); });
+    m_segment_index = 0;
+    m_segment_bytes = 0;
+    m_segment_start = std::chrono::steady_clock::now();
+
+    m_unsynced_bytes = 0;
+    m_last_sync = m_segment_start;
+    m_sync_count = 0;
+    m_sync_total_ns = 0;
+    m_sync_max_ns = 0;
+    m_sync_last_ns = 0;
+
+    m_backend.reset();
+    if (is_segmented(m_options)) {
+        m_backend = open_backend(segment_path(m_path, 0), m_options, m_syscalls);
+        m_next_backend = std::async(std::launch::async, [this, next_path = segment_path(m_path, 1)] {
+            return open_backend(next_path, m_options, m_syscalls);
+        });
+    } else {
+        m_backend = open_backend(m_path, m_options, m_syscalls);
+    }
+
+    m_running.store(true, std::memory_order::release);
+    m_service = m_options.service.get();
+    if (m_service) {
+        m_service_stopping.store(false, std::memory_order::relaxed);
+        m_service_state.store(service_state_t::idle, std::memory_order::relaxed);
+        m_service_finished = {};
+        m_service_done = m_service_finished.get_future();
+        m_service->attach(this);
+    } else {
+        m_thread = std::jthread([this](const std::stop_token &tok) { action(tok); });
+    }
 
     if (on_start_cb) on_start_cb(this);
 }
@@ -84,18 +666,131 @@ void sg::file_writer::start(path_type _path,
 void sg::file_writer::stop() {
     if (m_thread.joinable()) {
         m_thread.request_stop();
-        m_signal.release();
+        notify();
         m_thread.join();
     }
+    if (m_service_done.valid()) {
+        m_service_stopping.store(true, std::memory_order::release);
+        notify();
+        m_service_done.get();
+    }
 }
 
 bool file_writer::is_running() const
 {
-    return m_thread.joinable();
+    return m_thread.joinable() || m_service_done.valid();
+}
+
+file_writer::write_result_t file_writer::write_async(std::string_view view) {
+    return write_async(view.data(), view.size());
+}
+
+std::future<void> file_writer::write_async_durable(std::string_view view) {
+    auto buff = make_buffer(view.size());
+    std::memcpy(buff.get(), view.data(), view.size());
+    return write_async_durable(std::move(buff));
+}
+
+file_writer::sync_stats_t file_writer::sync_stats() const noexcept {
+    sync_stats_t stats;
+    stats.count = m_sync_count.load(std::memory_order::acquire);
+    stats.total = std::chrono::nanoseconds(m_sync_total_ns.load(std::memory_order::relaxed));
+    stats.max = std::chrono::nanoseconds(m_sync_max_ns.load(std::memory_order::relaxed));
+    stats.last = std::chrono::nanoseconds(m_sync_last_ns.load(std::memory_order::relaxed));
+    return stats;
 }
 
-void file_writer::write_async(std::string_view view) {
-    write_async(view.data(), view.size());
+void file_writer::wait_below_high_water_mark() {
+    auto stalled_from = std::chrono::steady_clock::now();
+    while (true) {
+        auto batches = m_batches.load(std::memory_order::acquire);
+        if (!over_high_water_mark() || !m_running.load(std::memory_order::acquire)) break;
+        m_batches.wait(batches, std::memory_order::acquire);
+    }
+    m_producer_stall_ns.fetch_add(elapsed_ns(stalled_from), std::memory_order::relaxed);
+}
+
+void file_writer::atomic_histogram_t::record(uint64_t value) noexcept {
+    auto bucket = std::min<size_t>(std::bit_width(value), buckets.size() - 1);
+    buckets[bucket].fetch_add(1, std::memory_order::relaxed);
+}
+
+void file_writer::atomic_histogram_t::reset() noexcept {
+    for (auto &n : buckets)
+        n.store(0, std::memory_order::relaxed);
+}
+
+file_writer::histogram_t file_writer::atomic_histogram_t::load() const noexcept {
+    histogram_t histogram;
+    for (size_t i = 0; i < buckets.size(); ++i)
+        histogram.buckets[i] = buckets[i].load(std::memory_order::relaxed);
+    return histogram;
+}
+
+bool file_writer::time_this_push() noexcept {
+    thread_local uint32_t pushes{0};
+    return pushes++ % 16 == 0;
+}
+
+void file_writer::record_rate(uint64_t bytes) noexcept {
+    auto second = steady_second();
+    auto &bucket = m_rate[static_cast<size_t>(second) % m_rate.size()];
+    if (bucket.second.load(std::memory_order::relaxed) != second) {
+        /* cleared before it is claimed, so that a reader never adds an old second's bytes to this one */
+        bucket.bytes.store(0, std::memory_order::relaxed);
+        bucket.second.store(second, std::memory_order::release);
+    }
+    bucket.bytes.fetch_add(bytes, std::memory_order::relaxed);
+}
+
+void file_writer::reset_stats() noexcept {
+    m_syscalls = 0;
+    m_queue_depth_high = 0;
+    m_pending_bytes_high = 0;
+    m_batch_bytes.reset();
+    m_batch_buffers.reset();
+    m_write_latency.reset();
+    m_batch_latency.reset();
+    m_producer_stall_ns = 0;
+    m_writer_idle_ns = 0;
+    for (auto &bucket : m_rate) {
+        bucket.second.store(-1, std::memory_order::relaxed);
+        bucket.bytes.store(0, std::memory_order::relaxed);
+    }
+}
+
+file_writer::stats_t file_writer::stats() const noexcept {
+    stats_t stats;
+    stats.queue_depth = queue_depth();
+    stats.queue_depth_high = m_queue_depth_high.load(std::memory_order::relaxed);
+    stats.pending_bytes = pending_bytes();
+    stats.pending_bytes_high = m_pending_bytes_high.load(std::memory_order::relaxed);
+
+    stats.batch_bytes = m_batch_bytes.load();
+    stats.batch_buffers = m_batch_buffers.load();
+    stats.write_latency_ns = m_write_latency.load();
+    stats.batch_latency_ns = m_batch_latency.load();
+
+    stats.syscalls = syscall_count();
+    stats.producer_stall = std::chrono::nanoseconds(m_producer_stall_ns.load(std::memory_order::relaxed));
+    stats.writer_idle = std::chrono::nanoseconds(m_writer_idle_ns.load(std::memory_order::relaxed));
+
+    /* whole seconds only, the current one is still being counted */
+    auto now = steady_second();
+    const auto rate = [&](int64_t seconds) {
+        uint64_t bytes{0};
+        for (const auto &bucket : m_rate) {
+            auto second = bucket.second.load(std::memory_order::acquire);
+            if (second < now && second >= now - seconds) bytes += bucket.bytes.load(std::memory_order::relaxed);
+        }
+        return static_cast<double>(bytes) / static_cast<double>(seconds);
+    };
+    stats.bytes_per_second_1s = rate(1);
+    stats.bytes_per_second_10s = rate(10);
+    stats.bytes_per_second_60s = rate(60);
+
+    stats.sync = sync_stats();
+    return stats;
 }
 
 size_t file_writer::bytes_transferred() const
@@ -103,6 +798,33 @@ size_t file_writer::bytes_transferred() const
     return m_byte_count.load(std::memory_order::acquire);
 }
 
+const char *file_writer::backend_name() const {
+    return m_backend ? m_backend->name() : "";
+}
+
+size_t file_writer::syscall_count() const {
+    return m_syscalls.load(std::memory_order::relaxed);
+}
+
+size_t file_writer::pending_bytes() const noexcept {
+    return m_queued_bytes.load(std::memory_order::relaxed) + m_writing_bytes.load(std::memory_order::relaxed);
+}
+
+size_t file_writer::queue_depth() const noexcept {
+    return m_queued_count.load(std::memory_order::relaxed);
+}
+
+size_t file_writer::dropped_count() const noexcept {
+    return m_dropped.load(std::memory_order::relaxed);
+}
+
+file_writer::path_type file_writer::segment_path(const path_type &path, size_t index) {
+    auto name = path.stem();
+    name += fmt::format(".{:06}", index);
+    name += path.extension();
+    return path.parent_path() / name;
+}
+
 
 
 }  // namespace sg
@@ -0,0 +1,134 @@
+#include "sg/file_writer_service.h"
+#include "sg/file_writer.h"
+
+#include <algorithm>
+
+namespace sg {
+
+file_writer_service::file_writer_service() : file_writer_service(options_t{}) {}
+
+file_writer_service::file_writer_service(options_t options) : m_options(options) {
+    m_options.threads = std::max<size_t>(m_options.threads, 1);
+    m_options.max_batch_bytes = std::max<size_t>(m_options.max_batch_bytes, 1);
+
+    for (size_t i = 0; i < m_options.threads; ++i)
+        m_threads.emplace_back([this] { action(); });
+}
+
+file_writer_service::~file_writer_service() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_threads.clear();
+}
+
+size_t file_writer_service::writer_count() const {
+    std::lock_guard lock(m_mutex);
+    return m_writers;
+}
+
+void file_writer_service::attach(file_writer *writer) {
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_writers;
+    }
+    /* a first turn, to set its timers */
+    notify(writer);
+}
+
+void file_writer_service::notify(file_writer *writer) {
+    using state_t = file_writer::service_state_t;
+
+    /* queued for a turn if idle. If it is having a turn, it has another straight after, as the data
+     * may have been pushed too late for this one */
+    auto &state = writer->m_service_state;
+    auto current = state.load(std::memory_order::acquire);
+    while (true) {
+        if (current == state_t::idle) {
+            if (state.compare_exchange_weak(current, state_t::scheduled, std::memory_order::acq_rel))
+                break;
+        } else if (current == state_t::running) {
+            if (state.compare_exchange_weak(current, state_t::notified, std::memory_order::acq_rel))
+                return;
+        } else {
+            return;
+        }
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_ready.push_back(writer);
+    }
+    m_cv.notify_one();
+}
+
+void file_writer_service::set_timer(file_writer *writer,
+                                    std::optional<std::chrono::steady_clock::time_point> deadline) {
+    if (auto it = m_timer_of.find(writer); it != m_timer_of.end()) {
+        m_timers.erase(it->second);
+        m_timer_of.erase(it);
+    }
+    if (deadline) m_timer_of.emplace(writer, m_timers.emplace(*deadline, writer));
+}
+
+void file_writer_service::action() {
+    using state_t = file_writer::service_state_t;
+
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        /* timers due are turns too, unless the writer is having one */
+        auto now = std::chrono::steady_clock::now();
+        while (!m_timers.empty() && m_timers.begin()->first <= now) {
+            auto writer = m_timers.begin()->second;
+            set_timer(writer, std::nullopt);
+            lock.unlock();
+            notify(writer);
+            lock.lock();
+        }
+
+        if (!m_ready.empty()) {
+            auto writer = m_ready.front();
+            m_ready.pop_front();
+            lock.unlock();
+
+            writer->m_service_state.store(state_t::running, std::memory_order::release);
+            auto finished = writer->service_turn(m_options.max_batch_bytes);
+
+            lock.lock();
+            if (finished) {
+                /* the writer may be destroyed as soon as the promise is set */
+                set_timer(writer, std::nullopt);
+                --m_writers;
+                writer->m_service_state.store(state_t::finished, std::memory_order::release);
+                auto done = std::move(writer->m_service_finished);
+                done.set_value();
+                continue;
+            }
+
+            set_timer(writer, writer->next_deadline());
+
+            /* to the back of the line if there is more to do, so that the others get a turn */
+            auto again = !writer->m_data.empty();
+            if (!again) {
+                auto running = state_t::running;
+                again = !writer->m_service_state.compare_exchange_strong(running, state_t::idle,
+                                                                         std::memory_order::acq_rel);
+            }
+            if (again) {
+                writer->m_service_state.store(state_t::scheduled, std::memory_order::release);
+                m_ready.push_back(writer);
+            }
+            continue;
+        }
+
+        if (m_stopping) return;
+        if (m_timers.empty())
+            m_cv.wait(lock);
+        else
+            m_cv.wait_until(lock, m_timers.begin()->first);
+    }
+}
+
+} // namespace sg
@@ -0,0 +1,421 @@
+#include "include/file_writer_backend.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define HAVE_IO_URING 1
+#endif
+
+#if defined(HAVE_IO_URING)
+    #include <fmt/core.h>
+
+    #include <algorithm>
+    #include <atomic>
+    #include <cerrno>
+    #include <cstdlib>
+    #include <cstring>
+    #include <stdexcept>
+    #include <utility>
+    #include <vector>
+
+    #include <fcntl.h>
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+namespace sg {
+
+#if defined(HAVE_IO_URING)
+
+namespace {
+
+/* No liburing, the three system calls are all we need */
+int io_uring_setup(unsigned entries, io_uring_params *p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+std::runtime_error io_uring_error(const char *what, int err) {
+    return std::runtime_error(fmt::format("file_writer (io_uring): {}: {}", what, std::strerror(err)));
+}
+
+/* Direct I/O needs the memory, file offset and length aligned to the logical block size of the
+ * device. 4 KiB covers every device we care about */
+constexpr size_t IO_URING_ALIGNMENT = 4096;
+
+/*
+ * Buffers are copied into fixed size blocks, and each block is written with one request, at the
+ * next offset in the file. Up to queue_depth blocks are in flight at once; when they all are, the
+ * writer thread waits for the oldest to complete.
+ *
+ * The blocks are registered with the kernel (IORING_OP_WRITE_FIXED), which saves it mapping the
+ * pages for every write. If that fails, e.g. because of RLIMIT_MEMLOCK, plain IORING_OP_WRITE is
+ * used.
+ */
+class io_uring_backend : public internal::file_writer_backend {
+    struct block_t {
+        std::byte *data{nullptr};
+        size_t length{0};       // bytes in the block
+        size_t written{0};      // bytes the kernel has written so far, while in flight
+        uint64_t offset{0};     // in the file
+        bool in_flight{false};
+    };
+
+    int m_ring{-1};
+    int m_fd{-1};
+
+    void *m_sq_ring{MAP_FAILED};
+    size_t m_sq_ring_size{0};
+    void *m_cq_ring{MAP_FAILED};
+    size_t m_cq_ring_size{0};
+    io_uring_sqe *m_sqes{static_cast<io_uring_sqe *>(MAP_FAILED)};
+    size_t m_sqes_size{0};
+
+    unsigned *m_sq_tail{nullptr};
+    unsigned *m_sq_mask{nullptr};
+    unsigned *m_sq_array{nullptr};
+    unsigned *m_cq_head{nullptr};
+    unsigned *m_cq_tail{nullptr};
+    unsigned *m_cq_mask{nullptr};
+    io_uring_cqe *m_cqes{nullptr};
+
+    std::byte *m_memory{nullptr};
+    std::vector<block_t> m_blocks;
+    size_t m_block_size{0};
+    size_t m_current{0};        // the block being filled
+    size_t m_in_flight{0};
+    unsigned m_to_submit{0};    // queued in the ring, the kernel not told yet
+
+    uint64_t m_offset{0};       // of the next block
+    size_t m_completed{0};      // bytes written since last reported
+    bool m_fixed{false};
+    bool m_direct{false};
+    bool m_preallocated{false};
+
+  public:
+    io_uring_backend() = default;
+    io_uring_backend(const io_uring_backend &) = delete;
+    io_uring_backend &operator=(const io_uring_backend &) = delete;
+
+    ~io_uring_backend() override {
+        /* Only get here with requests in flight after an error. The kernel may still be writing
+         * from the blocks, so wait for them before freeing anything */
+        try {
+            drain();
+        } catch (...) {
+        }
+        release();
+    }
+
+    /* Returns false if io_uring can't be used at all */
+    bool setup(const file_writer::options_t &options) {
+        auto depth = static_cast<unsigned>(std::max<size_t>(options.queue_depth, 1));
+
+        io_uring_params params{};
+        m_ring = io_uring_setup(depth, &params);
+        if (m_ring < 0) {
+            m_ring = -1;
+            return false;
+        }
+
+        /* IORING_OP_WRITE is 5.6, as is this feature */
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0 || params.sq_entries < depth) return false;
+
+        m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+        m_sq_ring = ::mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring,
+                           IORING_OFF_SQ_RING);
+        if (m_sq_ring == MAP_FAILED) return false;
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            m_cq_ring = m_sq_ring;
+        } else {
+            m_cq_ring = ::mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               m_ring, IORING_OFF_CQ_RING);
+            if (m_cq_ring == MAP_FAILED) return false;
+        }
+
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        auto sqes = ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring,
+                           IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        m_sqes = static_cast<io_uring_sqe *>(sqes);
+
+        auto sq = static_cast<char *>(m_sq_ring);
+        m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        auto cq = static_cast<char *>(m_cq_ring);
+        m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        /* the blocks, one allocation */
+        m_block_size = (std::max<size_t>(options.block_size, 1) + IO_URING_ALIGNMENT - 1) & ~(IO_URING_ALIGNMENT - 1);
+        m_memory = static_cast<std::byte *>(std::aligned_alloc(IO_URING_ALIGNMENT, m_block_size * depth));
+        if (m_memory == nullptr) throw std::bad_alloc();
+
+        m_blocks.resize(depth);
+        std::vector<iovec> iovecs(depth);
+        for (size_t i = 0; i < depth; ++i) {
+            m_blocks[i].data = m_memory + i * m_block_size;
+            iovecs[i] = iovec{m_blocks[i].data, m_block_size};
+        }
+        m_fixed = io_uring_register(m_ring, IORING_REGISTER_BUFFERS, iovecs.data(), depth) == 0;
+
+        return true;
+    }
+
+    void open(const file_writer::path_type &path, bool direct) {
+        constexpr int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        if (direct) {
+            m_fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+            /* not supported by the filesystem, e.g. tmpfs */
+            if (m_fd >= 0) m_direct = true;
+        }
+        if (m_fd < 0) m_fd = ::open(path.c_str(), flags, 0644);
+        if (m_fd < 0) throw io_uring_error(path.c_str(), errno);
+    }
+
+    const char *name() const noexcept override { return "io_uring"; }
+
+    void preallocate(size_t bytes) override {
+        m_preallocated = ::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) == 0;
+    }
+
+    size_t write(std::deque<file_writer::buffer_type> &buffers) override {
+        while (!buffers.empty()) {
+            auto buff = buffers.front();
+            auto src = buff.get();
+            auto remaining = buff.size();
+
+            while (remaining > 0) {
+                auto &block = m_blocks[m_current];
+                auto n = std::min(remaining, m_block_size - block.length);
+                std::memcpy(block.data + block.length, src, n);
+                block.length += n;
+                src += n;
+                remaining -= n;
+
+                if (block.length == m_block_size) submit_current();
+            }
+
+            buffers.pop_front();
+        }
+
+        /* With direct I/O, a block must be written whole, so keep the partial block until it is
+         * full. Otherwise write it now, rather than hold data back for an unknown time */
+        if (!m_direct && m_blocks[m_current].length > 0) submit_current();
+
+        enter(0);
+        reap();
+
+        return std::exchange(m_completed, 0);
+    }
+
+    size_t sync() override {
+        drain();
+
+        /* With direct I/O, the partial block is written without it, and is kept to be written again
+         * once full. Its offset stays aligned, as only whole blocks move m_offset on */
+        auto &block = m_blocks[m_current];
+        if (m_direct && block.length > 0) {
+            set_direct(false);
+            write_tail(block);
+            set_direct(true);
+        }
+
+        auto r = ::fdatasync(m_fd);
+        count_syscall();
+        if (r < 0) throw io_uring_error("fdatasync", errno);
+
+        return std::exchange(m_completed, 0);
+    }
+
+    size_t close() override {
+        if (m_fd < 0) return 0;
+
+        if (!m_direct && m_blocks[m_current].length > 0) submit_current();
+        drain();
+
+        /* the last, partial, block can't be written with O_DIRECT */
+        auto &block = m_blocks[m_current];
+        if (block.length > 0) {
+            set_direct(false);
+            write_tail(block);
+            m_completed += block.length;
+            m_offset += block.length;
+            block.length = 0;
+        }
+
+        /* gives back what was reserved and not used */
+        if (m_preallocated) (void)::ftruncate(m_fd, static_cast<off_t>(m_offset));
+
+        auto fd = std::exchange(m_fd, -1);
+        if (::close(fd) < 0) throw io_uring_error("close", errno);
+
+        return std::exchange(m_completed, 0);
+    }
+
+  private:
+    void set_direct(bool direct) {
+        auto flags = ::fcntl(m_fd, F_GETFL);
+        if (flags < 0 || ::fcntl(m_fd, F_SETFL, direct ? (flags | O_DIRECT) : (flags & ~O_DIRECT)) < 0)
+            throw io_uring_error("fcntl", errno);
+    }
+
+    /* Writes the partial block being filled, synchronously, at the end of the file */
+    void write_tail(const block_t &block) {
+        size_t written{0};
+        while (written < block.length) {
+            auto r = ::pwrite(m_fd, block.data + written, block.length - written,
+                              static_cast<off_t>(m_offset + written));
+            count_syscall();
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw io_uring_error("pwrite", errno);
+            }
+            written += static_cast<size_t>(r);
+        }
+    }
+
+    void release() noexcept {
+        if (m_fd >= 0) ::close(m_fd);
+        if (m_sqes != MAP_FAILED) ::munmap(m_sqes, m_sqes_size);
+        if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) ::munmap(m_cq_ring, m_cq_ring_size);
+        if (m_sq_ring != MAP_FAILED) ::munmap(m_sq_ring, m_sq_ring_size);
+        /* also unregisters the buffers */
+        if (m_ring >= 0) ::close(m_ring);
+        std::free(m_memory);
+    }
+
+    /* Queues a write of the (remainder of the) block, the kernel is told in enter() */
+    void queue(size_t index) {
+        auto &block = m_blocks[index];
+        std::atomic_ref<unsigned> tail(*m_sq_tail);
+        auto t = tail.load(std::memory_order::relaxed);
+        auto slot = t & *m_sq_mask;
+
+        auto &sqe = m_sqes[slot];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = m_fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd = m_fd;
+        sqe.addr = reinterpret_cast<uint64_t>(block.data + block.written);
+        sqe.len = static_cast<uint32_t>(block.length - block.written);
+        sqe.off = block.offset + block.written;
+        sqe.buf_index = static_cast<uint16_t>(m_fixed ? index : 0);
+        sqe.user_data = index;
+
+        m_sq_array[slot] = slot;
+        tail.store(t + 1, std::memory_order::release);
+        ++m_to_submit;
+    }
+
+    /* Submits the block being filled, and moves on to a free one, waiting for one if need be */
+    void submit_current() {
+        auto &block = m_blocks[m_current];
+        block.offset = m_offset;
+        block.written = 0;
+        block.in_flight = true;
+        m_offset += block.length;
+        ++m_in_flight;
+        queue(m_current);
+
+        m_current = (m_current + 1) % m_blocks.size();
+        /* blocks complete in any order, but are reused in turn, so only the next one matters */
+        while (m_blocks[m_current].in_flight) {
+            enter(1);
+            reap();
+        }
+    }
+
+    /* Submits what is queued, and waits for at least min_complete completions */
+    void enter(unsigned min_complete) {
+        while (m_to_submit > 0 || min_complete > 0) {
+            auto r = io_uring_enter(m_ring, m_to_submit, min_complete, min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+            count_syscall();
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw io_uring_error("io_uring_enter", errno);
+            }
+            m_to_submit -= static_cast<unsigned>(r);
+            /* anything submitted also means min_complete were waited for */
+            min_complete = 0;
+        }
+    }
+
+    /* Handles the completions there are, without waiting */
+    void reap() {
+        std::atomic_ref<unsigned> head_ref(*m_cq_head);
+        std::atomic_ref<unsigned> tail_ref(*m_cq_tail);
+
+        auto head = head_ref.load(std::memory_order::relaxed);
+        auto tail = tail_ref.load(std::memory_order::acquire);
+        while (head != tail) {
+            auto cqe = m_cqes[head & *m_cq_mask];
+            ++head;
+            head_ref.store(head, std::memory_order::release);
+
+            auto &block = m_blocks[cqe.user_data];
+            if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN) {
+                block.in_flight = false;
+                --m_in_flight;
+                throw io_uring_error("write", -cqe.res);
+            }
+
+            block.written += static_cast<size_t>(std::max(cqe.res, 0));
+            if (block.written < block.length) {
+                /* short write, write the rest */
+                queue(cqe.user_data);
+                continue;
+            }
+
+            m_completed += block.length;
+            block.length = 0;
+            block.in_flight = false;
+            --m_in_flight;
+        }
+    }
+
+    /* Waits for everything in flight */
+    void drain() {
+        while (m_in_flight > 0) {
+            enter(1);
+            reap();
+        }
+    }
+};
+
+} // namespace
+
+std::unique_ptr<internal::file_writer_backend>
+internal::make_io_uring_backend(const file_writer::path_type &path, const file_writer::options_t &options) {
+    auto backend = std::make_unique<io_uring_backend>();
+    if (!backend->setup(options)) return nullptr;
+    backend->open(path, options.direct_io);
+    return backend;
+}
+
+#else
+
+std::unique_ptr<internal::file_writer_backend>
+internal::make_io_uring_backend(const file_writer::path_type &, const file_writer::options_t &) {
+    return nullptr;
+}
+
+#endif
+
+} // namespace sg
@@ -0,0 +1,511 @@
+#include "include/xxh3_accumulate.h"
+
+#include <sg/cpu.h>
+#include <sg/hash.h>
+
+#include <algorithm>
+#include <cstring>
+
+/* XXH3, following the xxHash 0.8 reference (BSD-2-Clause, Yann Collet). Inputs up to 240 bytes are
+ * hashed with scalar code, longer ones with the accumulate/scramble kernels from xxh3_accumulate.h,
+ * picked once at runtime. */
+
+namespace {
+
+using sg::checksum::hash128_t;
+
+constexpr std::size_t SECRET_SIZE = 192;
+constexpr std::size_t SECRET_LIMIT = SECRET_SIZE - XXH3_STRIPE_LENGTH;
+constexpr std::size_t STRIPES_PER_BLOCK = SECRET_LIMIT / XXH3_SECRET_CONSUME_RATE;
+constexpr std::size_t BLOCK_LENGTH = STRIPES_PER_BLOCK * XXH3_STRIPE_LENGTH;
+constexpr std::size_t MIDSIZE_MAX = 240;
+constexpr std::size_t SECRET_SIZE_MIN = 136;
+constexpr std::size_t MIDSIZE_START_OFFSET = 3;
+constexpr std::size_t MIDSIZE_LAST_OFFSET = 17;
+constexpr std::size_t SECRET_LASTACC_START = 7;
+constexpr std::size_t SECRET_MERGEACCS_START = 11;
+
+constexpr uint32_t PRIME32_2 = 0x85EBCA77U;
+constexpr uint32_t PRIME32_3 = 0xC2B2AE3DU;
+constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+constexpr uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+constexpr uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+constexpr uint64_t INIT_ACC[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+                                  PRIME64_4, PRIME32_2, PRIME64_5, XXH3_PRIME32_1};
+
+/* The default secret, taken from FARSH */
+alignas(64) constexpr uint8_t DEFAULT_SECRET[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/******************************** kernels *******************************/
+
+struct xxh3_kernel_t {
+    xxh3_accumulate_fn_t accumulate;
+    xxh3_scramble_fn_t scramble;
+    const char *name;
+};
+
+xxh3_kernel_t select_xxh3_kernel() {
+    [[maybe_unused]] const auto &cpu = sg::cpu::features();
+
+#if defined(HAVE_XXH3_AVX512)
+    if (cpu.avx512)
+        return {xxh3_accumulate_avx512, xxh3_scramble_avx512, "avx512"};
+#endif
+#if defined(HAVE_XXH3_AVX2)
+    if (cpu.avx2)
+        return {xxh3_accumulate_avx2, xxh3_scramble_avx2, "avx2"};
+#endif
+#if defined(HAVE_XXH3_SSE2)
+    // SSE2 is part of x86-64, and any CPU with SSE4.2 has it
+    if (sizeof(void *) == 8 || cpu.sse42)
+        return {xxh3_accumulate_sse2, xxh3_scramble_sse2, "sse2"};
+#endif
+#if defined(HAVE_XXH3_NEON)
+    return {xxh3_accumulate_neon, xxh3_scramble_neon, "neon"};
+#endif
+
+    return {xxh3_accumulate_scalar, xxh3_scramble_scalar, "scalar"};
+}
+
+const xxh3_kernel_t &xxh3_kernel() {
+    static const xxh3_kernel_t kernel = select_xxh3_kernel();
+    return kernel;
+}
+
+/********************************* mixing *******************************/
+
+hash128_t mult64to128(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    auto product = static_cast<unsigned __int128>(a) * b;
+    return {static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+#else
+    auto loLo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    auto hiLo = (a >> 32) * (b & 0xFFFFFFFF);
+    auto loHi = (a & 0xFFFFFFFF) * (b >> 32);
+    auto hiHi = (a >> 32) * (b >> 32);
+    auto cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+    return {(cross << 32) | (loLo & 0xFFFFFFFF), (hiLo >> 32) + (cross >> 32) + hiHi};
+#endif
+}
+
+uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+    auto product = mult64to128(a, b);
+    return product.low64 ^ product.high64;
+}
+
+constexpr uint64_t rotl64(uint64_t v, int r) { return (v << r) | (v >> (64 - r)); }
+
+constexpr uint32_t rotl32(uint32_t v, int r) { return (v << r) | (v >> (32 - r)); }
+
+constexpr uint64_t xorshift64(uint64_t v, int shift) { return v ^ (v >> shift); }
+
+/* The XXH64 avalanche */
+constexpr uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+constexpr uint64_t avalanche(uint64_t h) {
+    h = xorshift64(h, 37);
+    h *= PRIME_MX1;
+    return xorshift64(h, 32);
+}
+
+constexpr uint64_t rrmxmx(uint64_t h, uint64_t length) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + length;
+    h *= PRIME_MX2;
+    return xorshift64(h, 28);
+}
+
+uint64_t mix16(const uint8_t *input, const uint8_t *secret, uint64_t seed) {
+    return mul128_fold64(xxh3_read64(input) ^ (xxh3_read64(secret) + seed),
+                         xxh3_read64(input + 8) ^ (xxh3_read64(secret + 8) - seed));
+}
+
+hash128_t mix32(hash128_t acc, const uint8_t *input1, const uint8_t *input2, const uint8_t *secret,
+                uint64_t seed) {
+    acc.low64 += mix16(input1, secret, seed);
+    acc.low64 ^= xxh3_read64(input2) + xxh3_read64(input2 + 8);
+    acc.high64 += mix16(input2, secret + 16, seed);
+    acc.high64 ^= xxh3_read64(input1) + xxh3_read64(input1 + 8);
+    return acc;
+}
+
+/* Secret for long inputs with a non-zero seed */
+void init_secret(uint8_t *secret, uint64_t seed) {
+    for (std::size_t i = 0; i < SECRET_SIZE / 16; ++i) {
+        auto lo = xxh3_read64(DEFAULT_SECRET + 16 * i) + seed;
+        auto hi = xxh3_read64(DEFAULT_SECRET + 16 * i + 8) - seed;
+        if constexpr (std::endian::native == std::endian::big) {
+            lo = sg::bytes::byteswap(lo);
+            hi = sg::bytes::byteswap(hi);
+        }
+        std::memcpy(secret + 16 * i, &lo, 8);
+        std::memcpy(secret + 16 * i + 8, &hi, 8);
+    }
+}
+
+/****************************** short inputs ****************************/
+
+uint64_t hash64_0to16(const uint8_t *input, std::size_t length, const uint8_t *secret,
+                      uint64_t seed) {
+    if (length > 8) {
+        auto bitflip1 = (xxh3_read64(secret + 24) ^ xxh3_read64(secret + 32)) + seed;
+        auto bitflip2 = (xxh3_read64(secret + 40) ^ xxh3_read64(secret + 48)) - seed;
+        auto lo = xxh3_read64(input) ^ bitflip1;
+        auto hi = xxh3_read64(input + length - 8) ^ bitflip2;
+        auto acc = length + sg::bytes::byteswap(lo) + hi + mul128_fold64(lo, hi);
+        return avalanche(acc);
+    }
+    if (length >= 4) {
+        seed ^= uint64_t(sg::bytes::byteswap(static_cast<uint32_t>(seed))) << 32;
+        auto input1 = xxh3_read32(input);
+        auto input2 = xxh3_read32(input + length - 4);
+        auto bitflip = (xxh3_read64(secret + 8) ^ xxh3_read64(secret + 16)) - seed;
+        auto input64 = input2 + (uint64_t(input1) << 32);
+        return rrmxmx(input64 ^ bitflip, length);
+    }
+    if (length) {
+        uint32_t combined = (uint32_t(input[0]) << 16) | (uint32_t(input[length >> 1]) << 24) |
+                            uint32_t(input[length - 1]) | (uint32_t(length) << 8);
+        auto bitflip = (xxh3_read32(secret) ^ xxh3_read32(secret + 4)) + seed;
+        return xxh64_avalanche(combined ^ bitflip);
+    }
+    return xxh64_avalanche(seed ^ (xxh3_read64(secret + 56) ^ xxh3_read64(secret + 64)));
+}
+
+uint64_t hash64_17to128(const uint8_t *input, std::size_t length, const uint8_t *secret,
+                        uint64_t seed) {
+    uint64_t acc = length * PRIME64_1;
+    if (length > 32) {
+        if (length > 64) {
+            if (length > 96) {
+                acc += mix16(input + 48, secret + 96, seed);
+                acc += mix16(input + length - 64, secret + 112, seed);
+            }
+            acc += mix16(input + 32, secret + 64, seed);
+            acc += mix16(input + length - 48, secret + 80, seed);
+        }
+        acc += mix16(input + 16, secret + 32, seed);
+        acc += mix16(input + length - 32, secret + 48, seed);
+    }
+    acc += mix16(input, secret, seed);
+    acc += mix16(input + length - 16, secret + 16, seed);
+    return avalanche(acc);
+}
+
+uint64_t hash64_129to240(const uint8_t *input, std::size_t length, const uint8_t *secret,
+                         uint64_t seed) {
+    uint64_t acc = length * PRIME64_1;
+    for (std::size_t i = 0; i < 8; ++i)
+        acc += mix16(input + 16 * i, secret + 16 * i, seed);
+    acc = avalanche(acc);
+
+    auto accEnd = mix16(input + length - 16, secret + SECRET_SIZE_MIN - MIDSIZE_LAST_OFFSET, seed);
+    for (std::size_t i = 8; i < length / 16; ++i)
+        accEnd += mix16(input + 16 * i, secret + 16 * (i - 8) + MIDSIZE_START_OFFSET, seed);
+    return avalanche(acc + accEnd);
+}
+
+hash128_t hash128_0to16(const uint8_t *input, std::size_t length, const uint8_t *secret,
+                        uint64_t seed) {
+    if (length > 8) {
+        auto bitflipl = (xxh3_read64(secret + 32) ^ xxh3_read64(secret + 40)) - seed;
+        auto bitfliph = (xxh3_read64(secret + 48) ^ xxh3_read64(secret + 56)) + seed;
+        auto lo = xxh3_read64(input);
+        auto hi = xxh3_read64(input + length - 8);
+        auto m = mult64to128(lo ^ hi ^ bitflipl, PRIME64_1);
+        m.low64 += uint64_t(length - 1) << 54;
+        hi ^= bitfliph;
+        m.high64 += hi + (hi & 0xFFFFFFFF) * (PRIME32_2 - 1);
+        m.low64 ^= sg::bytes::byteswap(m.high64);
+
+        auto h = mult64to128(m.low64, PRIME64_2);
+        h.high64 += m.high64 * PRIME64_2;
+        return {avalanche(h.low64), avalanche(h.high64)};
+    }
+    if (length >= 4) {
+        seed ^= uint64_t(sg::bytes::byteswap(static_cast<uint32_t>(seed))) << 32;
+        auto lo = xxh3_read32(input);
+        auto hi = xxh3_read32(input + length - 4);
+        auto input64 = lo + (uint64_t(hi) << 32);
+        auto bitflip = (xxh3_read64(secret + 16) ^ xxh3_read64(secret + 24)) + seed;
+        auto m = mult64to128(input64 ^ bitflip, PRIME64_1 + (length << 2));
+        m.high64 += m.low64 << 1;
+        m.low64 ^= m.high64 >> 3;
+        m.low64 = xorshift64(m.low64, 35);
+        m.low64 *= PRIME_MX2;
+        m.low64 = xorshift64(m.low64, 28);
+        m.high64 = avalanche(m.high64);
+        return m;
+    }
+    if (length) {
+        uint32_t combinedl = (uint32_t(input[0]) << 16) | (uint32_t(input[length >> 1]) << 24) |
+                             uint32_t(input[length - 1]) | (uint32_t(length) << 8);
+        uint32_t combinedh = rotl32(sg::bytes::byteswap(combinedl), 13);
+        auto bitflipl = (xxh3_read32(secret) ^ xxh3_read32(secret + 4)) + seed;
+        auto bitfliph = (xxh3_read32(secret + 8) ^ xxh3_read32(secret + 12)) - seed;
+        return {xxh64_avalanche(combinedl ^ bitflipl), xxh64_avalanche(combinedh ^ bitfliph)};
+    }
+    auto bitflipl = xxh3_read64(secret + 64) ^ xxh3_read64(secret + 72);
+    auto bitfliph = xxh3_read64(secret + 80) ^ xxh3_read64(secret + 88);
+    return {xxh64_avalanche(seed ^ bitflipl), xxh64_avalanche(seed ^ bitfliph)};
+}
+
+hash128_t finish128(hash128_t acc, std::size_t length, uint64_t seed) {
+    hash128_t h;
+    h.low64 = avalanche(acc.low64 + acc.high64);
+    h.high64 = acc.low64 * PRIME64_1 + acc.high64 * PRIME64_4 + (length - seed) * PRIME64_2;
+    h.high64 = uint64_t(0) - avalanche(h.high64);
+    return h;
+}
+
+hash128_t hash128_17to128(const uint8_t *input, std::size_t length, const uint8_t *secret,
+                          uint64_t seed) {
+    hash128_t acc{length * PRIME64_1, 0};
+    if (length > 32) {
+        if (length > 64) {
+            if (length > 96)
+                acc = mix32(acc, input + 48, input + length - 64, secret + 96, seed);
+            acc = mix32(acc, input + 32, input + length - 48, secret + 64, seed);
+        }
+        acc = mix32(acc, input + 16, input + length - 32, secret + 32, seed);
+    }
+    acc = mix32(acc, input, input + length - 16, secret, seed);
+    return finish128(acc, length, seed);
+}
+
+hash128_t hash128_129to240(const uint8_t *input, std::size_t length, const uint8_t *secret,
+                           uint64_t seed) {
+    hash128_t acc{length * PRIME64_1, 0};
+    for (std::size_t i = 32; i < 160; i += 32)
+        acc = mix32(acc, input + i - 32, input + i - 16, secret + i - 32, seed);
+    acc.low64 = avalanche(acc.low64);
+    acc.high64 = avalanche(acc.high64);
+
+    for (std::size_t i = 160; i <= length; i += 32)
+        acc = mix32(acc, input + i - 32, input + i - 16, secret + MIDSIZE_START_OFFSET + i - 160,
+                    seed);
+    acc = mix32(acc, input + length - 16, input + length - 32,
+                secret + SECRET_SIZE_MIN - MIDSIZE_LAST_OFFSET - 16, uint64_t(0) - seed);
+    return finish128(acc, length, seed);
+}
+
+/****************************** long inputs *****************************/
+
+uint64_t merge_accs(const uint64_t *acc, const uint8_t *secret, uint64_t start) {
+    for (std::size_t i = 0; i < 4; ++i)
+        start += mul128_fold64(acc[2 * i] ^ xxh3_read64(secret + 16 * i),
+                               acc[2 * i + 1] ^ xxh3_read64(secret + 16 * i + 8));
+    return avalanche(start);
+}
+
+uint64_t merge64(const uint64_t *acc, const uint8_t *secret, uint64_t length) {
+    return merge_accs(acc, secret + SECRET_MERGEACCS_START, length * PRIME64_1);
+}
+
+hash128_t merge128(const uint64_t *acc, const uint8_t *secret, uint64_t length) {
+    return {merge_accs(acc, secret + SECRET_MERGEACCS_START, length * PRIME64_1),
+            merge_accs(acc, secret + SECRET_SIZE - 64 - SECRET_MERGEACCS_START,
+                       ~(length * PRIME64_2))};
+}
+
+/* Accumulates all of a (longer than 240 bytes) input, with the last stripe overlapping */
+void hash_long(uint64_t *acc, const uint8_t *input, std::size_t length, const uint8_t *secret) {
+    const auto &kernel = xxh3_kernel();
+    std::copy(std::begin(INIT_ACC), std::end(INIT_ACC), acc);
+
+    auto blocks = (length - 1) / BLOCK_LENGTH;
+    for (std::size_t n = 0; n < blocks; ++n) {
+        kernel.accumulate(acc, input + n * BLOCK_LENGTH, secret, STRIPES_PER_BLOCK);
+        kernel.scramble(acc, secret + SECRET_LIMIT);
+    }
+
+    auto stripes = ((length - 1) - BLOCK_LENGTH * blocks) / XXH3_STRIPE_LENGTH;
+    kernel.accumulate(acc, input + blocks * BLOCK_LENGTH, secret, stripes);
+    kernel.accumulate(acc, input + length - XXH3_STRIPE_LENGTH,
+                      secret + SECRET_LIMIT - SECRET_LASTACC_START, 1);
+}
+
+/* The default secret, or one derived from the seed */
+const uint8_t *long_secret(uint64_t seed, uint8_t *custom) {
+    if (seed == 0)
+        return DEFAULT_SECRET;
+    init_secret(custom, seed);
+    return custom;
+}
+
+} // namespace
+
+namespace sg::checksum {
+
+uint64_t xxh3_64(const void *data, std::size_t length, uint64_t seed) {
+    auto input = static_cast<const uint8_t *>(data);
+    if (length <= 16)
+        return hash64_0to16(input, length, DEFAULT_SECRET, seed);
+    if (length <= 128)
+        return hash64_17to128(input, length, DEFAULT_SECRET, seed);
+    if (length <= MIDSIZE_MAX)
+        return hash64_129to240(input, length, DEFAULT_SECRET, seed);
+
+    alignas(64) uint8_t custom[SECRET_SIZE];
+    alignas(64) uint64_t acc[8];
+    auto secret = long_secret(seed, custom);
+    hash_long(acc, input, length, secret);
+    return merge64(acc, secret, length);
+}
+
+hash128_t xxh3_128(const void *data, std::size_t length, uint64_t seed) {
+    auto input = static_cast<const uint8_t *>(data);
+    if (length <= 16)
+        return hash128_0to16(input, length, DEFAULT_SECRET, seed);
+    if (length <= 128)
+        return hash128_17to128(input, length, DEFAULT_SECRET, seed);
+    if (length <= MIDSIZE_MAX)
+        return hash128_129to240(input, length, DEFAULT_SECRET, seed);
+
+    alignas(64) uint8_t custom[SECRET_SIZE];
+    alignas(64) uint64_t acc[8];
+    auto secret = long_secret(seed, custom);
+    hash_long(acc, input, length, secret);
+    return merge128(acc, secret, length);
+}
+
+const char *xxh3_implementation() { return xxh3_kernel().name; }
+
+/******************************* streaming ******************************/
+
+xxh3_state::xxh3_state(uint64_t seed) { reset(seed); }
+
+void xxh3_state::reset(uint64_t seed) {
+    std::copy(std::begin(INIT_ACC), std::end(INIT_ACC), m_acc);
+    if (seed == 0)
+        std::memcpy(m_secret, DEFAULT_SECRET, SECRET_SIZE);
+    else
+        init_secret(m_secret, seed);
+
+    m_buffered = 0;
+    m_stripesSoFar = 0;
+    m_totalLength = 0;
+    m_seed = seed;
+}
+
+void xxh3_state::consume_stripes(uint64_t *acc, std::size_t &stripesSoFar, const uint8_t *input,
+                                 std::size_t nbStripes) const {
+    const auto &kernel = xxh3_kernel();
+
+    /* finish the current block, then whole blocks, scrambling after each */
+    while (nbStripes >= STRIPES_PER_BLOCK - stripesSoFar) {
+        auto count = STRIPES_PER_BLOCK - stripesSoFar;
+        kernel.accumulate(acc, input, m_secret + stripesSoFar * XXH3_SECRET_CONSUME_RATE, count);
+        kernel.scramble(acc, m_secret + SECRET_LIMIT);
+        input += count * XXH3_STRIPE_LENGTH;
+        nbStripes -= count;
+        stripesSoFar = 0;
+    }
+
+    kernel.accumulate(acc, input, m_secret + stripesSoFar * XXH3_SECRET_CONSUME_RATE, nbStripes);
+    stripesSoFar += nbStripes;
+}
+
+void xxh3_state::update(const void *data, std::size_t length) {
+    if (length == 0)
+        return;
+
+    auto input = static_cast<const uint8_t *>(data);
+    auto end = input + length;
+    m_totalLength += length;
+
+    if (length <= sizeof(m_buffer) - m_buffered) {
+        std::memcpy(m_buffer + m_buffered, input, length);
+        m_buffered += length;
+        return;
+    }
+
+    /* There is more than a buffer's worth of input. The last stripe is always kept back (in the
+     * buffer), as digesting treats it differently */
+    constexpr std::size_t BUFFER_STRIPES = sizeof(m_buffer) / XXH3_STRIPE_LENGTH;
+    if (m_buffered) {
+        auto fill = sizeof(m_buffer) - m_buffered;
+        std::memcpy(m_buffer + m_buffered, input, fill);
+        input += fill;
+        consume_stripes(m_acc, m_stripesSoFar, m_buffer, BUFFER_STRIPES);
+        m_buffered = 0;
+    }
+
+    if (static_cast<std::size_t>(end - input) > sizeof(m_buffer)) {
+        auto nbStripes = static_cast<std::size_t>(end - 1 - input) / XXH3_STRIPE_LENGTH;
+        consume_stripes(m_acc, m_stripesSoFar, input, nbStripes);
+        input += nbStripes * XXH3_STRIPE_LENGTH;
+        // keep the last consumed stripe, in case the rest is shorter than a stripe
+        std::memcpy(m_buffer + sizeof(m_buffer) - XXH3_STRIPE_LENGTH, input - XXH3_STRIPE_LENGTH,
+                    XXH3_STRIPE_LENGTH);
+    }
+
+    m_buffered = static_cast<std::size_t>(end - input);
+    std::memcpy(m_buffer, input, m_buffered);
+}
+
+void xxh3_state::digest_long(uint64_t *acc) const {
+    std::copy(std::begin(m_acc), std::end(m_acc), acc);
+
+    const uint8_t *lastStripe;
+    uint8_t stripe[XXH3_STRIPE_LENGTH];
+    if (m_buffered >= XXH3_STRIPE_LENGTH) {
+        auto stripesSoFar = m_stripesSoFar;
+        consume_stripes(acc, stripesSoFar, m_buffer, (m_buffered - 1) / XXH3_STRIPE_LENGTH);
+        lastStripe = m_buffer + m_buffered - XXH3_STRIPE_LENGTH;
+    } else {
+        // the last stripe starts in the previous, already consumed, stripe
+        auto catchup = XXH3_STRIPE_LENGTH - m_buffered;
+        std::memcpy(stripe, m_buffer + sizeof(m_buffer) - catchup, catchup);
+        std::memcpy(stripe + catchup, m_buffer, m_buffered);
+        lastStripe = stripe;
+    }
+
+    xxh3_kernel().accumulate(acc, lastStripe, m_secret + SECRET_LIMIT - SECRET_LASTACC_START, 1);
+}
+
+uint64_t xxh3_state::digest64() const {
+    if (m_totalLength <= MIDSIZE_MAX)
+        return xxh3_64(m_buffer, static_cast<std::size_t>(m_totalLength), m_seed);
+
+    alignas(64) uint64_t acc[8];
+    digest_long(acc);
+    return merge64(acc, m_secret, m_totalLength);
+}
+
+hash128_t xxh3_state::digest128() const {
+    if (m_totalLength <= MIDSIZE_MAX)
+        return xxh3_128(m_buffer, static_cast<std::size_t>(m_totalLength), m_seed);
+
+    alignas(64) uint64_t acc[8];
+    digest_long(acc);
+    return merge128(acc, m_secret, m_totalLength);
+}
+
+} // namespace sg::checksum
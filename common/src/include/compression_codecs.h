@@ -0,0 +1,17 @@
+#pragma once
+
+#include <sg/compression.h>
+
+/* Codec implementations, each defined alongside the rest of the code for that codec */
+
+namespace sg::compression::internal {
+
+#ifdef LIBSG_ZSTD
+[[nodiscard]] const ICodec& zstd_codec();
+#endif
+
+#ifdef LIBSG_LZ4
+[[nodiscard]] const ICodec& lz4_codec();
+#endif
+
+} // namespace sg::compression::internal
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Tabular CRC-16, using slicing-by-8
+ *
+ * Tables are built at compile time. Table k holds the CRC of each byte value followed by k zero
+ * bytes, so 8 bytes can be processed with 8 independent lookups.
+ *
+ * Both bit-reflected (e.g. ARC, MODBUS) and normal (e.g. CCITT/XMODEM) polynomials are supported.
+ * All functions take and return the raw CRC register, i.e. before any final xor. */
+
+namespace {
+
+struct crc16_tables_t {
+    uint16_t t[8][256];
+};
+
+constexpr crc16_tables_t compute_crc16_tables(uint16_t polynomial, bool reflected) {
+    crc16_tables_t tables{};
+
+    for (unsigned i = 0; i < 256; ++i) {
+        uint16_t R = reflected ? uint16_t(i) : uint16_t(i << 8);
+        for (int j = 0; j < 8; ++j) {
+            if (reflected)
+                R = (R & 1) ? uint16_t((R >> 1) ^ polynomial) : uint16_t(R >> 1);
+            else
+                R = (R & 0x8000) ? uint16_t((R << 1) ^ polynomial) : uint16_t(R << 1);
+        }
+        tables.t[0][i] = R;
+    }
+
+    // churn each table's entries through 8 more zero bits, to get the next table
+    for (int k = 1; k < 8; ++k) {
+        for (unsigned i = 0; i < 256; ++i) {
+            uint16_t R = tables.t[k - 1][i];
+            tables.t[k][i] = reflected ? uint16_t((R >> 8) ^ tables.t[0][R & 0xFF])
+                                       : uint16_t((R << 8) ^ tables.t[0][R >> 8]);
+        }
+    }
+
+    return tables;
+}
+
+template <uint16_t Polynomial, bool Reflected>
+constexpr crc16_tables_t crc16_tables = compute_crc16_tables(Polynomial, Reflected);
+
+template <uint16_t Polynomial, bool Reflected>
+uint16_t crc16_tabular(const void *data, std::size_t length, uint16_t prev) {
+    const auto &T = crc16_tables<Polynomial, Reflected>.t;
+    auto M = static_cast<const uint8_t *>(data);
+    uint16_t R = prev;
+
+    for (; length >= 8; length -= 8, M += 8) {
+        if constexpr (Reflected) {
+            R ^= uint16_t(M[0] | (M[1] << 8));
+            R = T[7][R & 0xFF] ^ T[6][R >> 8] ^ T[5][M[2]] ^ T[4][M[3]] ^
+                T[3][M[4]] ^ T[2][M[5]] ^ T[1][M[6]] ^ T[0][M[7]];
+        } else {
+            R ^= uint16_t((M[0] << 8) | M[1]);
+            R = T[7][R >> 8] ^ T[6][R & 0xFF] ^ T[5][M[2]] ^ T[4][M[3]] ^
+                T[3][M[4]] ^ T[2][M[5]] ^ T[1][M[6]] ^ T[0][M[7]];
+        }
+    }
+
+    // Run 1-byte algorithm on any remaning bytes
+    for (; length; --length, ++M) {
+        if constexpr (Reflected)
+            R = (R >> 8) ^ T[0][(R ^ *M) & 0xFF];
+        else
+            R = uint16_t(R << 8) ^ T[0][((R >> 8) ^ *M) & 0xFF];
+    }
+
+    return R;
+}
+
+} // namespace
@@ -6,7 +6,7 @@
 
 namespace {
 
-inline uint32_t crc32_hardware_armv7(const void * data, uint32_t no_of_bytes, uint32_t prev){
+CRC_TARGET_ARM_CRC inline uint32_t crc32_hardware_armv7(const void * data, std::size_t no_of_bytes, uint32_t prev){
     auto R = prev;
     auto M = (const uint8_t*)data;
 
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "crc32c_defs.h"
+#include "crc32_hardware_clmul.h"
+
+/* Hardware assisted CRC32, for any bit-reflected 32-bit polynomial (i.e. both CRC32-C and CRC32),
+ * using AVX-512 and VPCLMULQDQ.
+ *
+ * The input is folded 256 bytes at a time, in four 512-bit accumulators, each holding four 128-bit
+ * lanes. Folding a 128-bit lane forward by D bytes is two carry-less multiplications, of its low
+ * 64 bits by x^(8D+31) mod P and of its high 64 bits by x^(8D-33) mod P, as in
+ * crc32_hardware_clmul.h, which this extends to 512-bit vectors.
+ *
+ * Built with target attributes, so only call it if the CPU supports AVX-512 F/BW/VL, VPCLMULQDQ
+ * and PCLMULQDQ.
+ */
+
+#if defined(HAVE_HARDWARE_CRC32_AVX512)
+    #include <immintrin.h>
+    #include <cstddef>
+    #include <cstdint>
+
+namespace {
+
+/* Folds each 128-bit lane of x forward, and adds (xors) it to data */
+CRC_TARGET_AVX512 inline __m512i crc32_fold(__m512i x, __m512i k, __m512i data) {
+    return _mm512_ternarylogic_epi64(_mm512_clmulepi64_epi128(x, k, 0x00),
+                                     _mm512_clmulepi64_epi128(x, k, 0x11), data, 0x96);
+}
+
+CRC_TARGET_AVX512 inline __m128i crc32_fold(__m128i x, __m128i k, __m128i data) {
+    return _mm_ternarylogic_epi64(_mm_clmulepi64_si128(x, k, 0x00),
+                                  _mm_clmulepi64_si128(x, k, 0x11), data, 0x96);
+}
+
+/* k in all four 128-bit lanes, and lane i of x. Not crc32_broadcast() and
+ * _mm512_extracti32x4_epi32(): GCC 12 builds those on _mm512_undefined_epi32(), and warns
+ * (-Wmaybe-uninitialized); with all lanes selected, the zero-masked forms give the same result */
+CRC_TARGET_AVX512 inline __m512i crc32_broadcast(__m128i k) {
+    return _mm512_maskz_broadcast_i32x4(0xffff, k);
+}
+
+template <int I> CRC_TARGET_AVX512 inline __m128i crc32_lane(__m512i x) {
+    return _mm512_maskz_extracti32x4_epi32(0xf, x, I);
+}
+
+template <uint32_t Poly>
+CRC_TARGET_AVX512 uint32_t crc32_hardware_avx512(const void *data, std::size_t length,
+                                                 uint32_t prev, crc32_tail_fn_t tail) {
+    auto buf = static_cast<const uint8_t *>(data);
+    if (length < 256)
+        return tail(buf, length, prev);
+
+    const auto k256 = crc32_broadcast(crc32_fold_constants<Poly, 256>());
+    const auto k64 = crc32_broadcast(crc32_fold_constants<Poly, 64>());
+
+    /* First 256 bytes, with the initial CRC added to the first 4 bytes */
+    auto x0 = _mm512_xor_si512(_mm512_loadu_si512(buf),
+                               _mm512_maskz_set1_epi32(1, static_cast<int>(prev)));
+    auto x1 = _mm512_loadu_si512(buf + 64);
+    auto x2 = _mm512_loadu_si512(buf + 128);
+    auto x3 = _mm512_loadu_si512(buf + 192);
+    buf += 256;
+    length -= 256;
+
+    /* Main loop */
+    while (length >= 256) {
+        x0 = crc32_fold(x0, k256, _mm512_loadu_si512(buf));
+        x1 = crc32_fold(x1, k256, _mm512_loadu_si512(buf + 64));
+        x2 = crc32_fold(x2, k256, _mm512_loadu_si512(buf + 128));
+        x3 = crc32_fold(x3, k256, _mm512_loadu_si512(buf + 192));
+        buf += 256;
+        length -= 256;
+    }
+
+    /* Reduce x0 ... x3 to a single 512-bit accumulator */
+    auto x = crc32_fold(x0, crc32_broadcast(crc32_fold_constants<Poly, 192>()), x3);
+    x = crc32_fold(x1, crc32_broadcast(crc32_fold_constants<Poly, 128>()), x);
+    x = crc32_fold(x2, k64, x);
+
+    for (; length >= 64; buf += 64, length -= 64)
+        x = crc32_fold(x, k64, _mm512_loadu_si512(buf));
+
+    /* Reduce the four 128-bit lanes to one */
+    auto v = crc32_fold(crc32_lane<0>(x), crc32_fold_constants<Poly, 48>(), crc32_lane<3>(x));
+    v = crc32_fold(crc32_lane<1>(x), crc32_fold_constants<Poly, 32>(), v);
+    v = crc32_fold(crc32_lane<2>(x), crc32_fold_constants<Poly, 16>(), v);
+
+    const auto k16 = crc32_fold_constants<Poly, 16>();
+    for (; length >= 16; buf += 16, length -= 16)
+        v = crc32_fold(v, k16, _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf)));
+
+    /* The CRC of the folded 16 bytes is the CRC of everything so far */
+    alignas(16) uint8_t folded[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(folded), v);
+
+    return tail(buf, length, tail(folded, 16, 0));
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "crc32c_defs.h"
+
+/* Hardware assisted CRC32, for any bit-reflected 32-bit polynomial (i.e. both CRC32-C and CRC32),
+ * using PCLMULQDQ.
+ *
+ * The input is folded 64 bytes at a time, in four 128-bit accumulators. Folding a 128-bit value
+ * forward by D bytes is two carry-less multiplications, of its low 64 bits by x^(8D+31) mod P and
+ * of its high 64 bits by x^(8D-33) mod P (the same constants the corsix kernel in
+ * crc32c_hardware_intel.h uses). Once only 16 bytes are left, their CRC is the CRC of the whole
+ * input so far, and the remaining bytes are handed to a (slower) tail function.
+ *
+ * Built with target attributes, so only call it if the CPU supports PCLMULQDQ.
+ */
+
+#if defined(HAVE_HARDWARE_CRC32_CLMUL)
+    #include <immintrin.h>
+    #include <cstddef>
+    #include <cstdint>
+
+namespace {
+
+/* x^n mod P, for a bit-reflected polynomial P, in the same bit-reflected representation */
+constexpr uint32_t crc32_xnmodp(uint64_t n, uint32_t poly) {
+    uint32_t v = 0x80000000;
+    for (; n; --n)
+        v = (v >> 1) ^ ((v & 1) ? poly : 0);
+    return v;
+}
+
+/* Calculates the CRC of the given bytes, taking and returning the raw (i.e. not flipped) CRC */
+typedef uint32_t (*crc32_tail_fn_t)(const void *data, std::size_t length, uint32_t prev);
+
+/* Constants to fold a 128-bit value forward by the given number of bytes */
+template <uint32_t Poly, std::size_t Bytes> inline __m128i crc32_fold_constants() {
+    constexpr uint32_t lo = crc32_xnmodp(8 * Bytes + 31, Poly);
+    constexpr uint32_t hi = crc32_xnmodp(8 * Bytes - 33, Poly);
+    return _mm_setr_epi32(static_cast<int>(lo), 0, static_cast<int>(hi), 0);
+}
+
+/* Folds x forward, and adds (xors) it to data */
+CRC_TARGET_CLMUL inline __m128i crc32_fold_clmul(__m128i x, __m128i k, __m128i data) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                                       _mm_clmulepi64_si128(x, k, 0x11)),
+                         data);
+}
+
+template <uint32_t Poly>
+CRC_TARGET_CLMUL uint32_t crc32_hardware_clmul(const void *data, std::size_t length, uint32_t prev,
+                                               crc32_tail_fn_t tail) {
+    auto buf = static_cast<const uint8_t *>(data);
+    if (length < 64)
+        return tail(buf, length, prev);
+
+    auto load = [](const uint8_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); };
+
+    /* First 64 bytes, with the initial CRC added to the first 4 bytes */
+    auto x0 = _mm_xor_si128(load(buf), _mm_cvtsi32_si128(static_cast<int>(prev)));
+    auto x1 = load(buf + 16);
+    auto x2 = load(buf + 32);
+    auto x3 = load(buf + 48);
+    buf += 64;
+    length -= 64;
+
+    /* Main loop */
+    const auto k64 = crc32_fold_constants<Poly, 64>();
+    while (length >= 64) {
+        x0 = crc32_fold_clmul(x0, k64, load(buf));
+        x1 = crc32_fold_clmul(x1, k64, load(buf + 16));
+        x2 = crc32_fold_clmul(x2, k64, load(buf + 32));
+        x3 = crc32_fold_clmul(x3, k64, load(buf + 48));
+        buf += 64;
+        length -= 64;
+    }
+
+    /* Reduce x0 ... x3 to just x0 */
+    const auto k16 = crc32_fold_constants<Poly, 16>();
+    auto x = crc32_fold_clmul(x0, crc32_fold_constants<Poly, 48>(), x3);
+    x = crc32_fold_clmul(x1, crc32_fold_constants<Poly, 32>(), x);
+    x = crc32_fold_clmul(x2, k16, x);
+
+    for (; length >= 16; buf += 16, length -= 16)
+        x = crc32_fold_clmul(x, k16, load(buf));
+
+    /* The CRC of the folded 16 bytes is the CRC of everything so far */
+    alignas(16) uint8_t folded[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(folded), x);
+
+    return tail(buf, length, tail(folded, 16, 0));
+}
+
+} // namespace
+
+#endif
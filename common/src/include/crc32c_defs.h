@@ -2,25 +2,89 @@
 
 #include <sg/environment.h>
 
-/* Optimized hardware assistance
+/* Hardware assistance
  *
- * Our 64-bit code requires: SSE4.2 and CLUL
+ * The hardware kernels are built whenever the compiler targets an architecture that may have the
+ * instructions, using per-function target attributes, so that they are available even if the
+ * library itself is built for a baseline CPU. crc.cpp then picks a kernel at runtime, based on
+ * what the CPU actually supports (see sg::cpu::features()).
+ *
+ * Our 64-bit code requires: SSE4.2 and CLMUL
  * Our 32-bit code required: SSE4.2
  */
-#if defined(ENV_64BIT) && defined(CPU_SUPPORTS_SSE42) && defined(CPU_SUPPORTS_CLMUL)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define CRC_IS_X86
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+    #define CRC_IS_ARM64
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    /* MSVC allows intrinsics in any function */
+    #define CRC_TARGET(gcc_target, clang_target)
+#elif defined(__clang__)
+    #define CRC_TARGET(gcc_target, clang_target) __attribute__((target(clang_target)))
+#else
+    #define CRC_TARGET(gcc_target, clang_target) __attribute__((target(gcc_target)))
+#endif
+
+#if defined(CRC_IS_X86) && defined(ENV_64BIT)
     #define HAVE_HARDWARE_CRC32C_64 1
 #endif
 
-#if defined(CPU_SUPPORTS_SSE42)
+#if defined(CRC_IS_X86)
     #define HAVE_HARDWARE_CRC32C_32 1
 #endif
 
-#if defined(CPU_SUPPORTS_ARM_CRC) && defined(CPU_SUPPORTS_ARM_AES)
+#define CRC_TARGET_SSE42 CRC_TARGET("sse4.2", "sse4.2")
+#define CRC_TARGET_SSE42_CLMUL CRC_TARGET("sse4.2,pclmul", "sse4.2,pclmul")
+
+/* Generic (i.e. any polynomial) folding with PCLMULQDQ */
+#if defined(CRC_IS_X86)
+    #define HAVE_HARDWARE_CRC32_CLMUL 1
+#endif
+
+#define CRC_TARGET_CLMUL CRC_TARGET("pclmul", "pclmul")
+
+/* CRC-64 folding, with PCLMULQDQ (and SSSE3 for byte swapping) or with PMULL */
+#if defined(CRC_IS_X86)
+    #define HAVE_HARDWARE_CRC64_CLMUL 1
+#endif
+
+#if defined(CRC_IS_ARM64)
+    #define HAVE_HARDWARE_CRC64_PMULL 1
+#endif
+
+#define CRC_TARGET_CLMUL_SSSE3 CRC_TARGET("pclmul,ssse3", "pclmul,ssse3")
+
+/* AVX-512 + VPCLMULQDQ, for large buffers. Needs GCC 8 or later */
+#if defined(CRC_IS_X86) && defined(ENV_64BIT) &&                                                   \
+    (defined(__clang__) || !defined(__GNUC__) || __GNUC__ >= 8)
+    #define HAVE_HARDWARE_CRC32_AVX512 1
+#endif
+
+#define CRC_TARGET_AVX512                                                                          \
+    CRC_TARGET("avx512f,avx512bw,avx512vl,vpclmulqdq,pclmul,sse4.2",                               \
+               "avx512f,avx512bw,avx512vl,vpclmulqdq,pclmul,sse4.2")
+
+/* On 64-bit Arm the kernels are always built, on 32-bit Arm only if the compiler already targets a
+ * CPU with the CRC instructions */
+#if defined(CRC_IS_ARM64) || (defined(CPU_SUPPORTS_ARM_CRC) && defined(CPU_SUPPORTS_ARM_AES))
     #define HAVE_HARDWARE_CRC32C_ARMV8
-#elif defined(CPU_SUPPORTS_ARM_CRC)
-    #define HAVE_HARDWARE_CRC32C_ARMV7
 #endif
 
-#if defined(CPU_SUPPORTS_ARM_CRC)
+#if defined(CRC_IS_ARM64) || defined(CPU_SUPPORTS_ARM_CRC)
+    #define HAVE_HARDWARE_CRC32C_ARMV7
     #define HAVE_HARDWARE_CRC32_ARMV7
 #endif
+
+#if defined(CRC_IS_ARM64)
+    #define CRC_TARGET_ARM_CRC CRC_TARGET("+crc", "crc")
+    #define CRC_TARGET_ARM_CRC_PMULL CRC_TARGET("+crc+crypto", "crc,aes")
+    #define CRC_TARGET_ARM_PMULL CRC_TARGET("+crypto", "aes")
+#else
+    #define CRC_TARGET_ARM_CRC
+    #define CRC_TARGET_ARM_CRC_PMULL
+    #define CRC_TARGET_ARM_PMULL
+#endif
@@ -8,9 +8,9 @@ namespace {
 
 /* Hardware-assited CRC-32c
  *
- * Basic 32-bit version
+ * Basic 32-bit version, only call it if the CPU supports SSE4.2
 */
-inline uint32_t crc32c_hardware_32bit(const void * data, uint32_t no_of_bytes, uint32_t prev){
+CRC_TARGET_SSE42 inline uint32_t crc32c_hardware_32bit(const void * data, std::size_t no_of_bytes, uint32_t prev){
     auto R = prev;
     auto M = (const uint8_t*)data;
 
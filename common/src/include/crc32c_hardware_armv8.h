@@ -77,7 +77,7 @@ do {                             \
 } while (0)
 
 
-inline uint32_t crc32c_hardware_armv8(const void * data, uint32_t no_of_bytes, uint32_t prev){
+CRC_TARGET_ARM_CRC_PMULL inline uint32_t crc32c_hardware_armv8(const void * data, std::size_t no_of_bytes, uint32_t prev){
     auto M = (const uint8_t*)data;
     auto crc=prev;
 
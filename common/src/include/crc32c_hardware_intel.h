@@ -5,6 +5,8 @@
  *   ./generate -i sse -p crc32c -a v4s3x3
  *
  * This is ~20% faster than previous algorithm used, from https://github.com/komrad36/CRC
+ *
+ * Built with target attributes, so only call it if the CPU supports SSE4.2 and PCLMULQDQ.
  */
 
 #if defined(HAVE_HARDWARE_CRC32C_64)
@@ -20,18 +22,17 @@
         #define CRC_AINLINE static __inline __attribute__((always_inline))
         #define CRC_ALIGN(n) __attribute__((aligned(n)))
     #endif
-    #define CRC_EXPORT extern
 
     #define clmul_lo(a, b) (_mm_clmulepi64_si128((a), (b), 0))
     #define clmul_hi(a, b) (_mm_clmulepi64_si128((a), (b), 17))
 
 namespace {
 
-CRC_AINLINE __m128i clmul_scalar(uint32_t a, uint32_t b) {
+CRC_AINLINE CRC_TARGET_SSE42_CLMUL __m128i clmul_scalar(uint32_t a, uint32_t b) {
   return _mm_clmulepi64_si128(_mm_cvtsi32_si128(a), _mm_cvtsi32_si128(b), 0);
 }
 
-static uint32_t xnmodp(uint64_t n) /* x^n mod P, in log(n) time */ {
+CRC_TARGET_SSE42_CLMUL static uint32_t xnmodp(uint64_t n) /* x^n mod P, in log(n) time */ {
   uint64_t stack = ~(uint64_t)1;
   uint32_t acc, low;
   for (; n > 191; n = (n >> 1) - 16) {
@@ -50,11 +51,11 @@ static uint32_t xnmodp(uint64_t n) /* x^n mod P, in log(n) time */ {
   return acc;
 }
 
-CRC_AINLINE __m128i crc_shift(uint32_t crc, size_t nbytes) {
+CRC_AINLINE CRC_TARGET_SSE42_CLMUL __m128i crc_shift(uint32_t crc, size_t nbytes) {
   return clmul_scalar(crc, xnmodp(nbytes * 8 - 33));
 }
 
-CRC_EXPORT uint32_t crc32c_impl(uint32_t crc0, const char* buf, size_t len) {
+CRC_TARGET_SSE42_CLMUL uint32_t crc32c_impl(uint32_t crc0, const char* buf, size_t len) {
   crc0 = ~crc0;
   for (; len && ((uintptr_t)buf & 7); --len) {
     crc0 = _mm_crc32_u8(crc0, *buf++);
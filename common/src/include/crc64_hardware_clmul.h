@@ -0,0 +1,222 @@
+#pragma once
+
+#include "crc32c_defs.h"
+
+/* Hardware assisted CRC-64, for any 64-bit polynomial, bit-reflected or not, using carry-less
+ * multiplication: PCLMULQDQ on x86, PMULL on 64-bit Arm.
+ *
+ * Same approach as crc32_hardware_clmul.h: the input is folded 64 bytes at a time, in four 128-bit
+ * accumulators, and once only 16 bytes are left, their CRC is the CRC of the whole input so far.
+ * Folding a 128-bit value forward by D bytes multiplies its two 64-bit halves by:
+ *
+ *   - reflected: low half by x^(8D+63) mod P, high half by x^(8D-1) mod P
+ *   - normal:    high half by x^(8D+64) mod P, low half by x^(8D) mod P, with the input byte
+ *                swapped, so that each 128-bit value is big endian
+ *
+ * Built with target attributes, so only call them if the CPU supports PCLMULQDQ and SSSE3, or
+ * PMULL, respectively.
+ */
+
+#if defined(HAVE_HARDWARE_CRC64_CLMUL) || defined(HAVE_HARDWARE_CRC64_PMULL)
+    #include <cstddef>
+    #include <cstdint>
+
+namespace {
+
+/* x^n mod P, in the bit-reflected or normal representation */
+constexpr uint64_t crc64_xnmodp(uint64_t n, uint64_t poly, bool reflected) {
+    uint64_t v = reflected ? uint64_t(1) << 63 : 1;
+    for (; n; --n) {
+        if (reflected)
+            v = (v >> 1) ^ ((v & 1) ? poly : 0);
+        else
+            v = (v << 1) ^ ((v >> 63) ? poly : 0);
+    }
+    return v;
+}
+
+/* Calculates the CRC of the given bytes, taking and returning the raw (i.e. not flipped) CRC */
+typedef uint64_t (*crc64_tail_fn_t)(const void *data, std::size_t length, uint64_t prev);
+
+/* Constants to fold a 128-bit value forward by the given number of bytes, for its low and high
+ * 64 bits */
+template <uint64_t Poly, bool Reflected, std::size_t Bytes>
+constexpr uint64_t crc64_fold_lo = crc64_xnmodp(Reflected ? 8 * Bytes + 63 : 8 * Bytes, Poly, Reflected);
+
+template <uint64_t Poly, bool Reflected, std::size_t Bytes>
+constexpr uint64_t crc64_fold_hi = crc64_xnmodp(Reflected ? 8 * Bytes - 1 : 8 * Bytes + 64, Poly, Reflected);
+
+} // namespace
+
+#endif
+
+/********************************* x86 **********************************/
+
+#if defined(HAVE_HARDWARE_CRC64_CLMUL)
+    #include <immintrin.h>
+
+namespace {
+
+template <uint64_t Poly, bool Reflected, std::size_t Bytes> inline __m128i crc64_fold_constants() {
+    return _mm_set_epi64x(static_cast<long long>(crc64_fold_hi<Poly, Reflected, Bytes>),
+                          static_cast<long long>(crc64_fold_lo<Poly, Reflected, Bytes>));
+}
+
+CRC_TARGET_CLMUL_SSSE3 inline __m128i crc64_fold_clmul(__m128i x, __m128i k, __m128i data) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                                       _mm_clmulepi64_si128(x, k, 0x11)),
+                         data);
+}
+
+/* Reverses the order of all 16 bytes */
+CRC_TARGET_CLMUL_SSSE3 inline __m128i crc64_bswap128(__m128i x) {
+    return _mm_shuffle_epi8(x, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+/* Loads 16 bytes, byte swapped for normal polynomials */
+template <bool Reflected> CRC_TARGET_CLMUL_SSSE3 inline __m128i crc64_load_clmul(const uint8_t *p) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    if constexpr (Reflected)
+        return v;
+    else
+        return crc64_bswap128(v);
+}
+
+template <uint64_t Poly, bool Reflected>
+CRC_TARGET_CLMUL_SSSE3 uint64_t crc64_hardware_clmul(const void *data, std::size_t length,
+                                                     uint64_t prev, crc64_tail_fn_t tail) {
+    auto buf = static_cast<const uint8_t *>(data);
+    if (length < 64)
+        return tail(buf, length, prev);
+
+    auto load = crc64_load_clmul<Reflected>;
+
+    /* First 64 bytes, with the initial CRC added to the first 8 bytes */
+    auto init = Reflected ? _mm_set_epi64x(0, static_cast<long long>(prev))
+                          : _mm_set_epi64x(static_cast<long long>(prev), 0);
+    auto x0 = _mm_xor_si128(load(buf), init);
+    auto x1 = load(buf + 16);
+    auto x2 = load(buf + 32);
+    auto x3 = load(buf + 48);
+    buf += 64;
+    length -= 64;
+
+    /* Main loop */
+    const auto k64 = crc64_fold_constants<Poly, Reflected, 64>();
+    while (length >= 64) {
+        x0 = crc64_fold_clmul(x0, k64, load(buf));
+        x1 = crc64_fold_clmul(x1, k64, load(buf + 16));
+        x2 = crc64_fold_clmul(x2, k64, load(buf + 32));
+        x3 = crc64_fold_clmul(x3, k64, load(buf + 48));
+        buf += 64;
+        length -= 64;
+    }
+
+    /* Reduce x0 ... x3 to just x0 */
+    const auto k16 = crc64_fold_constants<Poly, Reflected, 16>();
+    auto x = crc64_fold_clmul(x0, crc64_fold_constants<Poly, Reflected, 48>(), x3);
+    x = crc64_fold_clmul(x1, crc64_fold_constants<Poly, Reflected, 32>(), x);
+    x = crc64_fold_clmul(x2, k16, x);
+
+    for (; length >= 16; buf += 16, length -= 16)
+        x = crc64_fold_clmul(x, k16, load(buf));
+
+    /* The CRC of the folded 16 bytes is the CRC of everything so far */
+    if constexpr (!Reflected)
+        x = crc64_bswap128(x);
+
+    alignas(16) uint8_t folded[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(folded), x);
+
+    return tail(buf, length, tail(folded, 16, 0));
+}
+
+} // namespace
+
+#endif
+
+/********************************* Arm **********************************/
+
+#if defined(HAVE_HARDWARE_CRC64_PMULL)
+    #include <arm_neon.h>
+
+namespace {
+
+CRC_TARGET_ARM_PMULL inline uint64x2_t crc64_fold_pmull(uint64x2_t x, uint64_t kLo, uint64_t kHi,
+                                                        uint64x2_t data) {
+    auto lo = vreinterpretq_u64_p128(vmull_p64(vgetq_lane_u64(x, 0), kLo));
+    auto hi = vreinterpretq_u64_p128(vmull_p64(vgetq_lane_u64(x, 1), kHi));
+    return veorq_u64(veorq_u64(lo, hi), data);
+}
+
+template <uint64_t Poly, bool Reflected, std::size_t Bytes>
+CRC_TARGET_ARM_PMULL inline uint64x2_t crc64_fold_pmull(uint64x2_t x, uint64x2_t data) {
+    return crc64_fold_pmull(x, crc64_fold_lo<Poly, Reflected, Bytes>,
+                            crc64_fold_hi<Poly, Reflected, Bytes>, data);
+}
+
+/* Reverses the order of all 16 bytes */
+CRC_TARGET_ARM_PMULL inline uint64x2_t crc64_bswap128(uint64x2_t x) {
+    auto v = vrev64q_u8(vreinterpretq_u8_u64(x));
+    return vreinterpretq_u64_u8(vextq_u8(v, v, 8));
+}
+
+/* Loads 16 bytes, byte swapped for normal polynomials */
+template <bool Reflected> CRC_TARGET_ARM_PMULL inline uint64x2_t crc64_load_pmull(const uint8_t *p) {
+    auto v = vreinterpretq_u64_u8(vld1q_u8(p));
+    if constexpr (Reflected)
+        return v;
+    else
+        return crc64_bswap128(v);
+}
+
+template <uint64_t Poly, bool Reflected>
+CRC_TARGET_ARM_PMULL uint64_t crc64_hardware_pmull(const void *data, std::size_t length,
+                                                   uint64_t prev, crc64_tail_fn_t tail) {
+    auto buf = static_cast<const uint8_t *>(data);
+    if (length < 64)
+        return tail(buf, length, prev);
+
+    auto load = crc64_load_pmull<Reflected>;
+
+    /* First 64 bytes, with the initial CRC added to the first 8 bytes */
+    auto init = Reflected ? vcombine_u64(vcreate_u64(prev), vcreate_u64(0))
+                          : vcombine_u64(vcreate_u64(0), vcreate_u64(prev));
+    auto x0 = veorq_u64(load(buf), init);
+    auto x1 = load(buf + 16);
+    auto x2 = load(buf + 32);
+    auto x3 = load(buf + 48);
+    buf += 64;
+    length -= 64;
+
+    /* Main loop */
+    while (length >= 64) {
+        x0 = crc64_fold_pmull<Poly, Reflected, 64>(x0, load(buf));
+        x1 = crc64_fold_pmull<Poly, Reflected, 64>(x1, load(buf + 16));
+        x2 = crc64_fold_pmull<Poly, Reflected, 64>(x2, load(buf + 32));
+        x3 = crc64_fold_pmull<Poly, Reflected, 64>(x3, load(buf + 48));
+        buf += 64;
+        length -= 64;
+    }
+
+    /* Reduce x0 ... x3 to just x0 */
+    auto x = crc64_fold_pmull<Poly, Reflected, 48>(x0, x3);
+    x = crc64_fold_pmull<Poly, Reflected, 32>(x1, x);
+    x = crc64_fold_pmull<Poly, Reflected, 16>(x2, x);
+
+    for (; length >= 16; buf += 16, length -= 16)
+        x = crc64_fold_pmull<Poly, Reflected, 16>(x, load(buf));
+
+    /* The CRC of the folded 16 bytes is the CRC of everything so far */
+    if constexpr (!Reflected)
+        x = crc64_bswap128(x);
+
+    uint8_t folded[16];
+    vst1q_u8(folded, vreinterpretq_u8_u64(x));
+
+    return tail(buf, length, tail(folded, 16, 0));
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Tabular CRC-64, using slicing-by-8
+ *
+ * Tables are built at compile time. Table k holds the CRC of each byte value followed by k zero
+ * bytes, so 8 bytes can be processed with 8 independent lookups.
+ *
+ * Both bit-reflected (e.g. NVMe, XZ) and normal (e.g. ECMA-182) polynomials are supported. All
+ * functions take and return the raw CRC register, i.e. before any final xor. */
+
+namespace {
+
+struct crc64_tables_t {
+    uint64_t t[8][256];
+};
+
+constexpr crc64_tables_t compute_crc64_tables(uint64_t polynomial, bool reflected) {
+    crc64_tables_t tables{};
+
+    for (unsigned i = 0; i < 256; ++i) {
+        uint64_t R = reflected ? uint64_t(i) : uint64_t(i) << 56;
+        for (int j = 0; j < 8; ++j) {
+            if (reflected)
+                R = (R & 1) ? (R >> 1) ^ polynomial : R >> 1;
+            else
+                R = (R >> 63) ? (R << 1) ^ polynomial : R << 1;
+        }
+        tables.t[0][i] = R;
+    }
+
+    // churn each table's entries through 8 more zero bits, to get the next table
+    for (int k = 1; k < 8; ++k) {
+        for (unsigned i = 0; i < 256; ++i) {
+            uint64_t R = tables.t[k - 1][i];
+            tables.t[k][i] = reflected ? (R >> 8) ^ tables.t[0][R & 0xFF]
+                                       : (R << 8) ^ tables.t[0][R >> 56];
+        }
+    }
+
+    return tables;
+}
+
+template <uint64_t Polynomial, bool Reflected>
+constexpr crc64_tables_t crc64_tables = compute_crc64_tables(Polynomial, Reflected);
+
+template <uint64_t Polynomial, bool Reflected>
+uint64_t crc64_tabular(const void *data, std::size_t length, uint64_t prev) {
+    const auto &T = crc64_tables<Polynomial, Reflected>.t;
+    auto M = static_cast<const uint8_t *>(data);
+    uint64_t R = prev;
+
+    for (; length >= 8; length -= 8, M += 8) {
+        uint64_t V = 0;
+        if constexpr (Reflected) {
+            for (int i = 7; i >= 0; --i)
+                V = (V << 8) | M[i];
+            R ^= V;
+            R = T[7][R & 0xFF] ^ T[6][(R >> 8) & 0xFF] ^ T[5][(R >> 16) & 0xFF] ^
+                T[4][(R >> 24) & 0xFF] ^ T[3][(R >> 32) & 0xFF] ^ T[2][(R >> 40) & 0xFF] ^
+                T[1][(R >> 48) & 0xFF] ^ T[0][R >> 56];
+        } else {
+            for (int i = 0; i < 8; ++i)
+                V = (V << 8) | M[i];
+            R ^= V;
+            R = T[7][R >> 56] ^ T[6][(R >> 48) & 0xFF] ^ T[5][(R >> 40) & 0xFF] ^
+                T[4][(R >> 32) & 0xFF] ^ T[3][(R >> 24) & 0xFF] ^ T[2][(R >> 16) & 0xFF] ^
+                T[1][(R >> 8) & 0xFF] ^ T[0][R & 0xFF];
+        }
+    }
+
+    // Run 1-byte algorithm on any remaning bytes
+    for (; length; --length, ++M) {
+        if constexpr (Reflected)
+            R = (R >> 8) ^ T[0][(R ^ *M) & 0xFF];
+        else
+            R = (R << 8) ^ T[0][((R >> 56) ^ *M) & 0xFF];
+    }
+
+    return R;
+}
+
+} // namespace
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <sg/bytes.h>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace sg::internal {
+
+/* The frames file_writer wraps compressed data in, see sg/compressed_file_reader.h:
+ *
+ *   "SGZF" | payload length (uint32, little endian) | crc32c of the payload (uint32, little endian)
+ */
+constexpr std::array<std::byte, 4> FRAME_MAGIC{std::byte{'S'}, std::byte{'G'}, std::byte{'Z'}, std::byte{'F'}};
+constexpr size_t FRAME_HEADER_SIZE = 12;
+
+inline void write_frame_header(std::byte *dst, uint32_t length, uint32_t crc) {
+    std::memcpy(dst, FRAME_MAGIC.data(), FRAME_MAGIC.size());
+    auto l = sg::bytes::to_bytes(length, std::endian::little);
+    std::memcpy(dst + 4, l.data(), l.size());
+    auto c = sg::bytes::to_bytes(crc, std::endian::little);
+    std::memcpy(dst + 8, c.data(), c.size());
+}
+
+/* Returns false if the header doesn't start with the magic number */
+inline bool read_frame_header(const std::byte *src, uint32_t &length, uint32_t &crc) {
+    if (std::memcmp(src, FRAME_MAGIC.data(), FRAME_MAGIC.size()) != 0) return false;
+    length = sg::bytes::to_numeric<uint32_t>(src + 4, std::endian::little);
+    crc = sg::bytes::to_numeric<uint32_t>(src + 8, std::endian::little);
+    return true;
+}
+
+} // namespace sg::internal
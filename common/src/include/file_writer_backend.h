@@ -0,0 +1,57 @@
+#pragma once
+
+#include <sg/file_writer.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+namespace sg::internal {
+
+/* Where file_writer's thread writes to. Only ever used from that thread, once created.
+ *
+ * Failures are thrown as exceptions (std::runtime_error or derived), which file_writer reports
+ * through its error callback. */
+class file_writer_backend {
+  public:
+    virtual ~file_writer_backend() = default;
+
+    [[nodiscard]] virtual const char *name() const noexcept = 0;
+
+    /* Writes the buffers, in order, or queues them to be written. Returns the number of bytes known
+     * to be in the file since the previous call */
+    virtual size_t write(std::deque<file_writer::buffer_type> &buffers) = 0;
+
+    /* Writes out anything still held back, waits for it and closes the file. Returns the number of
+     * bytes written since the previous call */
+    virtual size_t close() = 0;
+
+    /* Makes everything written so far durable (fdatasync() or equivalent), waiting for anything still
+     * in flight. Returns the number of bytes written since the previous call, as write() */
+    virtual size_t sync() = 0;
+
+    /* Reserves space on disk for a file of this size, without changing its size. Best effort */
+    virtual void preallocate(size_t) {}
+
+    /* System calls are counted into the given counter, e.g. the writer's, which outlives the
+     * backend. Set before the backend is used */
+    void count_syscalls_into(std::atomic<size_t> &counter) noexcept { m_syscalls = &counter; }
+
+  protected:
+    void count_syscall() noexcept { m_syscalls->fetch_add(1, std::memory_order::relaxed); }
+
+  private:
+    std::atomic<size_t> m_own_syscalls{0};
+    std::atomic<size_t> *m_syscalls{&m_own_syscalls};
+};
+
+/* writev() on a raw file descriptor where there is one, std::fstream otherwise (Windows). Throws if
+ * the file can't be opened */
+std::unique_ptr<file_writer_backend> make_stream_backend(const file_writer::path_type &path);
+
+/* Returns nullptr if io_uring is not available, e.g. not Linux, an old kernel, or disabled by a
+ * seccomp policy */
+std::unique_ptr<file_writer_backend> make_io_uring_backend(const file_writer::path_type &path,
+                                                           const file_writer::options_t &options);
+
+} // namespace sg::internal
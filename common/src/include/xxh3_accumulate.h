@@ -0,0 +1,239 @@
+#pragma once
+
+#include "crc32c_defs.h"
+
+#include <sg/bytes.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/* XXH3 long input kernels
+ *
+ * XXH3 keeps 8 64-bit accumulators. Every 64-byte stripe of input is mixed into them with a 32x32
+ * bit multiplication per lane (accumulate), and after every block of stripes they are scrambled with
+ * the end of the secret. Everything else in the hash is scalar, so these two functions are all that
+ * differs between the implementations. They must all give bit-for-bit the same result.
+ *
+ * The SIMD kernels are built with target attributes, as the CRC kernels are, so only call them if the
+ * CPU supports the instructions (see sg::cpu::features()).
+ */
+
+namespace {
+
+constexpr std::size_t XXH3_STRIPE_LENGTH = 64;
+constexpr std::size_t XXH3_SECRET_CONSUME_RATE = 8;
+constexpr uint32_t XXH3_PRIME32_1 = 0x9E3779B1U;
+
+/* Accumulates nbStripes consecutive stripes, the secret moving forward 8 bytes per stripe */
+typedef void (*xxh3_accumulate_fn_t)(uint64_t *acc, const uint8_t *input, const uint8_t *secret,
+                                     std::size_t nbStripes);
+
+/* Scrambles the accumulators with 64 bytes of the secret */
+typedef void (*xxh3_scramble_fn_t)(uint64_t *acc, const uint8_t *secret);
+
+inline uint64_t xxh3_read64(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big)
+        v = sg::bytes::byteswap(v);
+    return v;
+}
+
+inline uint32_t xxh3_read32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big)
+        v = sg::bytes::byteswap(v);
+    return v;
+}
+
+/******************************** scalar ********************************/
+
+void xxh3_accumulate_scalar(uint64_t *acc, const uint8_t *input, const uint8_t *secret,
+                            std::size_t nbStripes) {
+    for (std::size_t n = 0; n < nbStripes; ++n) {
+        auto in = input + n * XXH3_STRIPE_LENGTH;
+        auto key = secret + n * XXH3_SECRET_CONSUME_RATE;
+        for (std::size_t i = 0; i < 8; ++i) {
+            auto data = xxh3_read64(in + 8 * i);
+            auto dataKey = data ^ xxh3_read64(key + 8 * i);
+            acc[i ^ 1] += data;
+            acc[i] += (dataKey & 0xFFFFFFFF) * (dataKey >> 32);
+        }
+    }
+}
+
+void xxh3_scramble_scalar(uint64_t *acc, const uint8_t *secret) {
+    for (std::size_t i = 0; i < 8; ++i) {
+        auto a = acc[i];
+        a ^= a >> 47;
+        a ^= xxh3_read64(secret + 8 * i);
+        acc[i] = a * XXH3_PRIME32_1;
+    }
+}
+
+} // namespace
+
+/********************************* x86 **********************************/
+
+#if defined(CRC_IS_X86)
+    #include <immintrin.h>
+
+    #define HAVE_XXH3_SSE2 1
+    #define HAVE_XXH3_AVX2 1
+
+    #if defined(HAVE_HARDWARE_CRC32_AVX512)
+        #define HAVE_XXH3_AVX512 1
+    #endif
+
+namespace {
+
+CRC_TARGET("sse2", "sse2")
+void xxh3_accumulate_sse2(uint64_t *acc, const uint8_t *input, const uint8_t *secret,
+                          std::size_t nbStripes) {
+    auto xacc = reinterpret_cast<__m128i *>(acc);
+    for (std::size_t n = 0; n < nbStripes; ++n) {
+        auto in = reinterpret_cast<const __m128i *>(input + n * XXH3_STRIPE_LENGTH);
+        auto key = reinterpret_cast<const __m128i *>(secret + n * XXH3_SECRET_CONSUME_RATE);
+        for (std::size_t i = 0; i < 4; ++i) {
+            auto data = _mm_loadu_si128(in + i);
+            auto dataKey = _mm_xor_si128(data, _mm_loadu_si128(key + i));
+            auto product = _mm_mul_epu32(dataKey, _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1)));
+            auto sum = _mm_add_epi64(xacc[i], _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+            xacc[i] = _mm_add_epi64(product, sum);
+        }
+    }
+}
+
+CRC_TARGET("sse2", "sse2") void xxh3_scramble_sse2(uint64_t *acc, const uint8_t *secret) {
+    auto xacc = reinterpret_cast<__m128i *>(acc);
+    auto key = reinterpret_cast<const __m128i *>(secret);
+    const auto prime = _mm_set1_epi32(static_cast<int>(XXH3_PRIME32_1));
+    for (std::size_t i = 0; i < 4; ++i) {
+        auto a = _mm_xor_si128(xacc[i], _mm_srli_epi64(xacc[i], 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128(key + i));
+        auto lo = _mm_mul_epu32(a, prime);
+        auto hi = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        xacc[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+    }
+}
+
+CRC_TARGET("avx2", "avx2")
+void xxh3_accumulate_avx2(uint64_t *acc, const uint8_t *input, const uint8_t *secret,
+                          std::size_t nbStripes) {
+    auto xacc = reinterpret_cast<__m256i *>(acc);
+    for (std::size_t n = 0; n < nbStripes; ++n) {
+        auto in = reinterpret_cast<const __m256i *>(input + n * XXH3_STRIPE_LENGTH);
+        auto key = reinterpret_cast<const __m256i *>(secret + n * XXH3_SECRET_CONSUME_RATE);
+        for (std::size_t i = 0; i < 2; ++i) {
+            auto data = _mm256_loadu_si256(in + i);
+            auto dataKey = _mm256_xor_si256(data, _mm256_loadu_si256(key + i));
+            auto product =
+                _mm256_mul_epu32(dataKey, _mm256_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1)));
+            auto sum = _mm256_add_epi64(xacc[i], _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+            xacc[i] = _mm256_add_epi64(product, sum);
+        }
+    }
+}
+
+CRC_TARGET("avx2", "avx2") void xxh3_scramble_avx2(uint64_t *acc, const uint8_t *secret) {
+    auto xacc = reinterpret_cast<__m256i *>(acc);
+    auto key = reinterpret_cast<const __m256i *>(secret);
+    const auto prime = _mm256_set1_epi32(static_cast<int>(XXH3_PRIME32_1));
+    for (std::size_t i = 0; i < 2; ++i) {
+        auto a = _mm256_xor_si256(xacc[i], _mm256_srli_epi64(xacc[i], 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256(key + i));
+        auto lo = _mm256_mul_epu32(a, prime);
+        auto hi = _mm256_mul_epu32(_mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        xacc[i] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+    }
+}
+
+    #if defined(HAVE_XXH3_AVX512)
+
+/* GCC 12 builds _mm512_shuffle_epi32(), _mm512_mul_epu32() and the shifts on
+ * _mm512_undefined_epi32(), a self-initialised vector, and warns about it */
+        #if defined(__GNUC__) && !defined(__clang__)
+            #pragma GCC diagnostic push
+            #pragma GCC diagnostic ignored "-Wuninitialized"
+            #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+        #endif
+
+/* Needs the accumulators 64-byte aligned */
+CRC_TARGET("avx512f", "avx512f")
+void xxh3_accumulate_avx512(uint64_t *acc, const uint8_t *input, const uint8_t *secret,
+                            std::size_t nbStripes) {
+    auto xacc = _mm512_load_si512(acc);
+    for (std::size_t n = 0; n < nbStripes; ++n) {
+        auto data = _mm512_loadu_si512(input + n * XXH3_STRIPE_LENGTH);
+        auto dataKey = _mm512_xor_si512(data, _mm512_loadu_si512(secret + n * XXH3_SECRET_CONSUME_RATE));
+        auto product = _mm512_mul_epu32(
+            dataKey, _mm512_shuffle_epi32(dataKey, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(0, 3, 0, 1))));
+        auto sum = _mm512_add_epi64(
+            xacc, _mm512_shuffle_epi32(data, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(1, 0, 3, 2))));
+        xacc = _mm512_add_epi64(product, sum);
+    }
+    _mm512_store_si512(acc, xacc);
+}
+
+CRC_TARGET("avx512f", "avx512f") void xxh3_scramble_avx512(uint64_t *acc, const uint8_t *secret) {
+    const auto prime = _mm512_set1_epi32(static_cast<int>(XXH3_PRIME32_1));
+    auto a = _mm512_load_si512(acc);
+    a = _mm512_ternarylogic_epi32(a, _mm512_srli_epi64(a, 47), _mm512_loadu_si512(secret), 0x96);
+    auto lo = _mm512_mul_epu32(a, prime);
+    auto hi = _mm512_mul_epu32(_mm512_shuffle_epi32(a, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(0, 3, 0, 1))),
+                               prime);
+    _mm512_store_si512(acc, _mm512_add_epi64(lo, _mm512_slli_epi64(hi, 32)));
+}
+
+        #if defined(__GNUC__) && !defined(__clang__)
+            #pragma GCC diagnostic pop
+        #endif
+
+    #endif
+
+} // namespace
+
+#endif
+
+/********************************* Arm **********************************/
+
+#if defined(CRC_IS_ARM64)
+    #include <arm_neon.h>
+
+    #define HAVE_XXH3_NEON 1
+
+namespace {
+
+/* NEON is part of the 64-bit Arm baseline, no target attributes needed */
+void xxh3_accumulate_neon(uint64_t *acc, const uint8_t *input, const uint8_t *secret,
+                          std::size_t nbStripes) {
+    for (std::size_t n = 0; n < nbStripes; ++n) {
+        auto in = input + n * XXH3_STRIPE_LENGTH;
+        auto key = secret + n * XXH3_SECRET_CONSUME_RATE;
+        for (std::size_t i = 0; i < 4; ++i) {
+            auto data = vreinterpretq_u64_u8(vld1q_u8(in + 16 * i));
+            auto dataKey = veorq_u64(data, vreinterpretq_u64_u8(vld1q_u8(key + 16 * i)));
+            auto a = vaddq_u64(vld1q_u64(acc + 2 * i), vextq_u64(data, data, 1));
+            a = vmlal_u32(a, vmovn_u64(dataKey), vshrn_n_u64(dataKey, 32));
+            vst1q_u64(acc + 2 * i, a);
+        }
+    }
+}
+
+void xxh3_scramble_neon(uint64_t *acc, const uint8_t *secret) {
+    const auto prime = vdup_n_u32(XXH3_PRIME32_1);
+    for (std::size_t i = 0; i < 4; ++i) {
+        auto a = vld1q_u64(acc + 2 * i);
+        a = veorq_u64(a, vshrq_n_u64(a, 47));
+        a = veorq_u64(a, vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+        auto hi = vshlq_n_u64(vmull_u32(vshrn_n_u64(a, 32), prime), 32);
+        vst1q_u64(acc + 2 * i, vmlal_u32(hi, vmovn_u64(a), prime));
+    }
+}
+
+} // namespace
+
+#endif
@@ -4,6 +4,7 @@
 #include "tcp_native.h"
 
 #include "sg/buffer.h"
+#include "sg/buffer_pool.h"
 #include "sg/callback.h"
 
 #include <boost/asio/any_io_executor.hpp>
@@ -51,6 +52,11 @@ class SG_NET_EXPORT tcp_session : public std::enable_shared_from_this<tcp_sessio
          * new message is added, so a message larger than the mark still goes through when nothing
          * is pending. */
         size_t write_high_water_mark{0}; // 0 = unlimited
+
+        /* The copies made by write(std::string_view), write(const void*, size_t) and
+         * write_and_crc32c() come from this pool, rather than malloc. Must outlive the buffers, e.g.
+         * &sg::buffer_pool::global() */
+        sg::buffer_pool *buffer_pool{nullptr};
     };
 
     struct Callbacks {
@@ -109,6 +115,10 @@ class SG_NET_EXPORT tcp_session : public std::enable_shared_from_this<tcp_sessio
     void write(std::string_view msg);
     void write(const void* data, size_t size);
 
+    /** As @c write(const void*, size_t), and returns crc32c(data, size, remainder), calculated
+     *  while copying the data (see sg::checksum::copy_and_crc32c()) rather than in a second pass */
+    uint32_t write_and_crc32c(const void* data, size_t size, uint32_t remainder = 0);
+
     /** Bytes given to @c write() that the socket has not taken yet: those still queued, plus the
      *  batch currently being written.
      *
@@ -169,6 +179,9 @@ class SG_NET_EXPORT tcp_session : public std::enable_shared_from_this<tcp_sessio
     void close();
     void close_impl();
 
+    /* for the copies made by write() */
+    sg::shared_c_buffer<std::byte> make_buffer(size_t size);
+
     /* Raw socket-option work. NOT thread-safe with respect to other socket access — callers must
      * either be running on m_strand or be in a phase where no other thread can touch m_socket
      * (e.g. start(), before the reader/writer coroutines are spawned). */
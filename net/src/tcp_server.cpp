@@ -343,9 +343,8 @@ void tcp_server::write(session_id_t id, std::string_view data) {
 }
 
 void tcp_server::write(session_id_t id, const void* data, size_t size) {
-    auto ptr = sg::make_shared_c_buffer<std::byte>(size);
-    std::memcpy(ptr.get(), data, size);
-    write(id, ptr);
+    /* copied by the session, from its options' buffer_pool if set */
+    find_session(id)->write(data, size);
 }
 
 void tcp_server::write(session_id_t id, sg::shared_c_buffer<std::byte> buffer) {
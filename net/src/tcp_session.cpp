@@ -1,5 +1,6 @@
 #include "sg/net/tcp_session.h"
 #include "sg/net/tcp_native.h"
+#include "sg/crc.h"
 #include "sg/debug.h"
 
 #include <boost/asio/as_tuple.hpp>
@@ -131,17 +132,29 @@ void tcp_session::write(sg::shared_c_buffer<std::byte> msg) {
         co_spawn(m_strand, [self = shared_from_this()] { return self->writer(); }, boost::asio::detached);
 }
 
+sg::shared_c_buffer<std::byte> tcp_session::make_buffer(size_t size) {
+    return m_options.buffer_pool ? m_options.buffer_pool->make_buffer(size)
+                                 : sg::make_shared_c_buffer<std::byte>(size);
+}
+
 void tcp_session::write(std::string_view msg) {
-    auto buff = sg::make_shared_c_buffer<std::byte>(msg.size());
+    auto buff = make_buffer(msg.size());
     std::memcpy(buff.get(), msg.data(), msg.size());
     write(std::move(buff));
 }
 void tcp_session::write(const void* data, size_t size) {
-    auto ptr = sg::make_shared_c_buffer<std::byte>(size);
+    auto ptr = make_buffer(size);
     std::memcpy(ptr.get(), data, size);
     write(std::move(ptr));
 }
 
+uint32_t tcp_session::write_and_crc32c(const void* data, size_t size, uint32_t remainder) {
+    auto ptr = make_buffer(size);
+    auto crc = sg::checksum::copy_and_crc32c(ptr.get(), data, size, remainder);
+    write(std::move(ptr));
+    return crc;
+}
+
 void tcp_session::apply_keepalive_unsafe(keepalive_t keepAliveParameters) {
     sg::net::native::set_keepalive(m_socket.native_handle(), keepAliveParameters);
     m_options.keepalive = keepAliveParameters;
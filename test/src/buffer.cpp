@@ -0,0 +1,103 @@
+#include <sg/buffer.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <cstdint>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+TEST_CASE("sg::make_shared_buffer: check the buffer is usable", "[sg::buffer]") {
+    auto length = GENERATE(size_t{0}, size_t{1}, size_t{3}, size_t{1000});
+    auto buffer = sg::make_shared_buffer<uint32_t>(length);
+    REQUIRE(buffer.size() == length);
+
+    std::iota(buffer.begin(), buffer.end(), 7u);
+    for (size_t i = 0; i < length; ++i) REQUIRE(buffer[i] == i + 7);
+
+    /* the memory goes with the control block, not to a deleter */
+    static_assert(
+        std::is_same_v<decltype(buffer), sg::shared_buffer<uint32_t, sg::deleter_none<uint32_t>>>);
+
+    /* copies share the data, which outlives the original, also once converted */
+    sg::shared_c_buffer<uint32_t> copy;
+    {
+        auto other = buffer;
+        copy = other;
+    }
+    buffer.reset();
+    REQUIRE(copy.size() == length);
+    if (length) REQUIRE(copy.back() == length + 6);
+}
+
+TEST_CASE("sg::make_shared_buffer: check the alignment", "[sg::buffer]") {
+    auto alignment = GENERATE(size_t{1}, size_t{16}, size_t{64}, size_t{4096});
+    std::vector<sg::shared_c_buffer<std::byte>> buffers;
+    for (size_t length : {size_t{1}, size_t{100}, size_t{5000}}) {
+        auto buffer = sg::make_shared_buffer<std::byte>(length, alignment);
+        REQUIRE(reinterpret_cast<uintptr_t>(buffer.get()) % alignment == 0);
+        std::fill(buffer.begin(), buffer.end(), std::byte{0xab});
+        buffers.push_back(buffer);
+    }
+    for (const auto &buffer : buffers)
+        for (auto b : buffer) REQUIRE(b == std::byte{0xab});
+}
+
+TEST_CASE("sg::make_shared_buffer: check an alignment that isn't a power of two is refused", "[sg::buffer]") {
+    REQUIRE_THROWS_AS(sg::make_shared_buffer<std::byte>(10, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(sg::make_shared_buffer<std::byte>(10, 48), std::invalid_argument);
+}
+
+TEST_CASE("sg::make_shared_buffer: check a size that overflows is refused", "[sg::buffer]") {
+    /* the second would fit, but not with the control block ahead of it */
+    auto length = GENERATE(SIZE_MAX / sizeof(uint32_t), (SIZE_MAX - 16) / sizeof(uint32_t));
+    REQUIRE_THROWS_AS(sg::make_shared_buffer<uint32_t>(length), std::bad_alloc);
+    REQUIRE_THROWS_AS(sg::make_shared_buffer<uint32_t>(length, 4096), std::bad_alloc);
+}
+
+TEST_CASE("sg::make_shared_buffer: benchmark", "[sg::buffer][.]") {
+    constexpr size_t allocate_count = 100000;
+    constexpr size_t read_count = 1000000;
+    constexpr size_t size = 200;
+    std::vector<sg::shared_c_buffer<std::byte>> buffers;
+    buffers.reserve(read_count);
+
+    BENCHMARK("make_shared_c_buffer, allocate and free, 100k") {
+        for (size_t i = 0; i < allocate_count; ++i)
+            buffers.push_back(sg::make_shared_c_buffer<std::byte>(size));
+        buffers.clear();
+    };
+
+    BENCHMARK("make_shared_buffer, allocate and free, 100k") {
+        for (size_t i = 0; i < allocate_count; ++i)
+            buffers.push_back(sg::make_shared_buffer<std::byte>(size));
+        buffers.clear();
+    };
+
+    /* copies each and touches the count and the first bytes, as a writer does, in an order that
+     * defeats the prefetcher: far more buffers than fit in the caches, so it's the cache misses that
+     * are measured */
+    std::vector<size_t> order(read_count);
+    for (size_t i = 0; i < read_count; ++i) order[i] = (i * 7919) % read_count;
+    auto access = [&] {
+        uint64_t sum{0};
+        for (auto i : order) {
+            auto copy = buffers[i];
+            sum += static_cast<uint64_t>(copy[0]) + copy.size();
+        }
+        return sum;
+    };
+
+    for (size_t i = 0; i < read_count; ++i)
+        buffers.push_back(sg::make_shared_c_buffer<std::byte>(size));
+    BENCHMARK("make_shared_c_buffer, copy and read, 1M random") { return access(); };
+    buffers.clear();
+
+    for (size_t i = 0; i < read_count; ++i)
+        buffers.push_back(sg::make_shared_buffer<std::byte>(size));
+    BENCHMARK("make_shared_buffer, copy and read, 1M random") { return access(); };
+    buffers.clear();
+}
@@ -0,0 +1,177 @@
+#include <sg/buffer_pool.h>
+#include <sg/file.h>
+#include <sg/file_writer.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("sg::buffer_pool: check buffers are reused", "[sg::buffer_pool]") {
+    sg::buffer_pool pool;
+
+    for (int i = 0; i < 100; ++i) {
+        auto buffer = pool.make_buffer(1000);
+        REQUIRE(buffer.size() == 1000);
+        std::memset(buffer.get(), i, buffer.size());
+    }
+
+    auto stats = pool.stats();
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.hits == 99);
+    REQUIRE(stats.unpooled == 0);
+    REQUIRE(stats.hit_rate() == 0.99);
+}
+
+TEST_CASE("sg::buffer_pool: check the contents are kept", "[sg::buffer_pool]") {
+    sg::buffer_pool pool;
+
+    std::vector<sg::buffer_pool::buffer_type> buffers;
+    for (size_t size : {size_t{0}, size_t{1}, size_t{63}, size_t{64}, size_t{65}, size_t{4000}, size_t{70000}}) {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i) content[i] = static_cast<char>(i * 7 + size);
+        auto buffer = pool.make_buffer(content.data(), content.size());
+        REQUIRE(buffer.size() == size);
+        REQUIRE(std::string(reinterpret_cast<const char *>(buffer.get()), buffer.size()) == content);
+        buffers.push_back(buffer);
+    }
+
+    /* copies share the block, which is only returned once the last one is gone */
+    auto copy = buffers.back();
+    buffers.clear();
+    REQUIRE(copy.get()[1] == static_cast<std::byte>(7 + 70000 % 256));
+}
+
+TEST_CASE("sg::buffer_pool: check large buffers aren't pooled", "[sg::buffer_pool]") {
+    sg::buffer_pool::options_t options;
+    options.max_size = 4000; // rounded up to 4096
+    sg::buffer_pool pool(options);
+
+    { auto buffer = pool.make_buffer(4096); }
+    { auto buffer = pool.make_buffer(4097); }
+    { auto buffer = pool.make_buffer(4096); }
+
+    auto stats = pool.stats();
+    REQUIRE(stats.unpooled == 1);
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.hits == 1);
+}
+
+TEST_CASE("sg::buffer_pool: check buffers freed by another thread come back", "[sg::buffer_pool]") {
+    sg::buffer_pool::options_t options;
+    options.thread_cache_blocks = 8;
+    sg::buffer_pool pool(options);
+
+    constexpr size_t rounds = 50;
+    constexpr size_t per_round = 32;
+    for (size_t round = 0; round < rounds; ++round) {
+        std::vector<sg::buffer_pool::buffer_type> buffers;
+        for (size_t i = 0; i < per_round; ++i) buffers.push_back(pool.make_buffer(100));
+
+        /* freed by the consumer, handed back to the producer through the shared list */
+        std::thread consumer([buffers = std::move(buffers)]() mutable { buffers.clear(); });
+        consumer.join();
+    }
+
+    auto stats = pool.stats();
+    REQUIRE(stats.hits + stats.misses == rounds * per_round);
+    REQUIRE(stats.hit_rate() > 0.9);
+}
+
+TEST_CASE("sg::buffer_pool: check counters of threads that exited are kept", "[sg::buffer_pool]") {
+    sg::buffer_pool pool;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&pool] {
+            for (int i = 0; i < 100; ++i) auto buffer = pool.make_buffer(200);
+        });
+    for (auto &thread : threads) thread.join();
+
+    auto stats = pool.stats();
+    REQUIRE(stats.hits + stats.misses == 400);
+    /* the threads' caches were handed back to the pool */
+    REQUIRE(stats.shared_cached_bytes > 0);
+
+    pool.trim();
+    REQUIRE(pool.stats().shared_cached_bytes == 0);
+}
+
+TEST_CASE("sg::buffer_pool: check buffers outlive the threads that made them", "[sg::buffer_pool]") {
+    sg::buffer_pool pool;
+
+    std::vector<sg::buffer_pool::buffer_type> buffers;
+    std::thread producer([&] {
+        for (int i = 0; i < 100; ++i) buffers.push_back(pool.make_buffer(&i, sizeof(i)));
+    });
+    producer.join();
+
+    for (int i = 0; i < 100; ++i) {
+        int value;
+        std::memcpy(&value, buffers[static_cast<size_t>(i)].get(), sizeof(value));
+        REQUIRE(value == i);
+    }
+    buffers.clear();
+}
+
+TEST_CASE("sg::buffer_pool: check file_writer copies into the pool", "[sg::buffer_pool]") {
+    std::filesystem::path path = "buffer-pool.bin";
+    sg::buffer_pool pool;
+
+    std::string expected;
+    sg::file_writer::options_t options;
+    options.buffer_pool = &pool;
+    sg::file_writer writer;
+    /* the blocks freed by the first writer thread are handed back to the pool as it exits, and
+     * reused in the second round */
+    for (int round = 0; round < 2; ++round) {
+        expected.clear(); // the file is truncated
+        writer.start(path, nullptr, nullptr, nullptr, options);
+        for (int i = 0; i < 500; ++i) {
+            auto msg = std::to_string(i) + ",";
+            expected += msg;
+            writer.write_async(std::string_view(msg));
+        }
+        writer.stop();
+    }
+
+    auto data = sg::common::file::read(path);
+    REQUIRE(std::string(reinterpret_cast<const char *>(data.get()), data.size()) == expected);
+    auto stats = pool.stats();
+    REQUIRE(stats.hits + stats.misses == 1000);
+    REQUIRE(stats.hits >= 500);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("sg::buffer_pool: benchmark", "[sg::buffer_pool][.]") {
+    constexpr size_t count = 10000;
+    constexpr size_t size = 200;
+    std::vector<sg::shared_c_buffer<std::byte>> buffers;
+    buffers.reserve(count);
+    sg::buffer_pool pool;
+
+    /* the pattern of a producer with a writer freeing a batch at a time */
+    BENCHMARK("make_shared_c_buffer") {
+        for (size_t i = 0; i < count; ++i) buffers.push_back(sg::make_shared_c_buffer<std::byte>(size));
+        buffers.clear();
+    };
+
+    BENCHMARK("buffer_pool") {
+        for (size_t i = 0; i < count; ++i) buffers.push_back(pool.make_buffer(size));
+        buffers.clear();
+    };
+
+    BENCHMARK("make_shared_c_buffer, freed on another thread") {
+        for (size_t i = 0; i < count; ++i) buffers.push_back(sg::make_shared_c_buffer<std::byte>(size));
+        std::thread([&] { buffers.clear(); }).join();
+    };
+
+    BENCHMARK("buffer_pool, freed on another thread") {
+        for (size_t i = 0; i < count; ++i) buffers.push_back(pool.make_buffer(size));
+        std::thread([&] { buffers.clear(); }).join();
+    };
+}
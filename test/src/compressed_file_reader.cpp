@@ -0,0 +1,181 @@
+#include <sg/compressed_file_reader.h>
+#include <sg/file_writer.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/* compressible, but not trivially */
+std::string make_text(size_t size, unsigned seed) {
+    static const char *words[] = {"alpha ", "bravo ", "charlie ", "delta ", "echo ", "foxtrot ", "golf "};
+    std::mt19937 gen{seed};
+    std::string text;
+    while (text.size() < size)
+        text += words[gen() % std::size(words)];
+    text.resize(size);
+    return text;
+}
+
+std::string to_string(const std::vector<std::byte> &data) {
+    return std::string(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+sg::file_writer::options_t compressed_options() {
+    sg::file_writer::options_t options;
+    options.compression = sg::compression::codec_type::zstd;
+    return options;
+}
+
+} // namespace
+
+TEST_CASE("compressed_file_reader: check it reads what file_writer compressed") {
+    if (!sg::compression::is_available(sg::compression::codec_type::zstd)) SKIP("built without zstd");
+
+    std::string path = "compressed-write";
+    auto options = compressed_options();
+
+    SECTION("on the writer thread") {}
+    SECTION("on a helper thread") { options.compress_on_helper_thread = true; }
+
+    std::string expected;
+    {
+        sg::file_writer writer;
+        writer.start(path, nullptr, nullptr, nullptr, options);
+        for (unsigned i = 0; i < 200; ++i) {
+            auto text = make_text(1000 + i * 37, i);
+            writer.write_async(text);
+            expected += text;
+        }
+        writer.stop();
+
+        /* compressed */
+        CHECK(writer.bytes_transferred() == std::filesystem::file_size(path));
+        CHECK(writer.bytes_transferred() < expected.size() / 2);
+    }
+
+    CHECK(to_string(sg::compressed_file_reader::read_all(path)) == expected);
+
+    /* and in small reads */
+    sg::compressed_file_reader reader(path);
+    std::string read;
+    char chunk[333];
+    while (auto n = reader.read(chunk, sizeof(chunk)))
+        read.append(chunk, n);
+    CHECK(read == expected);
+    CHECK(reader.frame_count() >= 1);
+    CHECK_FALSE(reader.truncated());
+}
+
+TEST_CASE("compressed_file_reader: check a truncated file is read up to the last complete frame") {
+    if (!sg::compression::is_available(sg::compression::codec_type::zstd)) SKIP("built without zstd");
+
+    std::string path = "compressed-truncated";
+    auto first = make_text(100000, 1);
+    auto second = make_text(100000, 2);
+    size_t first_end{0};
+    {
+        sg::file_writer writer;
+        writer.start(path, nullptr, nullptr, nullptr, compressed_options());
+
+        /* waiting for it to be durable makes it a batch, and so a frame, of its own */
+        REQUIRE(writer.write_async_durable(first).wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+        first_end = writer.bytes_transferred();
+        writer.write_async(second);
+        writer.stop();
+    }
+
+    /* the second frame holds all of the second batch */
+    SECTION("cut in the second frame") {
+        std::filesystem::resize_file(path, first_end + 100);
+
+        sg::compressed_file_reader reader(path);
+        std::vector<char> data(first.size() + second.size());
+        auto n = reader.read(data.data(), data.size());
+        CHECK(std::string(data.data(), n) == first);
+        CHECK(reader.truncated());
+    }
+
+    SECTION("corrupt second frame") {
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(static_cast<std::streamoff>(first_end + 100));
+            file.put('X');
+        }
+
+        sg::compressed_file_reader reader(path);
+        std::vector<char> data(first.size() + second.size());
+        auto n = reader.read(data.data(), data.size());
+        CHECK(std::string(data.data(), n) == first);
+        CHECK(reader.truncated());
+    }
+}
+
+TEST_CASE("compressed_file_reader: check each segment is a stream of its own") {
+    if (!sg::compression::is_available(sg::compression::codec_type::zstd)) SKIP("built without zstd");
+
+    std::string path = "compressed-segments.bin";
+    auto options = compressed_options();
+    options.segment_size = 10000;
+
+    std::vector<std::string> parts;
+    {
+        sg::file_writer writer;
+        writer.start(path, nullptr, nullptr, nullptr, options);
+        for (unsigned i = 0; i < 5; ++i) {
+            parts.push_back(make_text(10000, i));
+            writer.write_async(parts.back());
+        }
+        writer.stop();
+    }
+
+    for (size_t i = 0; i < parts.size(); ++i)
+        CHECK(to_string(sg::compressed_file_reader::read_all(sg::file_writer::segment_path(path, i))) == parts[i]);
+}
+
+TEST_CASE("compressed_file_reader: check it throws if the file can't be opened") {
+    CHECK_THROWS(sg::compressed_file_reader("no-such-file"));
+}
+
+TEST_CASE("compressed_file_reader: benchmark compressed writes", "[.][sg::compressed_file_reader]") {
+    if (!sg::compression::is_available(sg::compression::codec_type::zstd)) SKIP("built without zstd");
+
+    std::string path = "benchmark-compressed";
+    /* 64 MiB, in 64 KiB buffers */
+    std::vector<sg::file_writer::buffer_type> buffers;
+    for (unsigned i = 0; i < 1024; ++i) {
+        auto text = make_text(64 * 1024, i);
+        auto buff = sg::make_shared_c_buffer<std::byte>(text.size());
+        std::memcpy(buff.get(), text.data(), text.size());
+        buffers.push_back(std::move(buff));
+    }
+
+    auto run = [&](sg::file_writer::options_t options) {
+        sg::file_writer writer;
+        writer.start(path, nullptr, nullptr, nullptr, options);
+        for (const auto &buff : buffers)
+            writer.write_async(buff);
+        writer.stop();
+        return writer.bytes_transferred();
+    };
+
+    BENCHMARK("uncompressed") { return run({}); };
+
+    BENCHMARK("zstd, writer thread") { return run(compressed_options()); };
+
+    BENCHMARK("zstd, helper thread") {
+        auto options = compressed_options();
+        options.compress_on_helper_thread = true;
+        return run(options);
+    };
+
+    BENCHMARK("read") { return sg::compressed_file_reader::read_all(path).size(); };
+}
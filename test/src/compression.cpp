@@ -0,0 +1,223 @@
+#include <sg/compression.h>
+#include <sg/random.h>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace sg::compression;
+
+static std::vector<codec_type> available_codecs() {
+    std::vector<codec_type> codecs;
+    for (auto type : {codec_type::zstd, codec_type::lz4})
+        if (is_available(type))
+            codecs.push_back(type);
+    return codecs;
+}
+
+static const char* name(codec_type type) {
+    return type == codec_type::zstd ? "zstd" : "lz4";
+}
+
+static std::vector<uint32_t> text_like_data(size_t count) {
+    std::vector<uint32_t> data(count);
+    for (size_t i = 0; i < count; ++i) data[i] = static_cast<uint32_t>(i % 37) * 1000 + (i % 3);
+    return data;
+}
+
+TEST_CASE("compression: check compress(...) and decompress(...)", "[sg::compression]") {
+    auto data = text_like_data(10000);
+    auto bytes = data.size() * sizeof(uint32_t);
+
+    for (auto type : available_codecs()) {
+        INFO(name(type));
+        const auto& c = codec(type);
+        REQUIRE(c.type() == type);
+
+        auto [min, max] = c.bounds_compression_level();
+        REQUIRE(min <= c.default_compression_level());
+        REQUIRE(c.default_compression_level() <= max);
+
+        auto comp = compress(type, data.data(), bytes);
+        REQUIRE(comp.size() < bytes);
+        REQUIRE(comp.size() <= c.get_max_compressed_size(bytes));
+        REQUIRE(detect_codec(comp.get(), comp.size()) == type);
+        REQUIRE(c.get_uncompressed_size(comp.get(), comp.size()) == bytes);
+
+        auto decomp = decompress<uint32_t>(comp);
+        REQUIRE(decomp.size() == data.size());
+        REQUIRE(std::memcmp(decomp.get(), data.data(), bytes) == 0);
+
+        /* Fastest level */
+        auto fast = compress(type, data.data(), bytes, min);
+        auto decompFast = decompress(fast.get(), fast.size());
+        REQUIRE(decompFast.size() == bytes);
+        REQUIRE(std::memcmp(decompFast.get(), data.data(), bytes) == 0);
+    }
+}
+
+TEST_CASE("compression: check detect_codec(...)", "[sg::compression]") {
+    std::vector<std::byte> garbage(100, std::byte{1});
+    REQUIRE(detect_codec(garbage.data(), garbage.size()) == std::nullopt);
+    REQUIRE(detect_codec(garbage.data(), 2) == std::nullopt);
+    REQUIRE_THROWS_AS(decompress(garbage.data(), garbage.size()), std::runtime_error);
+
+    /* A skippable frame in front of the data is ignored */
+    for (auto type : available_codecs()) {
+        INFO(name(type));
+        std::string text(1000, 'a');
+        auto comp = compress(type, text.data(), text.size());
+
+        std::vector<std::byte> framed{std::byte{0x50}, std::byte{0x2A}, std::byte{0x4D},
+                                      std::byte{0x18}, std::byte{3},    std::byte{0},
+                                      std::byte{0},    std::byte{0},    std::byte{1},
+                                      std::byte{2},    std::byte{3}};
+        REQUIRE(detect_codec(framed.data(), framed.size()) == std::nullopt);
+
+        framed.insert(framed.end(), comp.get(), comp.get() + comp.size());
+        REQUIRE(detect_codec(framed.data(), framed.size()) == type);
+    }
+}
+
+TEST_CASE("compression: check concatenated frames", "[sg::compression]") {
+    auto data = text_like_data(30000);
+    auto input = reinterpret_cast<const std::byte*>(data.data());
+    auto bytes = data.size() * sizeof(uint32_t);
+
+    for (auto type : available_codecs()) {
+        INFO(name(type));
+
+        /* three frames, with a skippable frame between the last two */
+        std::vector<std::byte> comp;
+        auto append = [&comp](const sg::unique_c_buffer<std::byte>& frame) {
+            comp.insert(comp.end(), frame.get(), frame.get() + frame.size());
+        };
+        append(compress(type, input, 1000));
+        append(compress(type, input + 1000, 50000));
+        for (auto b : {0x50, 0x2A, 0x4D, 0x18, 2, 0, 0, 0, 1, 2}) comp.push_back(std::byte(b));
+        append(compress(type, input + 51000, bytes - 51000));
+
+        REQUIRE(codec(type).get_uncompressed_size(comp.data(), comp.size()) == bytes);
+        auto decomp = decompress(comp.data(), comp.size());
+        REQUIRE(decomp.size() == bytes);
+        REQUIRE(std::memcmp(decomp.get(), input, bytes) == 0);
+
+        /* a truncated last frame is refused, rather than its size being trusted */
+        REQUIRE_THROWS_AS(decompress(comp.data(), comp.size() - 1), std::runtime_error);
+    }
+}
+
+TEST_CASE("compression: check streaming", "[sg::compression]") {
+    auto data = text_like_data(100000);
+    auto input = reinterpret_cast<const std::byte*>(data.data());
+    auto bytes = data.size() * sizeof(uint32_t);
+
+    for (auto type : available_codecs()) {
+        INFO(name(type));
+
+        std::vector<std::byte> comp;
+        auto compressor = codec(type).create_compressor(
+            codec(type).default_compression_level(),
+            [&comp](const std::byte* src, size_t size) { comp.insert(comp.end(), src, src + size); });
+
+        /* Two frames, written in odd sized chunks */
+        for (size_t offset = 0; offset < bytes; offset += 1001) {
+            compressor->write(input + offset, std::min<size_t>(1001, bytes - offset));
+            if (offset == 200200)
+                compressor->finish();
+        }
+        compressor->flush();
+        compressor->finish();
+
+        REQUIRE(detect_codec(comp.data(), comp.size()) == type);
+
+        /* auto-detecting stream decompressor */
+        {
+            std::vector<std::byte> decomp;
+            auto decompressor = create_decompressor([&decomp](const std::byte* src, size_t size) {
+                decomp.insert(decomp.end(), src, src + size);
+            });
+
+            /* A byte at a time to start with, so the codec can't be detected straight away */
+            decompressor->write(comp.data(), 1);
+            decompressor->write(comp.data() + 1, 1);
+            for (size_t offset = 2; offset < comp.size(); offset += 777)
+                decompressor->write(comp.data() + offset, std::min<size_t>(777, comp.size() - offset));
+
+            REQUIRE(decomp.size() == bytes);
+            REQUIRE(std::memcmp(decomp.data(), input, bytes) == 0);
+        }
+
+        /* one-shot decompress of a single streamed frame, which doesn't record its size */
+        {
+            std::vector<std::byte> single;
+            auto c = codec(type).create_compressor(
+                0, [&single](const std::byte* src, size_t size) {
+                    single.insert(single.end(), src, src + size);
+                });
+            c->write(input, bytes);
+            c->finish();
+
+            auto decomp = decompress(single.data(), single.size());
+            REQUIRE(decomp.size() == bytes);
+            REQUIRE(std::memcmp(decomp.get(), input, bytes) == 0);
+        }
+    }
+}
+
+TEST_CASE("compression: benchmark codecs per data type", "[.][sg::compression]") {
+    constexpr size_t count = 4 * 1024 * 1024 / sizeof(uint32_t); // 4 MiB
+
+    std::vector<uint32_t> iota(count);
+    std::iota(iota.begin(), iota.end(), 0);
+
+    const std::vector<std::pair<std::string, std::vector<uint32_t>>> inputs{
+        {"random", sg::random::generate<uint32_t>(count)},
+        {"text-like", text_like_data(count)},
+        {"iota", std::move(iota)}};
+
+    for (const auto& [dataName, data] : inputs) {
+        auto bytes = data.size() * sizeof(uint32_t);
+
+        /* pick the codec that gets the data through fastest, counting a (rather slow) 100 MB/s
+         * link behind the compressor */
+        constexpr double linkMBps = 100;
+        std::optional<codec_type> best;
+        double bestSeconds{0};
+
+        for (auto type : available_codecs()) {
+            const auto& c = codec(type);
+            auto level = c.default_compression_level();
+
+            auto start = std::chrono::steady_clock::now();
+            auto comp = compress(type, data.data(), bytes, level);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            auto seconds = elapsed.count() + double(comp.size()) / (linkMBps * 1e6);
+            if (!best || seconds < bestSeconds) {
+                best = type;
+                bestSeconds = seconds;
+            }
+
+            WARN(fmt::format("{} data, {}: ratio {:.2f}, {:.0f} MB/s", dataName, name(type),
+                             double(bytes) / double(comp.size()), double(bytes) / elapsed.count() / 1e6));
+
+            BENCHMARK(fmt::format("{} data, {} compress 4 MiB", dataName, name(type))) {
+                return compress(type, data.data(), bytes, level).size();
+            };
+            BENCHMARK(fmt::format("{} data, {} decompress 4 MiB", dataName, name(type))) {
+                return decompress(comp.get(), comp.size()).size();
+            };
+        }
+
+        if (best)
+            WARN(fmt::format("{} data: best codec is {}", dataName, name(*best)));
+    }
+}
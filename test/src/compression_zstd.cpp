@@ -1,6 +1,29 @@
 #include <sg/compression_zstd.h>
 
+#include <catch2/catch_all.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <fmt/format.h>
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* small, similarly structured messages, like the status messages a server might send */
+static std::vector<std::string> status_messages(size_t count) {
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int> dist(0, 100000);
+
+    std::vector<std::string> result;
+    for (size_t i = 0; i < count; ++i)
+        result.push_back(fmt::format(
+            R"({{"type":"status","session":{},"state":"running","bytes_in":{},"bytes_out":{},)"
+            R"("latency_us":{},"errors":{},"host":"node-{}.example.com","channels":[{},{},{}]}})",
+            i, dist(gen), dist(gen), dist(gen) % 1000, dist(gen) % 3, dist(gen) % 16, dist(gen),
+            dist(gen), dist(gen)));
+    return result;
+}
 
 void test_zstd(int level, int thread_count) {
     std::vector<int> in{123,456,789};
@@ -63,3 +86,114 @@ TEST_CASE("zstd: check utility functions", "[sg::compression::zstd]") {
     REQUIRE(bounds_nthread.first==0);
     REQUIRE(bounds_nthread.second>=0);
 }
+
+TEST_CASE("zstd: check dictionary compression", "[sg::compression::zstd]") {
+    using namespace sg::compression::zstd;
+
+    auto samples = status_messages(2000);
+    auto dict = train_dictionary(samples, 16 * 1024);
+    REQUIRE(dict.id() != 0);
+    REQUIRE(dict.content().size() <= 16 * 1024);
+
+    auto msg = status_messages(2001).back();
+
+    SECTION("round trip") {
+        auto comp = compress(msg, dict, 3);
+        REQUIRE(get_dictionary_id(comp.get(), comp.size()) == dict.id());
+
+        auto decomp = decompress(comp, dict);
+        REQUIRE(std::string((char*)decomp.get(), decomp.size()) == msg);
+
+        auto decmp_ptr = sg::make_unique_c_buffer<std::byte>(msg.size());
+        decompress(comp.get(), comp.size(), decmp_ptr.get(), msg.size(), dict);
+        REQUIRE(std::string((char*)decmp_ptr.get(), decmp_ptr.size()) == msg);
+    }
+
+    SECTION("dictionary improves compression of small messages") {
+        auto plain = compress(msg, 3, 0);
+        auto withDict = compress(msg, dict, 3);
+        REQUIRE(withDict.size() < plain.size());
+    }
+
+    SECTION("dictionaries are shared by ID") {
+        auto found = find_dictionary(dict.id());
+        REQUIRE(found.has_value());
+        REQUIRE(found->content().get() == dict.content().get());
+
+        /* loading the same content again reuses the loaded dictionary */
+        auto copy = sg::make_shared_c_buffer<std::byte>(dict.content().size());
+        std::memcpy(copy.get(), dict.content().get(), copy.size());
+        auto reloaded = dictionary(copy);
+        REQUIRE(reloaded.content().get() == dict.content().get());
+    }
+
+    SECTION("can be used from multiple threads") {
+        std::vector<std::jthread> threads;
+        std::atomic<size_t> failures{0};
+        for (int i = 0; i < 4; ++i)
+            threads.emplace_back([&, i] {
+                for (int level : {1, 3, 5})
+                    for (size_t j = i; j < samples.size(); j += 50) {
+                        auto comp = compress(samples[j], dict, level);
+                        auto decomp = decompress(comp, dict);
+                        if (std::string((char*)decomp.get(), decomp.size()) != samples[j])
+                            ++failures;
+                    }
+            });
+        threads.clear();
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("wrong dictionary is detected") {
+        auto comp = compress(msg, dict, 3);
+        REQUIRE_THROWS(decompress(comp));
+    }
+}
+
+TEST_CASE("zstd: benchmark dictionary compression", "[.][sg::compression::zstd]") {
+    using namespace sg::compression::zstd;
+
+    auto samples = status_messages(2000);
+    auto messages = status_messages(12000);
+    messages.erase(messages.begin(), messages.begin() + 2000);
+    auto dict = train_dictionary(samples, 16 * 1024);
+
+    size_t rawSize{0}, plainSize{0}, dictSize{0};
+    for (const auto& msg : messages) {
+        rawSize += msg.size();
+        plainSize += compress(msg, 3, 0).size();
+        dictSize += compress(msg, dict, 3).size();
+    }
+    WARN(fmt::format("compression ratio for {} messages: {:.2f} without dictionary, {:.2f} with",
+                     messages.size(), (double)rawSize / plainSize, (double)rawSize / dictSize));
+
+    BENCHMARK("compress(...), 10k small messages, no dictionary") {
+        size_t total{0};
+        for (const auto& msg : messages) total += compress(msg, 3, 0).size();
+        return total;
+    };
+
+    BENCHMARK("compress(...), 10k small messages, with dictionary") {
+        size_t total{0};
+        for (const auto& msg : messages) total += compress(msg, dict, 3).size();
+        return total;
+    };
+
+    std::vector<sg::unique_c_buffer<std::byte>> plain, withDict;
+    for (const auto& msg : messages) {
+        plain.push_back(compress(msg, 3, 0));
+        withDict.push_back(compress(msg, dict, 3));
+    }
+
+    BENCHMARK("decompress(...), 10k small messages, no dictionary") {
+        size_t total{0};
+        for (const auto& comp : plain) total += decompress(comp).size();
+        return total;
+    };
+
+    BENCHMARK("decompress(...), 10k small messages, with dictionary") {
+        size_t total{0};
+        for (const auto& comp : withDict) total += decompress(comp, dict).size();
+        return total;
+    };
+}
@@ -0,0 +1,120 @@
+#include <sg/compression_zstd.h>
+#include <sg/compression_zstd_adaptive.h>
+#include <sg/random.h>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace sg::compression::zstd;
+
+static std::vector<uint32_t> block_data() {
+    /* half random, half repetitive, so that the level makes a difference */
+    auto data = sg::random::generate<uint32_t>(16 * 1024);
+    for (size_t i = 0; i < data.size(); i += 2) data[i] = static_cast<uint32_t>(i % 100);
+    return data;
+}
+
+TEST_CASE("zstd adaptive: check level adjustment", "[sg::compression::zstd]") {
+    auto data = block_data();
+    auto bytes = data.size() * sizeof(uint32_t);
+
+    SECTION("raises level when there is headroom") {
+        adaptive_compressor::target_t target;
+        target.throughput_mbps = 0.001;
+        target.levels = {1, 6};
+
+        adaptive_compressor compressor(target, 1);
+        for (int i = 0; i < 10; ++i) {
+            auto comp = compressor.compress(data.data(), bytes);
+
+            auto decomp = decompress(comp);
+            REQUIRE(decomp.size() == bytes);
+            REQUIRE(std::memcmp(decomp.get(), data.data(), bytes) == 0);
+        }
+
+        auto stats = compressor.stats();
+        REQUIRE(compressor.level() == 6);
+        REQUIRE(stats.level == 6);
+        REQUIRE(stats.level_ups == 5);
+        REQUIRE(stats.level_downs == 0);
+        REQUIRE(stats.last_decision == adaptive_compressor::decision_t::none);
+        REQUIRE(stats.blocks == 10);
+        REQUIRE(stats.bytes_in == 10 * bytes);
+        REQUIRE(stats.ratio() > 1);
+        REQUIRE(stats.last_mbps > 0);
+    }
+
+    SECTION("lowers level, after adding threads, when falling behind") {
+        adaptive_compressor::target_t target;
+        target.throughput_mbps = 1e9;
+        target.levels = {1, 6};
+        target.max_threads = 2;
+
+        adaptive_compressor compressor(target, 6);
+        for (int i = 0; i < 10; ++i) (void)compressor.compress(data.data(), bytes);
+
+        /* a libzstd built without multithreading can't add any */
+        auto [minThreads, maxThreads] = bounds_nothread();
+        auto expectedThreads = std::clamp(2, minThreads, maxThreads);
+
+        auto stats = compressor.stats();
+        REQUIRE(stats.threads == expectedThreads);
+        REQUIRE(stats.thread_ups == static_cast<uint64_t>(expectedThreads));
+        REQUIRE(stats.level == 1);
+        REQUIRE(stats.level_downs == 5);
+    }
+
+    SECTION("queue depth") {
+        adaptive_compressor::target_t target;
+        target.queue_depth = 4;
+        target.levels = {1, 6};
+
+        adaptive_compressor compressor(target, 3);
+
+        (void)compressor.compress(data.data(), bytes, 10);
+        REQUIRE(compressor.level() == 2);
+        REQUIRE(compressor.stats().last_decision == adaptive_compressor::decision_t::level_down);
+        REQUIRE(compressor.stats().last_queue_depth == 10);
+
+        (void)compressor.compress(data.data(), bytes, 4);
+        REQUIRE(compressor.level() == 2);
+
+        (void)compressor.compress(data.data(), bytes, 0);
+        REQUIRE(compressor.level() == 3);
+    }
+
+    SECTION("no target") {
+        adaptive_compressor compressor({}, 5);
+        for (int i = 0; i < 5; ++i) (void)compressor.compress(data.data(), bytes, 100);
+        REQUIRE(compressor.level() == 5);
+    }
+
+    SECTION("invalid levels") {
+        adaptive_compressor::target_t target;
+        target.levels = {6, 1};
+        REQUIRE_THROWS_AS(adaptive_compressor(target), std::invalid_argument);
+    }
+}
+
+TEST_CASE("zstd adaptive: benchmark level selection", "[.][sg::compression::zstd]") {
+    auto data = block_data();
+    auto bytes = data.size() * sizeof(uint32_t);
+
+    for (double target : {20.0, 100.0, 500.0}) {
+        adaptive_compressor::target_t t;
+        t.throughput_mbps = target;
+
+        adaptive_compressor compressor(t);
+        for (int i = 0; i < 200; ++i) (void)compressor.compress(data.data(), bytes);
+
+        auto stats = compressor.stats();
+        WARN(fmt::format("target {} MB/s: level {}, {:.0f} MB/s, ratio {:.2f}, {} ups / {} downs",
+                         target, stats.level, stats.average_mbps, stats.ratio(), stats.level_ups,
+                         stats.level_downs));
+    }
+}
@@ -0,0 +1,118 @@
+#include <sg/compression_zstd.h>
+#include <sg/compression_zstd_batch.h>
+#include <sg/random.h>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <vector>
+
+using namespace sg::compression::zstd;
+
+static std::vector<std::vector<uint32_t>> random_blocks(size_t count, size_t bytes) {
+    std::vector<std::vector<uint32_t>> blocks;
+    for (size_t i = 0; i < count; ++i)
+        blocks.push_back(sg::random::generate<uint32_t>(bytes / sizeof(uint32_t)));
+    return blocks;
+}
+
+static std::vector<batch_compressor::input_type>
+as_inputs(const std::vector<std::vector<uint32_t>>& blocks) {
+    std::vector<batch_compressor::input_type> inputs;
+    for (const auto& block : blocks) inputs.push_back(std::as_bytes(std::span(block)));
+    return inputs;
+}
+
+static bool equal(const sg::IBuffer<std::byte>& buff, const std::vector<uint32_t>& block) {
+    return buff.size() == block.size() * sizeof(uint32_t) &&
+           std::memcmp(buff.get(), block.data(), buff.size()) == 0;
+}
+
+TEST_CASE("zstd batch: check compress(...) and decompress(...)", "[sg::compression::zstd]") {
+    auto blocks = random_blocks(100, 4096);
+    auto inputs = as_inputs(blocks);
+
+    batch_compressor compressor(4);
+    REQUIRE(compressor.thread_count() == 4);
+
+    SECTION("returning buffers") {
+        auto comp = compressor.compress(inputs, 3);
+        REQUIRE(comp.size() == blocks.size());
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+            REQUIRE(equal(decompress(comp[i]), blocks[i]));
+
+        std::vector<batch_compressor::input_type> compInputs;
+        for (const auto& c : comp) compInputs.emplace_back(c.get(), c.size());
+
+        auto decomp = compressor.decompress(compInputs);
+        for (size_t i = 0; i < blocks.size(); ++i) REQUIRE(equal(decomp[i], blocks[i]));
+    }
+
+    SECTION("into an arena") {
+        std::vector<std::byte> arena(batch_compressor::arena_size(inputs));
+        auto comp = compressor.compress(inputs, arena, 3);
+        REQUIRE(comp.size() == blocks.size());
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+            REQUIRE(equal(decompress(comp[i].data(), comp[i].size()), blocks[i]));
+
+        std::vector<std::byte> smallArena(arena.size() - 1);
+        REQUIRE_THROWS_AS(compressor.compress(inputs, smallArena, 3), std::invalid_argument);
+    }
+
+    SECTION("empty batch") {
+        REQUIRE(compressor.compress({}, 3).empty());
+    }
+
+    SECTION("errors are rethrown") {
+        std::vector<std::byte> garbage(100, std::byte{1});
+        std::vector<batch_compressor::input_type> bad{inputs[0], garbage};
+        REQUIRE_THROWS(compressor.decompress(bad));
+    }
+}
+
+TEST_CASE("zstd batch: check async functions", "[sg::compression::zstd]") {
+    auto blocks = random_blocks(50, 4096);
+
+    std::vector<sg::shared_c_buffer<std::byte>> buffers;
+    for (const auto& block : blocks) {
+        auto buff = sg::make_shared_c_buffer<std::byte>(block.size() * sizeof(uint32_t));
+        std::memcpy(buff.get(), block.data(), buff.size());
+        buffers.push_back(std::move(buff));
+    }
+
+    batch_compressor compressor(2);
+
+    auto single = compressor.compress_async(buffers[0], 3);
+    auto comp = compressor.compress_async(buffers, 3).get();
+    REQUIRE(equal(decompress(single.get()), blocks[0]));
+
+    std::vector<sg::shared_c_buffer<std::byte>> compBuffers;
+    for (auto& c : comp) compBuffers.emplace_back(std::move(c));
+
+    auto decomp = compressor.decompress_async(compBuffers).get();
+    for (size_t i = 0; i < blocks.size(); ++i) REQUIRE(equal(decomp[i], blocks[i]));
+}
+
+TEST_CASE("zstd batch: benchmark batch_compressor", "[.][sg::compression::zstd]") {
+    auto blocks = random_blocks(256, 64 * 1024); // 16 MiB
+    auto inputs = as_inputs(blocks);
+    batch_compressor compressor;
+
+    BENCHMARK("compress(...) in a loop, 256 x 64 KiB") {
+        size_t total{0};
+        for (const auto& in : inputs) total += compress(in.data(), in.size(), 3, 0).size();
+        return total;
+    };
+
+    BENCHMARK("batch_compressor::compress(...), 256 x 64 KiB") {
+        return compressor.compress(inputs, 3).size();
+    };
+
+    std::vector<std::byte> arena(batch_compressor::arena_size(inputs));
+    BENCHMARK("batch_compressor::compress(...) into arena, 256 x 64 KiB") {
+        return compressor.compress(inputs, arena, 3).size();
+    };
+}
@@ -0,0 +1,119 @@
+#include <sg/compression_zstd.h>
+#include <sg/compression_zstd_seekable.h>
+#include <sg/file.h>
+#include <sg/random.h>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <filesystem>
+
+using namespace sg::compression::zstd;
+
+TEST_CASE("zstd seekable: check seek table", "[sg::compression::zstd]") {
+    auto in = sg::random::generate<uint32_t>(10000); // 40000 bytes
+    auto comp = compress_seekable(in.data(), in.size() * sizeof(uint32_t), 4096, 3, 0);
+
+    seek_table table(comp.get(), comp.size());
+    REQUIRE(table.frames().size() == 10);
+    REQUIRE(table.decompressed_size() == 40000);
+    REQUIRE(table.frames().back().decompressed_size == 40000 - 9 * 4096);
+    REQUIRE(table.compressed_size() < comp.size());
+
+    REQUIRE(table.frame_index(0) == 0);
+    REQUIRE(table.frame_index(4095) == 0);
+    REQUIRE(table.frame_index(4096) == 1);
+    REQUIRE(table.frame_index(39999) == 9);
+    REQUIRE_THROWS_AS(table.frame_index(40000), std::out_of_range);
+
+    SECTION("plain zstd data has no seek table") {
+        auto plain = compress(in, 3, 0);
+        REQUIRE_THROWS(seek_table(plain.get(), plain.size()));
+    }
+
+    SECTION("a frame that doesn't fit in the data is refused") {
+        /* the entries (compressed size, decompressed size) are just before the 9 byte footer */
+        auto *entry = comp.get() + comp.size() - 9 - (10 - 3) * 8;
+        uint32_t compressedSize;
+        std::memcpy(&compressedSize, entry, sizeof(compressedSize));
+        compressedSize = GENERATE_COPY(compressedSize + 1, uint32_t{0xFFFFFFFF});
+        std::memcpy(entry, &compressedSize, sizeof(compressedSize));
+
+        REQUIRE_THROWS_AS(seek_table(comp.get(), comp.size()), std::runtime_error);
+        uint32_t value;
+        REQUIRE_THROWS_AS(decompress_range(comp.get(), comp.size(), 0, &value, sizeof(value), 0),
+                          std::runtime_error);
+
+        std::filesystem::path path = "seekable-corrupt.zst";
+        sg::common::file::write(path, comp);
+        REQUIRE_THROWS_AS(seek_table(path), std::runtime_error);
+        REQUIRE_THROWS_AS(decompress_range(path, 0, &value, sizeof(value), 0), std::runtime_error);
+    }
+
+    SECTION("a frame that holds less than the table says is refused") {
+        auto *entry = comp.get() + comp.size() - 9 - (10 - 3) * 8 + 4;
+        uint32_t decompressedSize = 4096 + 1;
+        std::memcpy(entry, &decompressedSize, sizeof(decompressedSize));
+
+        /* decompressed in place, and through a temporary buffer */
+        REQUIRE_THROWS_AS(decompress_range(comp.get(), comp.size(), 3 * 4096, 4096 + 1, 0),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(decompress_range(comp.get(), comp.size(), 3 * 4096 + 1, 10, 0),
+                          std::runtime_error);
+    }
+}
+
+TEST_CASE("zstd seekable: check decompress_range(...)", "[sg::compression::zstd]") {
+    auto in = sg::random::generate<uint32_t>(100000);
+    const auto *inBytes = reinterpret_cast<const std::byte *>(in.data());
+    const size_t inSize = in.size() * sizeof(uint32_t);
+
+    int noThreads = GENERATE(0, 4);
+    auto comp = compress_seekable(in.data(), inSize, 10000, 3, noThreads);
+
+    SECTION("full decompression with standard zstd functions") {
+        auto decomp = decompress(comp);
+        REQUIRE(decomp.size() == inSize);
+        REQUIRE(std::memcmp(decomp.get(), inBytes, inSize) == 0);
+    }
+
+    SECTION("ranges within, across and at the edges of frames") {
+        for (auto [offset, count] : std::vector<std::pair<size_t, size_t>>{
+                 {0, 1}, {5, 100}, {9999, 2}, {10000, 10000}, {12345, 54321}, {0, inSize},
+                 {inSize - 1, 1}, {inSize - 20000, 20000}}) {
+            auto decomp = decompress_range(comp.get(), comp.size(), offset, count, noThreads);
+            REQUIRE(decomp.size() == count);
+            REQUIRE(std::memcmp(decomp.get(), inBytes + offset, count) == 0);
+        }
+    }
+
+    SECTION("out of range") {
+        REQUIRE_THROWS_AS(decompress_range(comp.get(), comp.size(), inSize - 10, 11, noThreads),
+                          std::out_of_range);
+    }
+
+    SECTION("from file") {
+        std::filesystem::path path = "seekable.zst";
+        sg::common::file::write(path, comp);
+
+        REQUIRE(seek_table(path).decompressed_size() == inSize);
+
+        auto decomp = decompress_range(path, 123456, 100000, noThreads);
+        REQUIRE(std::memcmp(decomp.get(), inBytes + 123456, 100000) == 0);
+    }
+}
+
+TEST_CASE("zstd seekable: benchmark decompress_range(...)", "[.][sg::compression::zstd]") {
+    auto in = sg::random::generate<uint64_t>(8 * 1024 * 1024); // 64 MiB
+    const size_t inSize = in.size() * sizeof(uint64_t);
+    auto comp = compress_seekable(in.data(), inSize, 1024 * 1024, 3, 4);
+
+    BENCHMARK("decompress(...), 64 MiB") { return decompress(comp).size(); };
+    BENCHMARK("decompress_range(...), 64 MiB, 4 threads") {
+        return decompress_range(comp.get(), comp.size(), 0, inSize, 4).size();
+    };
+    BENCHMARK("decompress_range(...), 64 KiB in middle") {
+        return decompress_range(comp.get(), comp.size(), inSize / 2, 64 * 1024, 0).size();
+    };
+}
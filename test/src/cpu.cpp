@@ -15,3 +15,13 @@ TEST_CASE("sg::common::cpu check info()") {
 TEST_CASE("sg::common::cpu check available_parallelism()") {
     REQUIRE_NOTHROW(sg::cpu::available_parallelism());
 }
+
+TEST_CASE("sg::common::cpu check features()") {
+    const auto& f = sg::cpu::features();
+    REQUIRE(&f == &sg::cpu::features());
+
+    /* sanity checks, as later extensions imply earlier ones */
+    if (f.avx512) REQUIRE(f.avx2);
+    if (f.vpclmulqdq) REQUIRE(f.pclmul);
+    if (f.sse42 || f.pclmul) REQUIRE_FALSE(f.arm_crc32);
+}
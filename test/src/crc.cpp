@@ -1,9 +1,39 @@
+#include <sg/cpu.h>
 #include <sg/crc.h>
 #include <sg/random.h>
 
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <string>
+#include <vector>
+
+/* Bit at a time reference implementation, for bit-reflected polynomials */
+static uint32_t reference_crc32(const void* data, size_t length, uint32_t remainder, uint32_t poly) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint32_t crc = ~remainder;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= bytes[i];
+        for (int j = 0; j < 8; ++j) crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+    }
+    return ~crc;
+}
+
+/* Bit at a time reference implementation of CRC-64, returning the raw register */
+static uint64_t reference_crc64(const void* data, size_t length, uint64_t crc, uint64_t poly, bool reflected) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= reflected ? uint64_t(bytes[i]) : uint64_t(bytes[i]) << 56;
+        for (int j = 0; j < 8; ++j) {
+            if (reflected)
+                crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+            else
+                crc = (crc << 1) ^ ((crc >> 63) ? poly : 0);
+        }
+    }
+    return crc;
+}
 
 TEST_CASE("checksum: check crc", "[sg::checksum]") {
     // see https://crccalc.com/
@@ -119,6 +149,41 @@ TEST_CASE("checksum: check crc", "[sg::checksum]") {
     }
 }
 
+TEST_CASE("checksum: check crc against reference", "[sg::checksum]") {
+    std::string check = "123456789";
+    REQUIRE(sg::checksum::crc32c(check.data(), check.size()) == 0xE3069283);
+    REQUIRE(sg::checksum::crc32(check.data(), check.size()) == 0xCBF43926);
+
+    /* lengths either side of the block sizes of the hardware kernels (16, 64, 136/144 and 256
+     * bytes), at different alignments */
+    auto dat = sg::random::generate<uint8_t>(70000);
+    std::vector<size_t> lengths{0, 1, 2, 3, 7, 8, 15, 16, 17, 63, 64, 65, 143, 144, 145, 255, 256, 257,
+                                300, 511, 512, 513, 1023, 1024, 1025, 4095, 4096, 4097, 65536};
+
+    for (auto length : lengths) {
+        for (size_t offset : {0, 1, 5, 8}) {
+            INFO("length " << length << ", offset " << offset);
+            auto ptr = dat.data() + offset;
+
+            REQUIRE(sg::checksum::crc32c(ptr, length, 0x12345678) ==
+                    reference_crc32(ptr, length, 0x12345678, 0x82F63B78));
+            REQUIRE(sg::checksum::crc32(ptr, length, 0x12345678) ==
+                    reference_crc32(ptr, length, 0x12345678, 0xEDB88320));
+        }
+    }
+
+    /* incremental, with the split falling inside a block */
+    auto whole32c = sg::checksum::crc32c(dat.data(), 5000);
+    auto whole32 = sg::checksum::crc32(dat.data(), 5000);
+    for (size_t split : {1, 100, 256, 1000, 4999}) {
+        auto part32c = sg::checksum::crc32c(dat.data(), split);
+        REQUIRE(sg::checksum::crc32c(dat.data() + split, 5000 - split, part32c) == whole32c);
+
+        auto part32 = sg::checksum::crc32(dat.data(), split);
+        REQUIRE(sg::checksum::crc32(dat.data() + split, 5000 - split, part32) == whole32);
+    }
+}
+
 TEST_CASE("checksum: check crc performance", "[.][sg::checksum]" ){
     BENCHMARK_ADVANCED("crc32c(...), 1 MB input")(Catch::Benchmark::Chronometer meter) {
         auto dat = sg::random::generate<uint8_t>(1000*1000);
@@ -127,3 +192,225 @@ TEST_CASE("checksum: check crc performance", "[.][sg::checksum]" ){
         });
     };
 }
+
+TEST_CASE("checksum: check crc throughput by size", "[.][sg::checksum]") {
+    WARN("crc32c: " << sg::checksum::crc32c_implementation()
+                    << ", crc32: " << sg::checksum::crc32_implementation());
+
+    auto dat = sg::random::generate<uint8_t>(16 * 1024 * 1024);
+
+    for (size_t size = 64; size <= dat.size(); size *= 4) {
+        BENCHMARK("crc32c(...), " + std::to_string(size) + " bytes") {
+            return sg::checksum::crc32c(dat.data(), size);
+        };
+        BENCHMARK("crc32(...), " + std::to_string(size) + " bytes") {
+            return sg::checksum::crc32(dat.data(), size);
+        };
+    }
+}
+
+TEST_CASE("checksum: check runtime selected implementation", "[sg::checksum]") {
+    const auto& cpu = sg::cpu::features();
+    std::string name = sg::checksum::crc32c_implementation();
+
+    REQUIRE(sg::checksum::can_do_crc32c_hardware() == (name != "tabular"));
+    if (cpu.avx512 && cpu.vpclmulqdq && cpu.sse42 && cpu.pclmul && sizeof(void*) == 8)
+        REQUIRE(name == "avx512+vpclmulqdq");
+    else if (cpu.sse42 && cpu.pclmul && sizeof(void*) == 8)
+        REQUIRE(name == "sse4.2+pclmul");
+    if (!cpu.sse42 && !cpu.arm_crc32)
+        REQUIRE(name == "tabular");
+
+    std::string name32 = sg::checksum::crc32_implementation();
+    if (cpu.pclmul && !(cpu.avx512 && cpu.vpclmulqdq))
+        REQUIRE(name32 == "pclmul");
+    if (!cpu.pclmul && !cpu.arm_crc32)
+        REQUIRE(name32 == "tabular");
+}
+
+TEST_CASE("checksum: check crc combine and multiple buffers", "[sg::checksum]") {
+    auto dat = sg::random::generate<uint8_t>(3 * 1024 * 1024 + 123);
+    auto bytes = std::as_bytes(std::span(dat));
+
+    auto whole32c = sg::checksum::crc32c(dat.data(), dat.size());
+    auto whole32 = sg::checksum::crc32(dat.data(), dat.size());
+
+    SECTION("combine") {
+        for (size_t split : {0, 1, 1000, 65536, 3 * 1024 * 1024 + 123}) {
+            auto lengthB = dat.size() - split;
+
+            auto a32c = sg::checksum::crc32c(dat.data(), split);
+            auto b32c = sg::checksum::crc32c(dat.data() + split, lengthB);
+            REQUIRE(sg::checksum::crc32c_combine(a32c, b32c, lengthB) == whole32c);
+
+            auto a32 = sg::checksum::crc32(dat.data(), split);
+            auto b32 = sg::checksum::crc32(dat.data() + split, lengthB);
+            REQUIRE(sg::checksum::crc32_combine(a32, b32, lengthB) == whole32);
+        }
+    }
+
+    SECTION("buffer list") {
+        std::vector<std::span<const std::byte>> list{bytes.first(10), bytes.subspan(10, 0),
+                                                     bytes.subspan(10, 2 * 1024 * 1024),
+                                                     bytes.subspan(10 + 2 * 1024 * 1024)};
+
+        REQUIRE(sg::checksum::crc32c(list) == whole32c);
+        REQUIRE(sg::checksum::crc32(list) == whole32);
+
+        for (size_t noThreads : {1, 2, 3, 7}) {
+            REQUIRE(sg::checksum::crc32c_parallel(list, 0, noThreads) == whole32c);
+            REQUIRE(sg::checksum::crc32_parallel(list, 0, noThreads) == whole32);
+        }
+    }
+
+    SECTION("parallel") {
+        for (size_t noThreads : {0, 1, 2, 3, 4}) {
+            REQUIRE(sg::checksum::crc32c_parallel(dat.data(), dat.size(), 0, noThreads) == whole32c);
+            REQUIRE(sg::checksum::crc32_parallel(dat.data(), dat.size(), 0, noThreads) == whole32);
+        }
+
+        /* with a remainder */
+        auto part = sg::checksum::crc32c(dat.data(), 100);
+        REQUIRE(sg::checksum::crc32c_parallel(dat.data() + 100, dat.size() - 100, part, 3) == whole32c);
+    }
+}
+
+TEST_CASE("checksum: benchmark parallel crc", "[.][sg::checksum]") {
+    auto dat = sg::random::generate<uint8_t>(256 * 1024 * 1024);
+
+    BENCHMARK("crc32c(...), 256 MiB") { return sg::checksum::crc32c(dat.data(), dat.size()); };
+    BENCHMARK("crc32c_parallel(...), 256 MiB") {
+        return sg::checksum::crc32c_parallel(dat.data(), dat.size());
+    };
+}
+
+TEST_CASE("checksum: check crc16", "[sg::checksum]") {
+    std::string check = "123456789";
+    REQUIRE(sg::checksum::crc16(check.data(), check.size()) == 0xBB3D);
+    REQUIRE(sg::checksum::crc16_xmodem(check.data(), check.size()) == 0x31C3);
+    REQUIRE(sg::checksum::crc16_modbus(check.data(), check.size()) == 0x4B37);
+
+    /* A MODBUS RTU frame, "read holding registers", with its CRC appended (low byte first) */
+    std::vector<uint8_t> frame{0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD};
+    REQUIRE(sg::checksum::crc16_modbus(frame.data(), 6) == 0xCDC5);
+    REQUIRE(sg::checksum::crc16_modbus(frame.data(), frame.size()) == 0);
+
+    /* Incremental, across every split of a buffer longer than a slice */
+    auto dat = sg::random::generate<uint8_t>(100);
+    auto arc = sg::checksum::crc16(dat.data(), dat.size());
+    auto xmodem = sg::checksum::crc16_xmodem(dat.data(), dat.size());
+    auto modbus = sg::checksum::crc16_modbus(dat.data(), dat.size());
+
+    for (size_t split = 0; split <= dat.size(); ++split) {
+        auto rest = dat.size() - split;
+        REQUIRE(sg::checksum::crc16(dat.data() + split, rest,
+                                    sg::checksum::crc16(dat.data(), split)) == arc);
+        REQUIRE(sg::checksum::crc16_xmodem(dat.data() + split, rest,
+                                           sg::checksum::crc16_xmodem(dat.data(), split)) == xmodem);
+        REQUIRE(sg::checksum::crc16_modbus(dat.data() + split, rest,
+                                           sg::checksum::crc16_modbus(dat.data(), split)) == modbus);
+    }
+}
+
+TEST_CASE("checksum: benchmark crc16", "[.][sg::checksum]") {
+    auto frame = sg::random::generate<uint8_t>(64);
+    auto dat = sg::random::generate<uint8_t>(1000 * 1000);
+
+    BENCHMARK("crc16_modbus(...), 64 byte frame") {
+        return sg::checksum::crc16_modbus(frame.data(), frame.size());
+    };
+    BENCHMARK("crc16(...), 1 MB input") { return sg::checksum::crc16(dat.data(), dat.size()); };
+    BENCHMARK("crc16_xmodem(...), 1 MB input") {
+        return sg::checksum::crc16_xmodem(dat.data(), dat.size());
+    };
+}
+
+TEST_CASE("checksum: check crc64", "[sg::checksum]") {
+    std::string check = "123456789";
+    REQUIRE(sg::checksum::crc64_ecma182(check.data(), check.size()) == 0x6C40DF5F0B497347ULL);
+    REQUIRE(sg::checksum::crc64_nvme(check.data(), check.size()) == 0xAE8B14860A799888ULL);
+
+    std::string name = sg::checksum::crc64_implementation();
+    const auto &cpu = sg::cpu::features();
+    if (cpu.pclmul && cpu.sse42)
+        REQUIRE(name == "pclmul");
+    else if (cpu.arm_pmull)
+        REQUIRE(name == "pmull");
+    else
+        REQUIRE(name == "tabular");
+
+    /* lengths either side of the block sizes of the folding kernels (16 and 64 bytes), at different
+     * alignments */
+    auto dat = sg::random::generate<uint8_t>(70000);
+    std::vector<size_t> lengths{0, 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 79, 80, 81, 127, 128, 129,
+                                255, 256, 257, 1023, 1024, 1025, 4097, 65536};
+
+    for (auto length : lengths) {
+        for (size_t offset : {0, 1, 5, 8}) {
+            INFO("length " << length << ", offset " << offset);
+            auto ptr = dat.data() + offset;
+
+            REQUIRE(sg::checksum::crc64_ecma182(ptr, length, 0x0123456789ABCDEFULL) ==
+                    reference_crc64(ptr, length, 0x0123456789ABCDEFULL, 0x42F0E1EBA9EA3693ULL, false));
+            REQUIRE(sg::checksum::crc64_nvme(ptr, length, 0x0123456789ABCDEFULL) ==
+                    ~reference_crc64(ptr, length, ~0x0123456789ABCDEFULL, 0x9A6C9329AC4BC9B5ULL, true));
+        }
+    }
+
+    /* incremental, with the split falling inside a block */
+    auto ecma = sg::checksum::crc64_ecma182(dat.data(), 5000);
+    auto nvme = sg::checksum::crc64_nvme(dat.data(), 5000);
+    for (size_t split : {1, 100, 256, 1000, 4999}) {
+        REQUIRE(sg::checksum::crc64_ecma182(dat.data() + split, 5000 - split,
+                                            sg::checksum::crc64_ecma182(dat.data(), split)) == ecma);
+        REQUIRE(sg::checksum::crc64_nvme(dat.data() + split, 5000 - split,
+                                         sg::checksum::crc64_nvme(dat.data(), split)) == nvme);
+    }
+}
+
+TEST_CASE("checksum: benchmark crc64", "[.][sg::checksum]") {
+    WARN("crc64: " << sg::checksum::crc64_implementation());
+    auto dat = sg::random::generate<uint8_t>(16 * 1024 * 1024);
+
+    BENCHMARK("crc64_ecma182(...), 16 MiB") {
+        return sg::checksum::crc64_ecma182(dat.data(), dat.size());
+    };
+    BENCHMARK("crc64_nvme(...), 16 MiB") {
+        return sg::checksum::crc64_nvme(dat.data(), dat.size());
+    };
+    BENCHMARK("crc32c(...), 16 MiB") { return sg::checksum::crc32c(dat.data(), dat.size()); };
+}
+
+TEST_CASE("checksum: check copy_and_crc32c", "[sg::checksum]") {
+    /* either side of the chunk size, and large enough for the non-temporal copy */
+    auto src = sg::random::generate<uint8_t>(5 * 1024 * 1024);
+    std::vector<uint8_t> dst(src.size() + 16);
+
+    for (size_t length : {0, 1, 15, 100, 8191, 8192, 8193, 100000, 4 * 1024 * 1024 + 3}) {
+        for (size_t offset : {0, 3}) {
+            INFO("length " << length << ", offset " << offset);
+            std::fill(dst.begin(), dst.end(), uint8_t(0));
+
+            auto crc = sg::checksum::copy_and_crc32c(dst.data() + offset, src.data() + 1, length, 0x1234);
+            REQUIRE(crc == sg::checksum::crc32c(src.data() + 1, length, 0x1234));
+            REQUIRE(std::equal(src.begin() + 1, src.begin() + 1 + length, dst.begin() + offset));
+            REQUIRE(dst[offset + length] == 0);
+        }
+    }
+}
+
+TEST_CASE("checksum: benchmark copy_and_crc32c", "[.][sg::checksum]") {
+    for (size_t size : {4 * 1024, 256 * 1024, 16 * 1024 * 1024}) {
+        auto src = sg::random::generate<uint8_t>(size);
+        std::vector<uint8_t> dst(size);
+        auto label = std::to_string(size / 1024) + " KiB";
+
+        BENCHMARK("memcpy(...) then crc32c(...), " + label) {
+            std::memcpy(dst.data(), src.data(), size);
+            return sg::checksum::crc32c(dst.data(), size);
+        };
+        BENCHMARK("copy_and_crc32c(...), " + label) {
+            return sg::checksum::copy_and_crc32c(dst.data(), src.data(), size);
+        };
+    }
+}
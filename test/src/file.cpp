@@ -1,7 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
 
+#include <sg/enumeration.h>
 #include <sg/file.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -57,3 +60,94 @@ TEST_CASE("sg::file void write(...)", "[sg::file]") {
                                                content.size(), std::ios::in));
     }
 }
+
+TEST_CASE("sg::file map(...)", "[sg::file]") {
+    std::filesystem::path path = "test-map.bin";
+    std::string content(3 * 4096 + 17, '\0');
+    for (size_t i = 0; i < content.size(); ++i)
+        content[i] = static_cast<char>(i * 31);
+    sg::common::file::write(path, (const std::byte*)content.data(), content.size());
+
+    SECTION("... maps the contents") {
+        using sg::enumeration::operator|;
+        auto advice = GENERATE(sg::common::file::map_advice::normal,
+                               sg::common::file::map_advice::sequential | sg::common::file::map_advice::will_need,
+                               sg::common::file::map_advice::random);
+
+        auto mapped = sg::common::file::map(path, advice);
+        REQUIRE(mapped.size() == content.size());
+        REQUIRE(std::string((const char*)mapped.get(), mapped.size()) == content);
+
+        /* moved from is empty, and doesn't unmap */
+        auto moved = std::move(mapped);
+        REQUIRE(mapped.empty());
+        REQUIRE(std::string((const char*)moved.get(), moved.size()) == content);
+
+        moved.reset();
+        REQUIRE(moved.get() == nullptr);
+    }
+
+    SECTION("... usable as an IBuffer") {
+        auto mapped = sg::common::file::map(path);
+        const sg::IBuffer<const std::byte>& buffer = mapped;
+        REQUIRE(std::equal(buffer.begin(), buffer.end(), (const std::byte*)content.data()));
+    }
+
+    SECTION("... empty file gives an empty mapping") {
+        std::ofstream(path, std::ios::trunc).close();
+        REQUIRE(sg::common::file::map(path).empty());
+    }
+
+    SECTION("... check missing file throws exception") {
+        REQUIRE_THROWS(sg::common::file::map("no-such-file"));
+    }
+}
+
+TEST_CASE("sg::file read_parallel(...)", "[sg::file]") {
+    std::filesystem::path path = "test-read-parallel.bin";
+    /* large enough to be split between threads */
+    std::string content(20 * 1024 * 1024 + 5, '\0');
+    for (size_t i = 0; i < content.size(); ++i)
+        content[i] = static_cast<char>(i * 31 + i / 4096);
+    sg::common::file::write(path, (const std::byte*)content.data(), content.size());
+
+    auto threads = GENERATE(size_t{0}, size_t{1}, size_t{3}, size_t{64});
+    auto readback = sg::common::file::read_parallel(path, threads);
+    REQUIRE(readback.size() == content.size());
+    REQUIRE(std::string((const char*)readback.get(), readback.size()) == content);
+}
+
+TEST_CASE("sg::file benchmark whole file reads", "[.][sg::file]") {
+    std::filesystem::path path = "benchmark-read.bin";
+    std::string content(256 * 1024 * 1024, 'x');
+    sg::common::file::write(path, (const std::byte*)content.data(), content.size());
+    content = {};
+
+    /* touching one byte per page is what reading through a mapping costs */
+    const auto touch = [](const std::byte* data, size_t size) {
+        size_t sum{0};
+        for (size_t i = 0; i < size; i += 4096)
+            sum += static_cast<size_t>(data[i]);
+        return sum;
+    };
+
+    BENCHMARK("read") {
+        auto data = sg::common::file::read(path);
+        return touch(data.get(), data.size());
+    };
+
+    BENCHMARK("read_parallel") {
+        auto data = sg::common::file::read_parallel(path);
+        return touch(data.get(), data.size());
+    };
+
+    BENCHMARK("map") {
+        auto data = sg::common::file::map(path);
+        return touch(data.get(), data.size());
+    };
+
+    BENCHMARK("map, sequential") {
+        auto data = sg::common::file::map(path, sg::common::file::map_advice::sequential);
+        return touch(data.get(), data.size());
+    };
+}
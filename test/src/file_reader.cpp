@@ -0,0 +1,143 @@
+#include <sg/file_reader.h>
+#include <sg/file.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string make_content(size_t size) {
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+        content[i] = static_cast<char>(i * 31 + i / 4096);
+    return content;
+}
+
+void write_file(const std::filesystem::path &path, const std::string &content) {
+    sg::common::file::write(path, reinterpret_cast<const std::byte *>(content.data()), content.size());
+}
+
+std::string to_string(const sg::file_reader::buffer_type &buff) {
+    return std::string(reinterpret_cast<const char *>(buff.get()), buff.size());
+}
+
+} // namespace
+
+TEST_CASE("sg::file_reader: check it reads the file in chunks", "[sg::file_reader]") {
+    std::filesystem::path path = "file-reader.bin";
+    auto content = make_content(300001);
+    write_file(path, content);
+
+    sg::file_reader::options_t options;
+    options.chunk_size = GENERATE(size_t{7}, size_t{4096}, size_t{100000}, size_t{2000000});
+    options.read_ahead = GENERATE(size_t{0}, size_t{1}, size_t{4});
+    options.drop_behind = GENERATE(false, true);
+
+    sg::file_reader reader(path, options);
+    REQUIRE(reader.size() == content.size());
+
+    std::string read;
+    size_t chunks{0};
+    while (true) {
+        auto chunk = reader.next();
+        if (chunk.size() == 0) break;
+        /* only the last chunk is short */
+        if (read.size() + chunk.size() < content.size()) REQUIRE(chunk.size() == options.chunk_size);
+        read += to_string(chunk);
+        ++chunks;
+        REQUIRE(reader.position() == read.size());
+    }
+    REQUIRE(read == content);
+    REQUIRE(chunks == (content.size() + options.chunk_size - 1) / options.chunk_size);
+
+    /* and stays at the end */
+    REQUIRE(reader.next().size() == 0);
+}
+
+TEST_CASE("sg::file_reader: check seek() discards what was read ahead", "[sg::file_reader]") {
+    std::filesystem::path path = "file-reader-seek.bin";
+    auto content = make_content(100000);
+    write_file(path, content);
+
+    sg::file_reader::options_t options;
+    options.chunk_size = 1000;
+    sg::file_reader reader(path, options);
+
+    REQUIRE(to_string(reader.next()) == content.substr(0, 1000));
+    /* let it read ahead */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    reader.seek(50500);
+    REQUIRE(reader.position() == 50500);
+    REQUIRE(to_string(reader.next()) == content.substr(50500, 1000));
+
+    reader.seek(0);
+    REQUIRE(to_string(reader.next()) == content.substr(0, 1000));
+
+    reader.seek(content.size() - 10);
+    REQUIRE(to_string(reader.next()) == content.substr(content.size() - 10));
+    REQUIRE(reader.next().size() == 0);
+
+    /* past the end is the end */
+    reader.seek(content.size() + 10);
+    REQUIRE(reader.next().size() == 0);
+}
+
+TEST_CASE("sg::file_reader: check chunks outlive the reader", "[sg::file_reader]") {
+    std::filesystem::path path = "file-reader-outlive.bin";
+    auto content = make_content(10000);
+    write_file(path, content);
+
+    sg::file_reader::buffer_type chunk;
+    {
+        sg::file_reader reader(path);
+        chunk = reader.next();
+    }
+    REQUIRE(to_string(chunk) == content);
+}
+
+TEST_CASE("sg::file_reader: check empty and missing files", "[sg::file_reader]") {
+    std::filesystem::path path = "file-reader-empty.bin";
+    write_file(path, "");
+
+    sg::file_reader reader(path);
+    REQUIRE(reader.size() == 0);
+    REQUIRE(reader.next().size() == 0);
+
+    REQUIRE_THROWS(sg::file_reader("no-such-file"));
+}
+
+TEST_CASE("sg::file_reader: benchmark overlapping reading and processing", "[.][sg::file_reader]") {
+    std::filesystem::path path = "benchmark-file-reader.bin";
+    constexpr size_t size = 256 * 1024 * 1024;
+    write_file(path, std::string(size, 'x'));
+
+    /* about as long per chunk as reading it */
+    const auto process = [](const std::byte *data, size_t length) {
+        uint64_t sum{0};
+        for (size_t i = 0; i < length; ++i)
+            sum = sum * 31 + static_cast<uint64_t>(data[i]);
+        return sum;
+    };
+
+    BENCHMARK("read, then process") {
+        auto data = sg::common::file::read(path);
+        return process(data.get(), data.size());
+    };
+
+    BENCHMARK("file_reader, 1 MiB chunks") {
+        sg::file_reader reader(path);
+        uint64_t sum{0};
+        while (true) {
+            auto chunk = reader.next();
+            if (chunk.size() == 0) break;
+            sum += process(chunk.get(), chunk.size());
+        }
+        return sum;
+    };
+}
@@ -5,12 +5,20 @@
 #endif
 
 #include <cstring>
+#include <sg/crc.h>
 #include <sg/file_writer.h>
+#include <sg/jthread.h>
+
+#include <fmt/core.h>
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_all.hpp>
 
+#include <atomic>
 #include <fstream>
+#include <future>
+#include <mutex>
+#include <thread>
 #include <numeric>
 #include <random>
 #include <string>
@@ -93,6 +101,12 @@ TEST_CASE("file_writer: check write_async(...) variations work") {
             writer.write_async(text);
         }
 
+        SECTION("pass pointer, with crc32c") {
+            auto [result, crc] = writer.write_async_and_crc32c(text.data(), text.size());
+            CHECK(result == sg::file_writer::write_result_t::queued);
+            CHECK(crc == sg::checksum::crc32c(text.data(), text.size()));
+        }
+
         writer.stop();
     }
 
@@ -139,6 +153,457 @@ TEST_CASE("file_writer: test large sequential writes") {
     CHECK(std::filesystem::file_size(path)== 1024*2048);
 }
 
+TEST_CASE("file_writer: check small and large buffers are written in order") {
+    std::string path = "mixed-write";
+
+    /* runs of small buffers, which are coalesced, between large ones, which are not, and enough
+     * of them to need several writev() calls */
+    std::string expected;
+    std::vector<std::string> parts;
+    std::mt19937 gen{42};
+    for (size_t i = 0; i < 5000; ++i) {
+        auto size = (i % 100 == 99) ? std::uniform_int_distribution<size_t>(4096, 100000)(gen)
+                                    : std::uniform_int_distribution<size_t>(1, 300)(gen);
+        std::string part(size, '\0');
+        for (auto &c : part)
+            c = static_cast<char>(gen());
+        expected += part;
+        parts.push_back(std::move(part));
+    }
+
+    sg::file_writer writer;
+    writer.start(path, nullptr, nullptr, nullptr);
+    CHECK(writer.syscall_count() == 0);
+    for (const auto &part : parts)
+        writer.write_async(part);
+    writer.stop();
+
+    CHECK(writer.bytes_transferred() == expected.size());
+    CHECK(read_file(path) == expected);
+    /* fewer than one per buffer */
+    CHECK(writer.syscall_count() > 0);
+    CHECK(writer.syscall_count() < parts.size());
+}
+
+TEST_CASE("file_writer: check start() throws if the file can't be opened") {
+    sg::file_writer writer;
+    CHECK_THROWS(writer.start("no-such-directory/test.txt", nullptr, nullptr, nullptr));
+    CHECK_FALSE(writer.is_running());
+}
+
+TEST_CASE("file_writer: check the overflow policies") {
+    std::string path = "overflow-write";
+    using result_t = sg::file_writer::write_result_t;
+
+    sg::file_writer::options_t options;
+    options.high_water_mark = 10;
+
+    sg::file_writer writer;
+
+    /* once stopped, nothing is taken from the queue, so pending_bytes() only goes up */
+    auto fill = [&](sg::file_writer::overflow_t overflow) {
+        options.overflow = overflow;
+        writer.start(path, nullptr, nullptr, nullptr, options);
+        writer.stop();
+        CHECK(writer.pending_bytes() == 0);
+
+        CHECK(writer.write_async("12345678") == result_t::queued);
+        CHECK(writer.write_async("12345678") == result_t::queued);
+        CHECK(writer.pending_bytes() == 16);
+        CHECK(writer.queue_depth() == 2);
+        CHECK(writer.try_write_async(sg::make_shared_c_buffer<std::byte>(1)) == result_t::full);
+    };
+
+    std::string expected = "1234567812345678";
+
+    SECTION("fail") {
+        fill(sg::file_writer::overflow_t::fail);
+        CHECK(writer.write_async("1") == result_t::full);
+        CHECK(writer.dropped_count() == 0);
+    }
+
+    SECTION("drop newest") {
+        fill(sg::file_writer::overflow_t::drop_newest);
+        CHECK(writer.write_async("1") == result_t::dropped);
+        CHECK(writer.dropped_count() == 1);
+    }
+
+    SECTION("block, which doesn't while the writer is stopped") {
+        fill(sg::file_writer::overflow_t::block);
+        CHECK(writer.write_async("1") == result_t::queued);
+        CHECK(writer.pending_bytes() == 17);
+        expected += "1";
+    }
+
+    /* what was queued is written once started again */
+    writer.start(path, nullptr, nullptr, nullptr);
+    writer.stop();
+    CHECK(writer.pending_bytes() == 0);
+    CHECK(writer.queue_depth() == 0);
+    CHECK(read_file(path) == expected);
+}
+
+TEST_CASE("file_writer: check many producers, blocking at the high-water mark") {
+    std::string path = "producers-write";
+    constexpr size_t producers = 8;
+    constexpr size_t count = 5000;
+    constexpr size_t mark = 16 * 1024;
+
+    struct record_t {
+        uint64_t producer;
+        uint64_t sequence;
+    };
+
+    /* Catch's assertions aren't thread safe, so the producers only count */
+    std::atomic<size_t> most_pending{0};
+    std::atomic<size_t> not_queued{0};
+    {
+        sg::file_writer writer;
+        writer.start(path, nullptr, nullptr, nullptr, {.high_water_mark = mark});
+
+        std::vector<std::jthread> threads;
+        for (size_t p = 0; p < producers; ++p)
+            threads.emplace_back([&, p] {
+                for (uint64_t i = 0; i < count; ++i) {
+                    record_t record{p, i};
+                    if (writer.write_async(&record, 1) != sg::file_writer::write_result_t::queued)
+                        ++not_queued;
+
+                    auto pending = writer.pending_bytes();
+                    auto most = most_pending.load();
+                    while (pending > most && !most_pending.compare_exchange_weak(most, pending)) {}
+                }
+            });
+        threads.clear();
+        writer.stop();
+
+        CHECK(writer.bytes_transferred() == producers * count * sizeof(record_t));
+    }
+
+    CHECK(not_queued == 0);
+    /* each producer can overshoot by one record */
+    CHECK(most_pending.load() < mark + producers * sizeof(record_t));
+
+    /* and each producer's records are in the order written */
+    auto data = read_file(path);
+    REQUIRE(data.size() == producers * count * sizeof(record_t));
+    std::vector<uint64_t> next(producers, 0);
+    for (size_t offset = 0; offset < data.size(); offset += sizeof(record_t)) {
+        record_t record;
+        std::memcpy(&record, data.data() + offset, sizeof(record));
+        REQUIRE(record.producer < producers);
+        REQUIRE(record.sequence == next[record.producer]);
+        ++next[record.producer];
+    }
+}
+
+TEST_CASE("file_writer: check segment_path()") {
+    CHECK(sg::file_writer::segment_path("rec.bin", 0) == "rec.000000.bin");
+    CHECK(sg::file_writer::segment_path("dir/rec.bin", 12) == std::filesystem::path("dir") / "rec.000012.bin");
+    CHECK(sg::file_writer::segment_path("rec", 1) == "rec.000001");
+}
+
+TEST_CASE("file_writer: check segments roll over by size") {
+    std::string path = "segmented.bin";
+    for (size_t i = 0; i < 5; ++i)
+        std::filesystem::remove(sg::file_writer::segment_path(path, i));
+
+    std::mutex mutex;
+    std::vector<std::pair<std::filesystem::path, size_t>> closed;
+
+    sg::file_writer::options_t options;
+    options.segment_size = 1000;
+    options.on_segment_closed = [&](sg::file_writer *, const std::filesystem::path &segment, size_t bytes) {
+        std::lock_guard lock(mutex);
+        closed.emplace_back(segment, bytes);
+    };
+
+    SECTION("stream") {}
+    SECTION("io_uring") { options.backend = sg::file_writer::backend_t::io_uring; }
+
+    /* 25 buffers of 100 bytes, and one bigger than a segment */
+    std::string expected;
+    {
+        sg::file_writer writer;
+        writer.start(path, nullptr, nullptr, nullptr, options);
+        for (size_t i = 0; i < 26; ++i) {
+            std::string text(i == 25 ? 1500 : 100, static_cast<char>('a' + i));
+            writer.write_async(text);
+            expected += text;
+        }
+        writer.stop();
+        CHECK(writer.bytes_transferred() == expected.size());
+    }
+
+    std::lock_guard lock(mutex);
+    REQUIRE(closed.size() == 4);
+    std::string written;
+    for (size_t i = 0; i < closed.size(); ++i) {
+        CHECK(closed[i].first == sg::file_writer::segment_path(path, i));
+        CHECK(closed[i].second == (i < 2 ? 1000 : i == 2 ? 500 : 1500));
+        CHECK(std::filesystem::file_size(closed[i].first) == closed[i].second);
+        written += read_file(closed[i].first.string());
+    }
+    CHECK(written == expected);
+
+    /* the segment opened ahead of time, and not needed, is removed */
+    CHECK_FALSE(std::filesystem::exists(sg::file_writer::segment_path(path, 4)));
+}
+
+TEST_CASE("file_writer: check segments roll over by time") {
+    std::string path = "segmented-time.bin";
+    std::atomic<size_t> closed{0};
+
+    sg::file_writer::options_t options;
+    options.segment_interval = std::chrono::milliseconds(50);
+    options.on_segment_closed = [&](sg::file_writer *, const std::filesystem::path &, size_t bytes) {
+        if (bytes == 4) ++closed;
+    };
+
+    sg::file_writer writer;
+    writer.start(path, nullptr, nullptr, nullptr, options);
+    writer.write_async("TEST");
+
+    /* rolls over without anything more being written */
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (closed == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(closed == 1);
+    CHECK(read_file(sg::file_writer::segment_path(path, 0).string()) == "TEST");
+
+    writer.write_async("TEST");
+    writer.stop();
+    CHECK(closed == 2);
+    CHECK(read_file(sg::file_writer::segment_path(path, 1).string()) == "TEST");
+}
+
+TEST_CASE("file_writer: check durable writes") {
+    std::string path = "durable-write";
+    using durability_t = sg::file_writer::durability_t;
+
+    sg::file_writer::options_t options;
+    SECTION("none") { options.durability = durability_t::none; }
+    SECTION("periodic") {
+        options.durability = durability_t::periodic;
+        options.sync_interval = std::chrono::milliseconds(5);
+    }
+    SECTION("group commit") { options.durability = durability_t::group_commit; }
+    SECTION("io_uring, direct I/O") {
+        options.backend = sg::file_writer::backend_t::io_uring;
+        options.direct_io = true;
+    }
+
+    sg::file_writer writer;
+    writer.start(path, nullptr, nullptr, nullptr, options);
+
+    /* a partial block, for direct I/O, still has to be on disk */
+    auto future = writer.write_async_durable("TEST");
+    REQUIRE(future.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    CHECK_NOTHROW(future.get());
+    CHECK(read_file(path) == "TEST");
+    CHECK(writer.sync_stats().count >= 1);
+
+    /* many at once share the syncs */
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < 1000; ++i)
+        futures.push_back(writer.write_async_durable("TEST"));
+    for (auto &f : futures) {
+        REQUIRE(f.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+        CHECK_NOTHROW(f.get());
+    }
+    writer.stop();
+
+    auto stats = writer.sync_stats();
+    CHECK(stats.count < 1000);
+    CHECK(stats.max >= stats.last);
+    CHECK(stats.mean() <= stats.max);
+    CHECK(read_file(path).size() == 4 * 1001);
+}
+
+TEST_CASE("file_writer: check periodic syncs happen without further writes") {
+    sg::file_writer writer;
+    writer.start("periodic-write", nullptr, nullptr, nullptr,
+                 {.durability = sg::file_writer::durability_t::periodic,
+                  .sync_interval = std::chrono::milliseconds(20)});
+    writer.write_async("TEST");
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (writer.sync_stats().count == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(writer.sync_stats().count == 1);
+}
+
+TEST_CASE("file_writer: check no syncs without durability") {
+    sg::file_writer writer;
+    writer.start("not-durable-write", nullptr, nullptr, nullptr);
+    writer.write_async("TEST");
+    writer.stop();
+    CHECK(writer.sync_stats().count == 0);
+}
+
+TEST_CASE("file_writer: check durable writes refused at the high-water mark") {
+    sg::file_writer writer;
+    writer.start("refused-write", nullptr, nullptr, nullptr,
+                 {.high_water_mark = 1, .overflow = sg::file_writer::overflow_t::fail});
+    writer.stop();
+
+    CHECK(writer.write_async("TEST") == sg::file_writer::write_result_t::queued);
+    auto future = writer.write_async_durable("TEST");
+    REQUIRE(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    CHECK_THROWS(future.get());
+}
+
+#if defined(__linux__)
+TEST_CASE("file_writer: check durable writes fail once a write has failed") {
+    /* every write to /dev/full fails with ENOSPC. The error callback holds the writer thread until
+     * more writes are queued behind the failed one */
+    std::promise<void> failed;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<size_t> errors{0};
+    sg::file_writer writer;
+    writer.start(
+        "/dev/full",
+        [&](sg::file_writer *, const std::string &) {
+            if (errors++ == 0) {
+                failed.set_value();
+                released.wait();
+            }
+        },
+        nullptr, nullptr);
+
+    std::vector<std::future<void>> futures;
+    futures.push_back(writer.write_async_durable("TEST"));
+    failed.get_future().wait();
+    for (size_t i = 0; i < 100; ++i)
+        futures.push_back(writer.write_async_durable("TEST"));
+    release.set_value();
+
+    /* the one written, those still queued, and those made after the failure */
+    for (auto &f : futures) {
+        REQUIRE(f.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+        CHECK_THROWS_AS(f.get(), std::runtime_error);
+    }
+    auto late = writer.write_async_durable("TEST");
+    REQUIRE(late.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    CHECK_THROWS_AS(late.get(), std::runtime_error);
+
+    writer.stop();
+    CHECK(writer.pending_bytes() == 0);
+
+    auto stopped = writer.write_async_durable("TEST");
+    REQUIRE(stopped.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    CHECK_THROWS_AS(stopped.get(), std::runtime_error);
+}
+#endif
+
+TEST_CASE("file_writer: check histogram_t quantiles") {
+    sg::file_writer::histogram_t histogram;
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.quantile(0.5) == 0);
+
+    /* 0, 1, 2..3, 4..7 */
+    histogram.buckets[0] = 1;
+    histogram.buckets[1] = 1;
+    histogram.buckets[2] = 1;
+    histogram.buckets[3] = 7;
+    CHECK(histogram.count() == 10);
+    CHECK(histogram.quantile(0) == 0);
+    CHECK(histogram.quantile(0.1) == 0);
+    CHECK(histogram.quantile(0.2) == 1);
+    CHECK(histogram.quantile(0.3) == 3);
+    CHECK(histogram.quantile(0.5) == 7);
+    CHECK(histogram.quantile(1) == 7);
+}
+
+TEST_CASE("file_writer: check stats()") {
+    std::string path = "stats.txt";
+    sg::file_writer writer;
+
+    sg::file_writer::options_t options;
+    options.high_water_mark = 64;
+    writer.start(path, nullptr, nullptr, nullptr, options);
+    CHECK(writer.stats().batch_bytes.count() == 0);
+
+    const size_t count = 2000;
+    for (size_t i = 0; i < count; ++i)
+        writer.write_async("0123456789abcdef");
+
+    /* wait for a whole second with writes in it, for the throughput */
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (writer.stats().bytes_per_second_10s == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto stats = writer.stats();
+    CHECK(stats.queue_depth == 0);
+    CHECK(stats.pending_bytes == 0);
+    CHECK(stats.queue_depth_high >= 1);
+    CHECK(stats.pending_bytes_high >= 16);
+    /* sampled */
+    CHECK(stats.write_latency_ns.count() >= count / 16);
+    CHECK(stats.write_latency_ns.count() <= count / 16 + 1);
+    CHECK(stats.batch_latency_ns.count() == stats.batch_bytes.count());
+    CHECK(stats.batch_buffers.count() == stats.batch_bytes.count());
+    CHECK(stats.batch_bytes.count() >= 1);
+    CHECK(stats.batch_bytes.quantile(1) >= 16);
+    CHECK(stats.syscalls == writer.syscall_count());
+    CHECK(stats.syscalls > 0);
+    CHECK(stats.writer_idle.count() > 0);
+    CHECK(stats.bytes_per_second_10s > 0);
+    CHECK(stats.bytes_per_second_10s <= count * 16);
+    CHECK(stats.bytes_per_second_60s <= stats.bytes_per_second_10s);
+
+    writer.stop();
+
+    /* and start again from nothing */
+    writer.start(path, nullptr, nullptr, nullptr);
+    CHECK(writer.stats().write_latency_ns.count() == 0);
+    CHECK(writer.stats().queue_depth_high == 0);
+    writer.stop();
+}
+
+TEST_CASE("file_writer: check the io_uring backend") {
+    std::string path = "uring-write";
+    /* uneven sizes, so that buffers straddle blocks */
+    std::vector<std::vector<uint64_t>> vec_data = random_data(300, 4104);
+
+    sg::file_writer::options_t options;
+    options.backend = sg::file_writer::backend_t::io_uring;
+    options.block_size = 64 * 1024;
+    options.queue_depth = 4;
+
+    SECTION("buffered") {}
+    SECTION("direct I/O") { options.direct_io = true; }
+    SECTION("one buffer per block") {
+        /* the block size is kept as it is, being a multiple of 4 KiB */
+        options.block_size = 4096;
+        vec_data = random_data(300, 4096);
+    }
+
+    std::string expected;
+    for (const auto &buf : vec_data)
+        expected.append(reinterpret_cast<const char *>(buf.data()), buf.size() * sizeof(uint64_t));
+
+    std::string error;
+    {
+        sg::file_writer writer;
+        writer.start(path, [&error](sg::file_writer *, const std::string &msg) { error = msg; }, nullptr,
+                     nullptr, options);
+
+        const std::string name = writer.backend_name();
+        CHECK((name == "io_uring" || name == "writev" || name == "stream"));
+
+        for (const auto &buf : vec_data)
+            writer.write_async(buf.data(), buf.size());
+        writer.stop();
+
+        CHECK(writer.bytes_transferred() == expected.size());
+    }
+
+    CHECK(error.empty());
+    CHECK(read_file(path) == expected);
+}
+
 TEST_CASE("file_writer: benchmark file_writer", "[.][sg::file_writer]" ){
     std::string path = "benchmark-buffer";
 
@@ -158,3 +623,90 @@ TEST_CASE("file_writer: benchmark file_writer", "[.][sg::file_writer]" ){
         });
     };
 }
+
+TEST_CASE("file_writer: benchmark small writes", "[.][sg::file_writer]") {
+    std::string path = "benchmark-small";
+    std::string line = "2024-01-01 00:00:00.000 [info] a typical log line, of about eighty bytes\n";
+
+    BENCHMARK_ADVANCED("100000 log lines")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&] {
+            sg::file_writer writer;
+            writer.start(path, nullptr, nullptr, nullptr);
+            for (size_t i = 0; i < 100000; ++i)
+                writer.write_async(line);
+            writer.stop();
+            return writer.syscall_count();
+        });
+    };
+}
+
+TEST_CASE("file_writer: benchmark many producers", "[.][sg::file_writer]") {
+    std::string path = "benchmark-producers";
+    std::string line = "2024-01-01 00:00:00.000 [info] a typical log line, of about eighty bytes\n";
+
+    for (size_t producers : {1, 4, 32}) {
+        BENCHMARK(fmt::format("{} producers, 320000 lines", producers)) {
+            sg::file_writer writer;
+            writer.start(path, nullptr, nullptr, nullptr);
+            {
+                std::vector<std::jthread> threads;
+                for (size_t p = 0; p < producers; ++p)
+                    threads.emplace_back([&] {
+                        for (size_t i = 0; i < 320000 / producers; ++i)
+                            writer.write_async(line);
+                    });
+            }
+            writer.stop();
+            return writer.bytes_transferred();
+        };
+    }
+}
+
+TEST_CASE("file_writer: benchmark durable writes", "[.][sg::file_writer]") {
+    std::string path = "benchmark-durable";
+
+    for (size_t producers : {1, 8}) {
+        BENCHMARK(fmt::format("group commit, {} producers, 2000 durable writes", producers)) {
+            sg::file_writer writer;
+            writer.start(path, nullptr, nullptr, nullptr, {.durability = sg::file_writer::durability_t::group_commit});
+            {
+                std::vector<std::jthread> threads;
+                for (size_t p = 0; p < producers; ++p)
+                    threads.emplace_back([&] {
+                        for (size_t i = 0; i < 2000 / producers; ++i)
+                            writer.write_async_durable("a durable record\n").wait();
+                    });
+            }
+            writer.stop();
+            return writer.sync_stats().count;
+        };
+    }
+}
+
+TEST_CASE("file_writer: benchmark file_writer backends", "[.][sg::file_writer]") {
+    std::string path = "benchmark-backends";
+    /* 256 MiB, in 64 KiB buffers */
+    std::vector<sg::file_writer::buffer_type> buffers;
+    for (const auto &buf : random_data(4096, 64 * 1024)) {
+        auto data_buf = sg::make_shared_c_buffer<std::byte>(buf.size() * sizeof(uint64_t));
+        std::memcpy(data_buf.get(), buf.data(), buf.size() * sizeof(uint64_t));
+        buffers.push_back(std::move(data_buf));
+    }
+
+    auto run = [&](sg::file_writer::options_t options) {
+        sg::file_writer writer;
+        writer.start(path, nullptr, nullptr, nullptr, options);
+        for (const auto &buf : buffers)
+            writer.write_async(buf);
+        writer.stop();
+        return writer.bytes_transferred();
+    };
+
+    BENCHMARK("stream") { return run({}); };
+
+    BENCHMARK("io_uring") { return run({.backend = sg::file_writer::backend_t::io_uring}); };
+
+    BENCHMARK("io_uring, direct I/O") {
+        return run({.backend = sg::file_writer::backend_t::io_uring, .direct_io = true});
+    };
+}
@@ -0,0 +1,195 @@
+#include <sg/file_writer.h>
+#include <sg/file_writer_service.h>
+#include <sg/file.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include <fmt/core.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string read_file(const std::filesystem::path &path) {
+    auto data = sg::common::file::read(path);
+    return std::string(reinterpret_cast<const char *>(data.get()), data.size());
+}
+
+} // namespace
+
+TEST_CASE("sg::file_writer_service: check many writers share the threads", "[sg::file_writer_service]") {
+    sg::file_writer_service::options_t service_options;
+    service_options.threads = GENERATE(size_t{1}, size_t{3});
+    service_options.max_batch_bytes = GENERATE(size_t{1}, size_t{1024 * 1024});
+    auto service = std::make_shared<sg::file_writer_service>(service_options);
+    REQUIRE(service->thread_count() == service_options.threads);
+
+    sg::file_writer::options_t options;
+    options.service = service;
+
+    constexpr size_t count = 50;
+    std::vector<std::unique_ptr<sg::file_writer>> writers;
+    for (size_t i = 0; i < count; ++i) {
+        writers.push_back(std::make_unique<sg::file_writer>());
+        writers.back()->start(fmt::format("service-{}.txt", i), nullptr, nullptr, nullptr, options);
+    }
+    REQUIRE(service->writer_count() == count);
+    REQUIRE(writers.front()->is_running());
+
+    /* from two producers at once */
+    {
+        std::vector<std::jthread> producers;
+        for (size_t p = 0; p < 2; ++p)
+            producers.emplace_back([&, p] {
+                for (size_t line = 0; line < 100; ++line)
+                    for (size_t i = p; i < count; i += 2)
+                        writers[i]->write_async(fmt::format("{} {}\n", i, line));
+            });
+    }
+
+    for (auto &writer : writers) {
+        writer->stop();
+        REQUIRE_FALSE(writer->is_running());
+    }
+    REQUIRE(service->writer_count() == 0);
+
+    for (size_t i = 0; i < count; ++i) {
+        std::string expected;
+        for (size_t line = 0; line < 100; ++line)
+            expected += fmt::format("{} {}\n", i, line);
+        REQUIRE(read_file(fmt::format("service-{}.txt", i)) == expected);
+    }
+}
+
+TEST_CASE("sg::file_writer_service: check a busy writer doesn't hold up the others", "[sg::file_writer_service]") {
+    sg::file_writer_service::options_t service_options;
+    service_options.max_batch_bytes = 64 * 1024;
+    auto service = std::make_shared<sg::file_writer_service>(service_options);
+
+    sg::file_writer::options_t options;
+    options.service = service;
+
+    sg::file_writer busy, quiet;
+    busy.start("service-busy.bin", nullptr, nullptr, nullptr, options);
+    quiet.start("service-quiet.bin", nullptr, nullptr, nullptr, options);
+
+    /* 256 MiB, in 64 KiB buffers */
+    auto buffer = sg::make_shared_c_buffer<std::byte>(64 * 1024);
+    std::memset(buffer.get(), 'x', buffer.size());
+    for (size_t i = 0; i < 4096; ++i)
+        busy.write_async(buffer);
+
+    auto written = quiet.write_async_durable("hello");
+    REQUIRE(written.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    CHECK(busy.pending_bytes() > 0);
+
+    busy.stop();
+    quiet.stop();
+    CHECK(busy.bytes_transferred() == 4096 * buffer.size());
+    CHECK(read_file("service-quiet.bin") == "hello");
+}
+
+TEST_CASE("sg::file_writer_service: check timers", "[sg::file_writer_service]") {
+    auto service = std::make_shared<sg::file_writer_service>();
+
+    sg::file_writer::options_t options;
+    options.service = service;
+
+    SECTION("periodic durability") {
+        options.durability = sg::file_writer::durability_t::periodic;
+        options.sync_interval = std::chrono::milliseconds(20);
+
+        sg::file_writer writer;
+        writer.start("service-periodic.txt", nullptr, nullptr, nullptr, options);
+        writer.write_async("hello");
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (writer.sync_stats().count == 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        CHECK(writer.sync_stats().count > 0);
+        writer.stop();
+    }
+
+    SECTION("segment interval") {
+        options.segment_interval = std::chrono::milliseconds(20);
+
+        std::atomic<size_t> closed{0};
+        options.on_segment_closed = [&](sg::file_writer *, const std::filesystem::path &, size_t) { ++closed; };
+
+        sg::file_writer writer;
+        writer.start("service-interval.txt", nullptr, nullptr, nullptr, options);
+        for (int i = 0; i < 3; ++i) {
+            writer.write_async("hello");
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        writer.stop();
+        CHECK(closed >= 3);
+    }
+}
+
+TEST_CASE("sg::file_writer_service: check writers can be restarted, and without the service",
+          "[sg::file_writer_service]") {
+    auto service = std::make_shared<sg::file_writer_service>();
+
+    sg::file_writer writer;
+    sg::file_writer::options_t options;
+    options.service = service;
+
+    writer.start("service-restart.txt", nullptr, nullptr, nullptr, options);
+    writer.write_async("one");
+    writer.stop();
+    REQUIRE(read_file("service-restart.txt") == "one");
+
+    writer.start("service-restart.txt", nullptr, nullptr, nullptr, options);
+    writer.write_async("two");
+    writer.stop();
+    REQUIRE(read_file("service-restart.txt") == "two");
+
+    writer.start("service-restart.txt", nullptr, nullptr, nullptr, {});
+    writer.write_async("three");
+    writer.stop();
+    REQUIRE(read_file("service-restart.txt") == "three");
+    REQUIRE(service->writer_count() == 0);
+}
+
+TEST_CASE("sg::file_writer_service: benchmark many writers", "[.][sg::file_writer_service]") {
+    constexpr size_t count = 300;
+
+    const auto run = [&](const std::shared_ptr<sg::file_writer_service> &service) {
+        sg::file_writer::options_t options;
+        options.service = service;
+
+        std::vector<std::unique_ptr<sg::file_writer>> writers;
+        for (size_t i = 0; i < count; ++i) {
+            writers.push_back(std::make_unique<sg::file_writer>());
+            writers.back()->start(fmt::format("benchmark-service-{}.bin", i), nullptr, nullptr, nullptr, options);
+        }
+
+        /* a message per channel at a time, as from a feed */
+        for (size_t message = 0; message < 200; ++message)
+            for (auto &writer : writers)
+                writer->write_async("a message of about 64 bytes, as from a feed of many channels...");
+
+        size_t bytes{0};
+        for (auto &writer : writers) {
+            writer->stop();
+            bytes += writer->bytes_transferred();
+        }
+        return bytes;
+    };
+
+    BENCHMARK("a thread per writer") { return run(nullptr); };
+
+    BENCHMARK("service, 1 thread") { return run(std::make_shared<sg::file_writer_service>()); };
+
+    BENCHMARK("service, 4 threads") {
+        return run(std::make_shared<sg::file_writer_service>(sg::file_writer_service::options_t{.threads = 4}));
+    };
+}
@@ -0,0 +1,128 @@
+#include <sg/crc.h>
+#include <sg/hash.h>
+#include <sg/buffer.h>
+#include <sg/random.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t length) {
+    std::vector<uint8_t> dat(length);
+    for (size_t i = 0; i < length; ++i)
+        dat[i] = static_cast<uint8_t>(i * 7 + 3);
+    return dat;
+}
+
+} // namespace
+
+TEST_CASE("hash: check xxh3 against reference values", "[sg::checksum]") {
+    /* values from the xxHash 0.8.3 reference implementation, one per length class, as given by the
+     * Python bindings (pip install xxhash==4.0.1):
+     *
+     *     dat = bytes((i * 7 + 3) & 0xff for i in range(1000))
+     *     xxhash.xxh3_64_intdigest(dat[:length], seed)
+     *     xxhash.xxh3_128_intdigest(dat[:length], seed)  # high64 << 64 | low64
+     */
+    struct expected_t {
+        size_t length;
+        uint64_t h64;
+        uint64_t h64Seeded; // seed 42
+        sg::checksum::hash128_t h128;
+        sg::checksum::hash128_t h128Seeded; // seed 42
+    };
+    std::vector<expected_t> expected{
+        {0, 0x2d06800538d394c2, 0xb029411ff43d84d2, {0x6001c324468d497f, 0x99aa06d3014798d8},
+         {0x3c1d09e9fe249164, 0x16c20acd33f7af2f}},
+        {3, 0xa9088dda485b481c, 0x3a6eb7a191052c81, {0xa9088dda485b481c, 0xce31763cbf8245a5},
+         {0x3a6eb7a191052c81, 0x916a24e287718a05}},
+        {8, 0x60539db630471163, 0x53a895ca319fab31, {0x3cd024e3d63a1588, 0xe3bc8a5f46171555},
+         {0xfcef9d87275abd57, 0xdb7aaf40cd2508fd}},
+        {16, 0xb8c859b0f030b585, 0x6b1b54f65d114c69, {0x60d75c5e47d40a24, 0xce0b9647ab24f884},
+         {0xcd35a6b186e354d5, 0xca2421404d5d2d31}},
+        {100, 0xb5937857f0d78c9f, 0x223ce4409957d0ce, {0x0cc97f05750182b2, 0x2207ed96998d91f2},
+         {0xbe8dc3486451d9b5, 0x5e8e7ced7c51485b}},
+        {200, 0x746cd0025327bf5b, 0xb04cc37ae5a4a48d, {0x380142cdd5843bbd, 0x32200a52a918beaf},
+         {0xfef64d3bed0600ed, 0x7d487fb64647cb0a}},
+        {1000, 0x6c4f14bd97bd9e82, 0xf0f163846cbf0c33, {0x6c4f14bd97bd9e82, 0x6bcc7eff62da44c2},
+         {0xf0f163846cbf0c33, 0xc281146f104d47f7}},
+    };
+
+    auto dat = pattern(1000);
+    for (const auto &e : expected) {
+        INFO("length " << e.length << ", implementation " << sg::checksum::xxh3_implementation());
+        REQUIRE(sg::checksum::xxh3_64(dat.data(), e.length) == e.h64);
+        REQUIRE(sg::checksum::xxh3_64(dat.data(), e.length, 42) == e.h64Seeded);
+        REQUIRE(sg::checksum::xxh3_128(dat.data(), e.length) == e.h128);
+        REQUIRE(sg::checksum::xxh3_128(dat.data(), e.length, 42) == e.h128Seeded);
+    }
+}
+
+TEST_CASE("hash: check xxh3 streaming", "[sg::checksum]") {
+    auto dat = sg::random::generate<uint8_t>(20000);
+
+    for (uint64_t seed : {0ULL, 42ULL}) {
+        for (size_t length : {0, 10, 240, 241, 1024, 1025, 4000, 20000}) {
+            for (size_t chunk : {1, 63, 64, 255, 256, 1000, 20000}) {
+                INFO("seed " << seed << ", length " << length << ", chunk " << chunk);
+                sg::checksum::xxh3_state state(seed);
+                for (size_t pos = 0; pos < length; pos += chunk)
+                    state.update(dat.data() + pos, std::min(chunk, length - pos));
+
+                REQUIRE(state.digest64() == sg::checksum::xxh3_64(dat.data(), length, seed));
+                REQUIRE(state.digest128() == sg::checksum::xxh3_128(dat.data(), length, seed));
+            }
+        }
+    }
+
+    SECTION("digest, then carry on") {
+        sg::checksum::xxh3_state state;
+        state.update(dat.data(), 1000);
+        REQUIRE(state.digest64() == sg::checksum::xxh3_64(dat.data(), 1000));
+        state.update(dat.data() + 1000, 9000);
+        REQUIRE(state.digest64() == sg::checksum::xxh3_64(dat.data(), 10000));
+
+        state.reset();
+        state.update(dat.data(), 5);
+        REQUIRE(state.digest64() == sg::checksum::xxh3_64(dat.data(), 5));
+    }
+}
+
+TEST_CASE("hash: check xxh3 buffer overloads", "[sg::checksum]") {
+    auto buffer = sg::make_unique_c_buffer<std::byte>(5000);
+    auto dat = sg::random::generate<uint8_t>(buffer.size());
+    std::memcpy(buffer.get(), dat.data(), dat.size());
+
+    REQUIRE(sg::checksum::xxh3_64(buffer) == sg::checksum::xxh3_64(dat.data(), dat.size()));
+    REQUIRE(sg::checksum::xxh3_128(buffer, 7) == sg::checksum::xxh3_128(dat.data(), dat.size(), 7));
+
+    sg::checksum::xxh3_state state;
+    state.update(buffer);
+    REQUIRE(state.digest64() == sg::checksum::xxh3_64(buffer));
+
+    /* distinct inputs, distinct hashes */
+    std::unordered_set<size_t> hashes;
+    for (size_t i = 0; i < 1000; ++i)
+        hashes.insert(sg::checksum::xxh3_hasher{}(std::span(buffer.get(), i)));
+    REQUIRE(hashes.size() == 1000);
+}
+
+TEST_CASE("hash: benchmark xxh3", "[.][sg::checksum]") {
+    WARN("xxh3: " << sg::checksum::xxh3_implementation()
+                  << ", crc32c: " << sg::checksum::crc32c_implementation());
+
+    for (size_t size : {64, 1024, 64 * 1024, 16 * 1024 * 1024}) {
+        auto dat = sg::random::generate<uint8_t>(size);
+        auto label = std::to_string(size) + " bytes";
+
+        BENCHMARK("xxh3_64(...), " + label) { return sg::checksum::xxh3_64(dat.data(), dat.size()); };
+        BENCHMARK("xxh3_128(...), " + label) {
+            return sg::checksum::xxh3_128(dat.data(), dat.size());
+        };
+        BENCHMARK("crc32c(...), " + label) { return sg::checksum::crc32c(dat.data(), dat.size()); };
+    }
+}
@@ -0,0 +1,78 @@
+#include "sg/mpsc_queue.h"
+#include "sg/jthread.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("sg::common mpsc_queue: check push() and try_pop() are first in first out", "[sg::mpsc_queue]") {
+    sg::mpsc_queue<int> queue;
+    REQUIRE(queue.empty());
+    REQUIRE_FALSE(queue.try_pop());
+
+    for (int i = 0; i < 10; ++i)
+        queue.push(i);
+    REQUIRE_FALSE(queue.empty());
+
+    for (int i = 0; i < 10; ++i) {
+        auto value = queue.try_pop();
+        REQUIRE(value);
+        REQUIRE(*value == i);
+    }
+    REQUIRE(queue.empty());
+    REQUIRE_FALSE(queue.try_pop());
+}
+
+TEST_CASE("sg::common mpsc_queue: check values left in the queue are destroyed", "[sg::mpsc_queue]") {
+    auto value = std::make_shared<int>(1);
+    {
+        sg::mpsc_queue<std::shared_ptr<int>> queue;
+        queue.push(value);
+        queue.push(value);
+        REQUIRE(value.use_count() == 3);
+
+        auto popped = queue.try_pop();
+        popped.reset();
+        REQUIRE(value.use_count() == 2);
+    }
+    REQUIRE(value.use_count() == 1);
+}
+
+TEST_CASE("sg::common mpsc_queue: check many producers", "[sg::mpsc_queue]") {
+    constexpr size_t producers = 8;
+    constexpr size_t count = 20000;
+
+    struct item_t {
+        size_t producer;
+        size_t sequence;
+    };
+    sg::mpsc_queue<item_t> queue;
+
+    std::vector<std::jthread> threads;
+    for (size_t p = 0; p < producers; ++p)
+        threads.emplace_back([&queue, p] {
+            for (size_t i = 0; i < count; ++i)
+                queue.push(item_t{p, i});
+        });
+
+    /* each producer's items come out in the order it pushed them */
+    std::vector<size_t> next(producers, 0);
+    size_t received{0};
+    size_t out_of_order{0};
+    while (received < producers * count) {
+        auto item = queue.try_pop();
+        if (!item) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item->sequence != next[item->producer]) ++out_of_order;
+        next[item->producer] = item->sequence + 1;
+        ++received;
+    }
+
+    threads.clear();
+    REQUIRE(out_of_order == 0);
+    REQUIRE(queue.empty());
+}
@@ -2,6 +2,7 @@
 
 #include "helpers.h"
 
+#include <sg/crc.h>
 #include <sg/net/tcp_client.h>
 #include <sg/net/tcp_server.h>
 
@@ -434,6 +435,47 @@ TEST_CASE("tcp_client: disconnect() waits out a teardown already in progress",
     peer.close();
 }
 
+TEST_CASE("tcp_session: write_and_crc32c() sends the data and returns its crc",
+          "[sg::net::tcp_session]") {
+    scoped_deadline watchdog("write_and_crc32c() data never arrived");
+
+    std::string text(100000, 'x');
+    for (size_t i = 0; i < text.size(); ++i)
+        text[i] = static_cast<char>('a' + i % 26);
+
+    std::mutex mutex;
+    std::string received;
+    std::binary_semaphore allReceived{false};
+
+    tcp_server::CallBacks serverCbs;
+    serverCbs.OnSessionDataAvailable = [&](tcp_server&, tcp_server::session_id_t,
+                                           const std::byte* data, size_t size) {
+        std::lock_guard lock(mutex);
+        received.append(reinterpret_cast<const char*>(data), size);
+        if (received.size() == text.size())
+            allReceived.release();
+    };
+
+    tcp_server server;
+    server.start({ep}, serverCbs);
+
+    tcp_client client;
+    client.connect(ep, nullptr, nullptr);
+
+    auto first = client.session().write_and_crc32c(text.data(), 1000);
+    auto crc = client.session().write_and_crc32c(text.data() + 1000, text.size() - 1000, first);
+    REQUIRE(first == sg::checksum::crc32c(text.data(), 1000));
+    REQUIRE(crc == sg::checksum::crc32c(text.data(), text.size()));
+
+    allReceived.acquire();
+    {
+        std::lock_guard lock(mutex);
+        REQUIRE(received == text);
+    }
+
+    client.disconnect();
+}
+
 TEST_CASE("tcp_session: pending_bytes() drains to zero", "[sg::net::tcp_session]") {
     scoped_deadline watchdog("pending_bytes() never drained");
 